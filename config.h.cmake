@@ -3,10 +3,25 @@
 
 #cmakedefine HAS_DUP2
 #cmakedefine HAS_FORK
+#cmakedefine HAS_GETRUSAGE
 #cmakedefine HAS_ISATTY
+#cmakedefine HAS_MALLOC_USABLE_SIZE
+#cmakedefine HAS_MKDTEMP
+#cmakedefine HAS_MMAP
+#cmakedefine HAS_OPENDIR
+#cmakedefine HAS_POLL
+#cmakedefine HAS_SETENV
+#cmakedefine HAS_SETRLIMIT
+#cmakedefine HAS_SETITIMER
+#cmakedefine HAS_SIGACTION
+#cmakedefine HAS_SIGALTSTACK
+#cmakedefine HAS_SIGSETJMP
 #cmakedefine HAS_SIGNAL
 #cmakedefine HAS_SOCKETPAIR
 #cmakedefine HAS_WAITPID
+#cmakedefine HAS_SYS_PERF_EVENT_OPEN
+#cmakedefine HAS_PERF_EVENT_IOC_ENABLE
+#cmakedefine HAS_RTLD_NEXT
 #cmakedefine HAS_MODELCHECK
 #cmakedefine FORKED_TEST_RUNNER_SELECTED
 
@@ -17,6 +32,39 @@
 # define FORKED_TEST_RUNNER
 #endif
 
+/* support for the shared memory transport in the forked test runner. */
+#if defined(FORKED_TEST_RUNNER) && defined(HAS_MMAP)
+# define SHARED_MEMORY_TRANSPORT
+#endif
+
+/* support for fuzzing tests in forked test runners. */
+#if defined(FORKED_TEST_RUNNER) && defined(HAS_MMAP) && defined(HAS_OPENDIR)
+# define FUZZ_RUNNER
+#endif
+
+/* support for resource limits on tests run in forked test runners. */
+#if defined(FORKED_TEST_RUNNER) && defined(HAS_SETRLIMIT) \
+    && defined(HAS_GETRUSAGE) && defined(HAS_OPENDIR)
+# define RESOURCE_LIMITS
+#endif
+
+/* support for containing crashes of tests run in the test runner's process. */
+#if defined(HAS_SETITIMER) && defined(HAS_SIGACTION) \
+    && defined(HAS_SIGALTSTACK) && defined(HAS_SIGSETJMP)
+# define CRASH_CONTAINMENT
+#endif
+
+/* support for hardware and software performance counters. */
+#if defined(HAS_SYS_PERF_EVENT_OPEN) && defined(HAS_PERF_EVENT_IOC_ENABLE)
+# define PERF_EVENT_COUNTERS
+#endif
+
+/* support for capturing the coverage of each test. */
+#if defined(HAS_MKDTEMP) && defined(HAS_OPENDIR) && defined(HAS_SETENV) \
+    && defined(__GNUC__)
+# define COVERAGE_CAPTURE
+#endif
+
 /* support for model checking. */
 #if defined(HAS_MODELCHECK)
 # include <modelcheck/model_assert.h>
@@ -0,0 +1,1370 @@
+/**
+ * \file driver/minunit_driver.cpp
+ *
+ * \brief Test driver, which runs many minunit test executables in parallel.
+ *
+ * Each test executable is run in its own process group, with its standard
+ * output and standard error captured through a pipe, and with a JSON Lines
+ * report written to a temporary directory.  As each executable finishes, its
+ * captured output is printed as a single block, in the order the executables
+ * were given, and its report is read to count its tests and failures.  The
+ * reports of every executable are merged into the reports requested of the
+ * driver, and the driver fails if any executable fails.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief Enumeration for supported terminal colors.
+ */
+enum driver_color
+{
+    DRIVER_COLOR_NORMAL,
+    DRIVER_COLOR_GREEN,
+    DRIVER_COLOR_RED
+};
+
+/**
+ * \brief Outcome of a test executable, or of a failed test within one, whose
+ * resource limits may have ended it.
+ */
+enum binary_outcome
+{
+    BINARY_OUTCOME_PASS,
+    BINARY_OUTCOME_FAIL,
+    BINARY_OUTCOME_CRASH,
+    BINARY_OUTCOME_TIMEOUT,
+    BINARY_OUTCOME_OOM,
+    BINARY_OUTCOME_CPU_LIMIT,
+    BINARY_OUTCOME_FD_LEAK
+};
+
+/**
+ * \brief Driver options.
+ */
+typedef struct driver_options
+{
+    unsigned int jobs;
+    unsigned int timeout;
+    bool quiet_pass;
+    bool color;
+    const char* jsonl_report;
+    const char* junit_report;
+    vector<string> binaries;
+    vector<string> arguments;
+} driver_options_t;
+
+/**
+ * \brief A test executable, and the result of running it.
+ */
+typedef struct test_binary
+{
+    string path;
+    pid_t pid;
+    int fd;
+    bool started;
+    bool complete;
+    bool reported;
+    int outcome;
+    int status;
+    uint64_t wall_ns;
+    unsigned int tests;
+    unsigned int failures;
+    vector<pair<int, string>> failed_tests;
+    string output;
+    chrono::steady_clock::time_point start;
+} test_binary_t;
+
+/**
+ * \brief Set the terminal color, if color is enabled.
+ *
+ * \param options       The driver options.
+ * \param color         The color to set.
+ */
+static void set_color(const driver_options_t* options, int color)
+{
+    if (!options->color)
+        return;
+
+    switch (color)
+    {
+        case DRIVER_COLOR_GREEN:
+            printf("\033[32m");
+            break;
+
+        case DRIVER_COLOR_RED:
+            printf("\033[31m");
+            break;
+
+        default:
+            printf("\033[0m");
+            break;
+    }
+}
+
+/**
+ * \brief Determine whether standard output is a terminal that accepts color.
+ *
+ * \returns true if color should be used, and false otherwise.
+ */
+static bool running_in_color_terminal()
+{
+    if (!isatty(STDOUT_FILENO))
+        return false;
+
+    /* no-color.org suggestion. */
+    if (NULL != getenv("NO_COLOR"))
+        return false;
+
+    return true;
+}
+
+/**
+ * \brief Format a duration for display.
+ *
+ * \param ns            The duration in nanoseconds.
+ *
+ * \returns the formatted duration.
+ */
+static string format_duration(uint64_t ns)
+{
+    char buffer[32];
+
+    if (ns < 1000ULL)
+        snprintf(buffer, sizeof(buffer), "%u ns", (unsigned int)ns);
+    else if (ns < 1000000ULL)
+        snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1000.0);
+    else if (ns < 1000000000ULL)
+        snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1000000.0);
+    else
+        snprintf(buffer, sizeof(buffer), "%.2f s", ns / 1000000000.0);
+
+    return buffer;
+}
+
+/**
+ * \brief Get the raw value of a top-level member of a JSON object.
+ *
+ * Only the members written by the jsonl reporter need to be read, so the
+ * object is scanned rather than parsed.
+ *
+ * \param line          The JSON object, on a single line.
+ * \param name          The name of the member.
+ *
+ * \returns the value of the member, with the quotes of a string value removed
+ * and its escapes left in place, or an empty string if there is no such
+ * member.
+ */
+static string json_member(const string& line, const char* name)
+{
+    string key = string("\"") + name + "\":";
+    int depth = 0;
+    bool quoted = false;
+
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        char ch = line[i];
+
+        if (quoted)
+        {
+            if ('\\' == ch)
+                ++i;
+            else if ('"' == ch)
+                quoted = false;
+
+            continue;
+        }
+
+        if ('{' == ch || '[' == ch)
+        {
+            ++depth;
+            continue;
+        }
+
+        if ('}' == ch || ']' == ch)
+        {
+            --depth;
+            continue;
+        }
+
+        if ('"' != ch)
+            continue;
+
+        if (1 != depth || 0 != line.compare(i, key.size(), key))
+        {
+            quoted = true;
+            continue;
+        }
+
+        size_t begin = i + key.size();
+        size_t end = begin;
+
+        if (begin < line.size() && '"' == line[begin])
+        {
+            for (end = ++begin; end < line.size() && '"' != line[end]; ++end)
+            {
+                if ('\\' == line[end])
+                    ++end;
+            }
+        }
+        else
+        {
+            end = line.find_first_of(",}", begin);
+        }
+
+        return line.substr(begin, end - begin);
+    }
+
+    return "";
+}
+
+/**
+ * \brief Write a string as a JSON string.
+ *
+ * \param out           The stream to write to.
+ * \param value         The string to write.
+ */
+static void write_json_string(FILE* out, const string& value)
+{
+    fputc('"', out);
+
+    for (unsigned char ch : value)
+    {
+        if ('"' == ch || '\\' == ch)
+            fprintf(out, "\\%c", ch);
+        else if (ch < 0x20)
+            fprintf(out, "\\u%04x", ch);
+        else
+            fputc(ch, out);
+    }
+
+    fputc('"', out);
+}
+
+/**
+ * \brief Write a string as XML attribute text, escaping markup.
+ *
+ * \param out           The stream to write to.
+ * \param value         The string to write.
+ */
+static void write_xml_text(FILE* out, const string& value)
+{
+    for (unsigned char ch : value)
+    {
+        switch (ch)
+        {
+            case '&':
+                fputs("&amp;", out);
+                break;
+
+            case '<':
+                fputs("&lt;", out);
+                break;
+
+            case '>':
+                fputs("&gt;", out);
+                break;
+
+            case '"':
+                fputs("&quot;", out);
+                break;
+
+            default:
+                fputc(ch < 0x20 ? '?' : ch, out);
+                break;
+        }
+    }
+}
+
+/**
+ * \brief Get the path of a temporary report of a test executable.
+ *
+ * \param tmpdir        The temporary directory of the driver.
+ * \param index         The index of the test executable.
+ * \param extension     The extension of the report.
+ *
+ * \returns the path of the report.
+ */
+static string report_path(
+    const string& tmpdir, size_t index, const char* extension)
+{
+    return tmpdir + "/" + to_string(index) + extension;
+}
+
+/**
+ * \brief Start a test executable in its own process group, with its output
+ * captured through a pipe.
+ *
+ * \param options       The driver options.
+ * \param tmpdir        The temporary directory holding the reports.
+ * \param index         The index of the test executable.
+ * \param binary        The test executable to start.
+ *
+ * \returns true if the test executable was started, and false otherwise.
+ */
+static bool start_binary(
+    const driver_options_t* options, const string& tmpdir, size_t index,
+    test_binary_t* binary)
+{
+    int pipefd[2];
+
+    if (0 != pipe(pipefd))
+    {
+        perror("pipe");
+        return false;
+    }
+
+    vector<string> args;
+    args.push_back(binary->path);
+    args.push_back("--reporter=terminal");
+    args.push_back("--reporter=jsonl:" + report_path(tmpdir, index, ".jsonl"));
+    if (NULL != options->junit_report)
+        args.push_back(
+            "--reporter=junit:" + report_path(tmpdir, index, ".xml"));
+    args.insert(
+        args.end(), options->arguments.begin(), options->arguments.end());
+
+    vector<char*> argv;
+    for (string& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(NULL);
+
+    fflush(NULL);
+
+    binary->start = chrono::steady_clock::now();
+    binary->pid = fork();
+    if (binary->pid < 0)
+    {
+        perror("fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return false;
+    }
+
+    if (0 == binary->pid)
+    {
+        /* a timed out executable is killed along with its forked runners. */
+        setpgid(0, 0);
+
+        dup2(pipefd[1], STDOUT_FILENO);
+        dup2(pipefd[1], STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+
+        execv(argv[0], argv.data());
+
+        fprintf(stderr, "Could not run %s: %s.\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+
+    /* set the process group here as well, so that it exists before any kill. */
+    setpgid(binary->pid, binary->pid);
+
+    close(pipefd[1]);
+    binary->fd = pipefd[0];
+    binary->started = true;
+
+    return true;
+}
+
+/**
+ * \brief Read the JSON Lines report of a finished test executable, counting
+ * its tests and failures.
+ *
+ * \param path          The path of the report.
+ * \param binary        The test executable.
+ */
+static void read_binary_report(const string& path, test_binary_t* binary)
+{
+    FILE* in = fopen(path.c_str(), "r");
+    if (NULL == in)
+        return;
+
+    char buffer[4096];
+    string line;
+
+    while (NULL != fgets(buffer, sizeof(buffer), in))
+    {
+        line += buffer;
+        if ('\n' != line.back())
+            continue;
+
+        if ("test_end" == json_member(line, "event"))
+        {
+            ++binary->tests;
+
+            string outcome = json_member(line, "outcome");
+            if ("pass" != outcome)
+            {
+                string suite = json_member(line, "suite");
+                string test = json_member(line, "test");
+                int failure = BINARY_OUTCOME_FAIL;
+
+                if ("crash" == outcome)
+                    failure = BINARY_OUTCOME_CRASH;
+                else if ("timeout" == outcome)
+                    failure = BINARY_OUTCOME_TIMEOUT;
+                else if ("oom" == outcome)
+                    failure = BINARY_OUTCOME_OOM;
+                else if ("cpu_limit" == outcome)
+                    failure = BINARY_OUTCOME_CPU_LIMIT;
+                else if ("fd_leak" == outcome)
+                    failure = BINARY_OUTCOME_FD_LEAK;
+
+                ++binary->failures;
+                binary->failed_tests.push_back(
+                    make_pair(
+                        failure, suite + ("" != suite ? "::" : "") + test));
+            }
+        }
+
+        line.clear();
+    }
+
+    fclose(in);
+}
+
+/**
+ * \brief Record the termination of a test executable.
+ *
+ * \param binary        The test executable.
+ * \param status        Its wait status.
+ * \param timed_out     true if it was killed for running past its timeout.
+ */
+static void finish_binary(test_binary_t* binary, int status, bool timed_out)
+{
+    binary->complete = true;
+    binary->status = status;
+    binary->wall_ns =
+        chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - binary->start).count();
+
+    if (timed_out)
+        binary->outcome = BINARY_OUTCOME_TIMEOUT;
+    else if (WIFSIGNALED(status))
+        binary->outcome = BINARY_OUTCOME_CRASH;
+    else if (!WIFEXITED(status) || 0 != WEXITSTATUS(status))
+        binary->outcome = BINARY_OUTCOME_FAIL;
+    else
+        binary->outcome = BINARY_OUTCOME_PASS;
+}
+
+/**
+ * \brief Describe the outcome of a test executable.
+ *
+ * \param binary        The finished test executable.
+ *
+ * \returns a description of the outcome and the time taken.
+ */
+static string binary_detail(const test_binary_t* binary)
+{
+    char detail[128];
+
+    switch (binary->outcome)
+    {
+        case BINARY_OUTCOME_TIMEOUT:
+            return "after " + format_duration(binary->wall_ns);
+
+        case BINARY_OUTCOME_CRASH:
+            snprintf(
+                detail, sizeof(detail), "signal %d: %s, after ",
+                WTERMSIG(binary->status), strsignal(WTERMSIG(binary->status)));
+            break;
+
+        case BINARY_OUTCOME_FAIL:
+            if (binary->failures > 0)
+            {
+                snprintf(
+                    detail, sizeof(detail), "%u of %u test%s failed, ",
+                    binary->failures, binary->tests,
+                    1 == binary->tests ? "" : "s");
+            }
+            else
+            {
+                snprintf(
+                    detail, sizeof(detail), "exited with status %d, ",
+                    WEXITSTATUS(binary->status));
+            }
+            break;
+
+        default:
+            snprintf(
+                detail, sizeof(detail), "%u test%s, ", binary->tests,
+                1 == binary->tests ? "" : "s");
+            break;
+    }
+
+    return detail + format_duration(binary->wall_ns);
+}
+
+/**
+ * \brief Get the status tag printed for an outcome.
+ *
+ * \param outcome       The outcome of a test executable.
+ *
+ * \returns the status tag.
+ */
+static const char* outcome_tag(int outcome)
+{
+    switch (outcome)
+    {
+        case BINARY_OUTCOME_PASS:
+            return "       OK ";
+
+        case BINARY_OUTCOME_CRASH:
+            return "  CRASH   ";
+
+        case BINARY_OUTCOME_TIMEOUT:
+            return " TIMEOUT  ";
+
+        case BINARY_OUTCOME_OOM:
+            return "   OOM    ";
+
+        case BINARY_OUTCOME_CPU_LIMIT:
+            return "CPU-LIMIT ";
+
+        case BINARY_OUTCOME_FD_LEAK:
+            return " FD-LEAK  ";
+
+        default:
+            return "   FAIL   ";
+    }
+}
+
+/**
+ * \brief Get the type of a failure, as written to the JUnit report.
+ *
+ * \param outcome       The outcome of a failed test executable.
+ *
+ * \returns the type of the failure.
+ */
+static const char* outcome_type(int outcome)
+{
+    switch (outcome)
+    {
+        case BINARY_OUTCOME_CRASH:
+            return "CRASH";
+
+        case BINARY_OUTCOME_TIMEOUT:
+            return "TIMEOUT";
+
+        case BINARY_OUTCOME_OOM:
+            return "OOM";
+
+        case BINARY_OUTCOME_CPU_LIMIT:
+            return "CPU-LIMIT";
+
+        case BINARY_OUTCOME_FD_LEAK:
+            return "FD-LEAK";
+
+        default:
+            return "FAIL";
+    }
+}
+
+/**
+ * \brief Get the name of an outcome, as written to the reports.
+ *
+ * \param outcome       The outcome of a test executable.
+ *
+ * \returns the name of the outcome.
+ */
+static const char* outcome_name(int outcome)
+{
+    switch (outcome)
+    {
+        case BINARY_OUTCOME_PASS:
+            return "pass";
+
+        case BINARY_OUTCOME_CRASH:
+            return "crash";
+
+        case BINARY_OUTCOME_TIMEOUT:
+            return "timeout";
+
+        case BINARY_OUTCOME_OOM:
+            return "oom";
+
+        case BINARY_OUTCOME_CPU_LIMIT:
+            return "cpu_limit";
+
+        case BINARY_OUTCOME_FD_LEAK:
+            return "fd_leak";
+
+        default:
+            return "fail";
+    }
+}
+
+/**
+ * \brief Print the captured output and status line of a finished test
+ * executable.
+ *
+ * \param options       The driver options.
+ * \param binary        The test executable.
+ */
+static void print_binary(
+    const driver_options_t* options, const test_binary_t* binary)
+{
+    bool pass = BINARY_OUTCOME_PASS == binary->outcome;
+
+    if (!binary->output.empty() && !(pass && options->quiet_pass))
+    {
+        fwrite(binary->output.data(), 1, binary->output.size(), stdout);
+
+        if ('\n' != binary->output.back())
+            fputc('\n', stdout);
+    }
+
+    set_color(options, pass ? DRIVER_COLOR_GREEN : DRIVER_COLOR_RED);
+    printf("[%s]", outcome_tag(binary->outcome));
+    set_color(options, DRIVER_COLOR_NORMAL);
+    printf(" Binary %s (%s)\n",
+           binary->path.c_str(), binary_detail(binary).c_str());
+    fflush(stdout);
+}
+
+/**
+ * \brief Append the report of a test executable to the merged JSON Lines
+ * report, with the executable added to each event.
+ *
+ * \param out           The merged report.
+ * \param path          The path of the report of the test executable.
+ * \param binary        The test executable.
+ */
+static void merge_jsonl_report(
+    FILE* out, const string& path, const test_binary_t* binary)
+{
+    fputs("{\"event\":\"binary_start\",\"binary\":", out);
+    write_json_string(out, binary->path);
+    fputs("}\n", out);
+
+    FILE* in = fopen(path.c_str(), "r");
+    if (NULL != in)
+    {
+        char buffer[4096];
+        bool line_start = true;
+
+        while (NULL != fgets(buffer, sizeof(buffer), in))
+        {
+            if (line_start && '{' == buffer[0])
+            {
+                fputs("{\"binary\":", out);
+                write_json_string(out, binary->path);
+                fputs(",", out);
+                fputs(buffer + 1, out);
+            }
+            else
+            {
+                fputs(buffer, out);
+            }
+
+            line_start = '\n' == buffer[strlen(buffer) - 1];
+        }
+
+        /* a report cut short by a crash must still end its last line. */
+        if (!line_start)
+            fputc('\n', out);
+
+        fclose(in);
+    }
+
+    fputs("{\"event\":\"binary_end\",\"binary\":", out);
+    write_json_string(out, binary->path);
+    fprintf(out,
+            ",\"outcome\":\"%s\",\"wall_ns\":%llu,\"tests\":%u,"
+            "\"failures\":%u}\n",
+            outcome_name(binary->outcome),
+            (unsigned long long)binary->wall_ns, binary->tests,
+            binary->failures);
+}
+
+/**
+ * \brief Append the report of a test executable to the merged JUnit report.
+ *
+ * The testsuite elements of the executable's report are copied, tagged with
+ * the executable as their package.  A report cut short by a crash is copied up
+ * to its last complete testsuite element.  If the executable failed without
+ * any of its tests failing, a testsuite for the executable itself records the
+ * failure.
+ *
+ * \param out           The merged report.
+ * \param path          The path of the report of the test executable.
+ * \param binary        The test executable.
+ */
+static void merge_junit_report(
+    FILE* out, const string& path, const test_binary_t* binary)
+{
+    string report;
+    FILE* in = fopen(path.c_str(), "r");
+
+    if (NULL != in)
+    {
+        char buffer[4096];
+        size_t size;
+
+        while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            report.append(buffer, size);
+
+        fclose(in);
+    }
+
+    size_t begin = report.find("<testsuites>\n");
+    size_t end = report.rfind("</testsuite>\n");
+
+    if (string::npos != begin && string::npos != end && begin < end)
+    {
+        begin += strlen("<testsuites>\n");
+        end += strlen("</testsuite>\n");
+
+        /* tag each testsuite with the executable that ran it. */
+        const char* tag = "<testsuite ";
+        size_t pos = begin;
+        size_t found;
+
+        while (string::npos != (found = report.find(tag, pos)) && found < end)
+        {
+            fwrite(report.data() + pos, 1, found - pos, out);
+            fputs("<testsuite package=\"", out);
+            write_xml_text(out, binary->path);
+            fputs("\" ", out);
+            pos = found + strlen(tag);
+        }
+
+        fwrite(report.data() + pos, 1, end - pos, out);
+    }
+
+    if (BINARY_OUTCOME_PASS != binary->outcome && 0 == binary->failures)
+    {
+        fputs("  <testsuite package=\"", out);
+        write_xml_text(out, binary->path);
+        fputs("\" name=\"", out);
+        write_xml_text(out, binary->path);
+        fputs("\">\n    <testcase classname=\"", out);
+        write_xml_text(out, binary->path);
+        fprintf(out,
+                "\" name=\"binary\" time=\"%.6f\">\n"
+                "      <%s type=\"%s\" message=\"",
+                binary->wall_ns / 1e9,
+                BINARY_OUTCOME_FAIL == binary->outcome ? "failure" : "error",
+                outcome_type(binary->outcome));
+        write_xml_text(out, binary_detail(binary));
+        fprintf(out,
+                "\"/>\n    </testcase>\n  </testsuite>\n");
+    }
+}
+
+/**
+ * \brief Kill a test executable and its forked test runners.
+ *
+ * \param binary        The test executable.
+ */
+static void kill_binary(test_binary_t* binary)
+{
+    kill(-binary->pid, SIGKILL);
+    kill(binary->pid, SIGKILL);
+}
+
+/**
+ * \brief Run every test executable, printing each result in order as soon as
+ * it and every executable before it have finished.
+ *
+ * \param options       The driver options.
+ * \param tmpdir        The temporary directory holding the reports.
+ * \param binaries      The test executables.
+ */
+static void run_binaries(
+    const driver_options_t* options, const string& tmpdir,
+    vector<test_binary_t>* binaries)
+{
+    size_t next = 0;
+    size_t reported = 0;
+    size_t running = 0;
+
+    while (reported < binaries->size())
+    {
+        /* start executables up to the job limit. */
+        while (running < options->jobs && next < binaries->size())
+        {
+            test_binary_t* binary = &(*binaries)[next];
+
+            if (start_binary(options, tmpdir, next, binary))
+            {
+                ++running;
+            }
+            else
+            {
+                binary->complete = true;
+                binary->outcome = BINARY_OUTCOME_FAIL;
+                binary->status = 127 << 8;
+            }
+
+            ++next;
+        }
+
+        /* report, in order, whatever has finished. */
+        while (reported < binaries->size() && (*binaries)[reported].complete)
+        {
+            test_binary_t* binary = &(*binaries)[reported];
+            if (binary->started)
+            {
+                read_binary_report(
+                    report_path(tmpdir, reported, ".jsonl"), binary);
+
+                /* a failing run without a failed test is its own failure. */
+                if (BINARY_OUTCOME_PASS != binary->outcome
+                 && 0 == binary->failures)
+                {
+                    binary->failed_tests.push_back(
+                        make_pair(binary->outcome, string()));
+                }
+            }
+
+            print_binary(options, binary);
+            binary->reported = true;
+            ++reported;
+        }
+
+        if (0 == running)
+            continue;
+
+        /* wait for output from the running executables, or a deadline. */
+        vector<struct pollfd> fds;
+        vector<test_binary_t*> polled;
+        auto now = chrono::steady_clock::now();
+        int wait_ms = -1;
+
+        for (size_t i = 0; i < next; ++i)
+        {
+            test_binary_t* binary = &(*binaries)[i];
+            if (!binary->started || binary->complete)
+                continue;
+
+            if (options->timeout > 0)
+            {
+                auto remaining =
+                    chrono::duration_cast<chrono::milliseconds>(
+                        binary->start
+                      + chrono::milliseconds(options->timeout) - now).count();
+                int remaining_ms = (int)max((decltype(remaining))0, remaining);
+
+                if (wait_ms < 0 || remaining_ms < wait_ms)
+                    wait_ms = remaining_ms;
+            }
+
+            /* an executable that closed its output is polled for its exit. */
+            if (binary->fd < 0)
+            {
+                if (wait_ms < 0 || wait_ms > 10)
+                    wait_ms = 10;
+                continue;
+            }
+
+            struct pollfd fd = { binary->fd, POLLIN, 0 };
+            fds.push_back(fd);
+            polled.push_back(binary);
+        }
+
+        if (poll(fds.data(), fds.size(), wait_ms) < 0 && EINTR != errno)
+        {
+            perror("poll");
+            exit(1);
+        }
+
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            if (0 == fds[i].revents)
+                continue;
+
+            test_binary_t* binary = polled[i];
+            char buffer[65536];
+            ssize_t size = read(binary->fd, buffer, sizeof(buffer));
+
+            if (size > 0)
+            {
+                binary->output.append(buffer, size);
+            }
+            else if (0 == size || EINTR != errno)
+            {
+                close(binary->fd);
+                binary->fd = -1;
+            }
+        }
+
+        /* collect the executables that have exited or run out of time. */
+        now = chrono::steady_clock::now();
+        for (size_t i = 0; i < next; ++i)
+        {
+            test_binary_t* binary = &(*binaries)[i];
+            if (!binary->started || binary->complete)
+                continue;
+
+            bool timed_out =
+                options->timeout > 0
+             && now >= binary->start + chrono::milliseconds(options->timeout);
+            int status;
+
+            if (timed_out)
+            {
+                kill_binary(binary);
+                waitpid(binary->pid, &status, 0);
+            }
+            else if (binary->fd >= 0
+                  || binary->pid != waitpid(binary->pid, &status, WNOHANG))
+            {
+                continue;
+            }
+
+            if (binary->fd >= 0)
+            {
+                close(binary->fd);
+                binary->fd = -1;
+            }
+
+            finish_binary(binary, status, timed_out);
+            --running;
+        }
+    }
+}
+
+/**
+ * \brief Determine whether a file is an executable regular file.
+ *
+ * \param path          The path of the file.
+ *
+ * \returns true if the file is an executable regular file.
+ */
+static bool is_executable(const string& path)
+{
+    struct stat st;
+
+    return
+        0 == stat(path.c_str(), &st) && S_ISREG(st.st_mode)
+     && 0 == access(path.c_str(), X_OK);
+}
+
+/**
+ * \brief Find the test executables in a directory tree.
+ *
+ * \param dir           The directory to search.
+ * \param pattern       The pattern that the name of a test executable
+ *                      matches.
+ * \param binaries      The paths of the test executables found.
+ */
+static void discover_binaries(
+    const string& dir, const char* pattern, vector<string>* binaries)
+{
+    DIR* d = opendir(dir.c_str());
+    if (NULL == d)
+    {
+        fprintf(stderr, "Could not read directory %s: %s.\n",
+                dir.c_str(), strerror(errno));
+        exit(1);
+    }
+
+    vector<string> subdirs;
+    struct dirent* entry;
+
+    while (NULL != (entry = readdir(d)))
+    {
+        if ('.' == entry->d_name[0])
+            continue;
+
+        string path = dir + "/" + entry->d_name;
+        struct stat st;
+
+        if (0 != stat(path.c_str(), &st))
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+            subdirs.push_back(path);
+        else if (0 == fnmatch(pattern, entry->d_name, 0)
+              && is_executable(path))
+            binaries->push_back(path);
+    }
+
+    closedir(d);
+
+    for (const string& subdir : subdirs)
+        discover_binaries(subdir, pattern, binaries);
+}
+
+/**
+ * \brief Parse a non-negative count option.
+ *
+ * \param name          The name of the option, for error reporting.
+ * \param value         The count to parse.
+ *
+ * \returns the count.
+ */
+static unsigned int parse_count(const char* name, const char* value)
+{
+    char* end = nullptr;
+    long count = strtol(value, &end, 10);
+
+    if ('\0' == *value || '\0' != *end || count < 0)
+    {
+        fprintf(stderr, "Invalid %s %s.\n", name, value);
+        exit(1);
+    }
+
+    return (unsigned int)count;
+}
+
+/**
+ * \brief Parse a job count.
+ *
+ * \param value         The job count to parse.
+ *
+ * \returns the job count, where 0 selects one job per online processor.
+ */
+static unsigned int parse_job_count(const char* value)
+{
+    long jobs = parse_count("job count", value);
+
+    if (0 == jobs)
+    {
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+        if (jobs < 1)
+            jobs = 1;
+    }
+
+    return (unsigned int)jobs;
+}
+
+/**
+ * \brief Parse a duration option.
+ *
+ * The duration is in seconds unless it ends with one of the suffixes "ms",
+ * "s", "m", or "h".
+ *
+ * \param name          The name of the option, for error reporting.
+ * \param value         The duration to parse.
+ *
+ * \returns the duration in milliseconds.
+ */
+static unsigned int parse_duration(const char* name, const char* value)
+{
+    char* end = nullptr;
+    double duration = strtod(value, &end);
+    double scale = 1000.0;
+
+    if (!strcmp(end, "ms"))
+        scale = 1.0;
+    else if (!strcmp(end, "s") || !strcmp(end, ""))
+        scale = 1000.0;
+    else if (!strcmp(end, "m"))
+        scale = 60.0 * 1000.0;
+    else if (!strcmp(end, "h"))
+        scale = 60.0 * 60.0 * 1000.0;
+    else
+        end = nullptr;
+
+    if (end == value || nullptr == end || !(duration >= 0.0)
+     || duration * scale > (double)UINT32_MAX)
+    {
+        fprintf(stderr, "Invalid %s %s.\n", name, value);
+        exit(1);
+    }
+
+    return (unsigned int)(duration * scale);
+}
+
+/**
+ * \brief Parse a report specification of the form "NAME:FILE".
+ *
+ * \param options       The driver options to update.
+ * \param spec          The report specification.
+ */
+static void parse_reporter(driver_options_t* options, const char* spec)
+{
+    if (0 == strncmp(spec, "jsonl:", 6) && '\0' != spec[6])
+        options->jsonl_report = spec + 6;
+    else if (0 == strncmp(spec, "junit:", 6) && '\0' != spec[6])
+        options->junit_report = spec + 6;
+    else
+    {
+        fprintf(stderr, "Invalid reporter %s.\n", spec);
+        exit(1);
+    }
+}
+
+static void handle_driver_arguments(
+    driver_options_t* options, int argc, char* argv[])
+{
+    vector<string> dirs;
+    const char* pattern = "test*";
+
+    options->jobs = parse_job_count("0");
+    options->timeout = 0;
+    options->quiet_pass = false;
+    options->color = running_in_color_terminal();
+    options->jsonl_report = NULL;
+    options->junit_report = NULL;
+
+    const char* timeout = getenv("MINUNIT_TIMEOUT");
+    if (NULL != timeout && strcmp(timeout, ""))
+    {
+        options->timeout = parse_duration("timeout", timeout);
+    }
+
+    int argi = 1;
+    for (; argi < argc; ++argi)
+    {
+        string arg = argv[argi];
+
+        if ("--" == arg)
+        {
+            ++argi;
+            break;
+        }
+        else if ('-' != arg[0])
+        {
+            options->binaries.push_back(arg);
+        }
+        else if ("-j" == arg)
+        {
+            if (argi + 1 >= argc)
+            {
+                fprintf(stderr, "Missing job count for -j.\n");
+                exit(1);
+            }
+
+            options->jobs = parse_job_count(argv[++argi]);
+        }
+        else if (0 == arg.compare(0, 2, "-j"))
+        {
+            options->jobs = parse_job_count(arg.c_str() + 2);
+        }
+        else if (0 == arg.compare(0, 7, "--jobs="))
+        {
+            options->jobs = parse_job_count(arg.c_str() + 7);
+        }
+        else if (0 == arg.compare(0, 10, "--timeout="))
+        {
+            options->timeout = parse_duration("timeout", arg.c_str() + 10);
+        }
+        else if (0 == arg.compare(0, 11, "--discover="))
+        {
+            dirs.push_back(arg.substr(11));
+        }
+        else if (0 == arg.compare(0, 10, "--pattern="))
+        {
+            pattern = argv[argi] + 10;
+        }
+        else if ("--quiet-pass" == arg)
+        {
+            options->quiet_pass = true;
+        }
+        else if (0 == arg.compare(0, 11, "--reporter="))
+        {
+            parse_reporter(options, argv[argi] + 11);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s.\n", arg.c_str());
+            exit(1);
+        }
+    }
+
+    /* the remaining arguments are passed to every test executable. */
+    for (; argi < argc; ++argi)
+    {
+        options->arguments.push_back(argv[argi]);
+    }
+
+    for (const string& dir : dirs)
+    {
+        vector<string> found;
+        discover_binaries(dir, pattern, &found);
+        sort(found.begin(), found.end());
+
+        options->binaries.insert(
+            options->binaries.end(), found.begin(), found.end());
+    }
+
+    if (options->binaries.empty())
+    {
+        fprintf(stderr, "No test executables to run.\n");
+        exit(1);
+    }
+
+    if (0 == options->jobs)
+    {
+        options->jobs = 1;
+    }
+}
+
+/**
+ * \brief Print the merged summary of every test executable.
+ *
+ * \param options       The driver options.
+ * \param binaries      The finished test executables.
+ *
+ * \returns the number of failed test executables.
+ */
+static unsigned int print_summary(
+    const driver_options_t* options, const vector<test_binary_t>& binaries)
+{
+    unsigned int tests = 0;
+    unsigned int failed = 0;
+
+    for (const test_binary_t& binary : binaries)
+    {
+        tests += binary.tests;
+        if (BINARY_OUTCOME_PASS != binary.outcome)
+            ++failed;
+    }
+
+    printf("\n[%s] Driver Summary \n", "==========");
+
+    if (0 == failed)
+    {
+        set_color(options, DRIVER_COLOR_GREEN);
+        printf("[%s]", "       OK ");
+        set_color(options, DRIVER_COLOR_NORMAL);
+        printf(" All binaries passed (%zu / %zu), %u test%s.\n",
+               binaries.size(), binaries.size(), tests, 1 == tests ? "" : "s");
+    }
+    else
+    {
+        printf("[%s] Encountered %u failing binar%s:\n",
+               "----------", failed, 1 == failed ? "y" : "ies");
+
+        for (const test_binary_t& binary : binaries)
+        {
+            if (BINARY_OUTCOME_PASS == binary.outcome)
+                continue;
+
+            for (const auto& test : binary.failed_tests)
+            {
+                set_color(options, DRIVER_COLOR_RED);
+                printf("[%s]", outcome_tag(test.first));
+                set_color(options, DRIVER_COLOR_NORMAL);
+                printf(" %s%s%s\n",
+                       binary.path.c_str(), "" == test.second ? "" : ": ",
+                       test.second.c_str());
+            }
+        }
+    }
+
+    printf("[%s]\n", "----------");
+    fflush(stdout);
+
+    return failed;
+}
+
+int main(int argc, char* argv[])
+{
+    driver_options_t options;
+    handle_driver_arguments(&options, argc, argv);
+
+    /* reports of the test executables are kept until they are merged. */
+    const char* tmp = getenv("TMPDIR");
+    string tmpdir =
+        string(NULL != tmp && strcmp(tmp, "") ? tmp : "/tmp")
+      + "/minunit-driver.XXXXXX";
+    if (NULL == mkdtemp(&tmpdir[0]))
+    {
+        fprintf(stderr, "Could not create a temporary directory: %s.\n",
+                strerror(errno));
+        return 1;
+    }
+
+    FILE* jsonl = NULL;
+    FILE* junit = NULL;
+
+    if (NULL != options.jsonl_report
+     && NULL == (jsonl = fopen(options.jsonl_report, "w")))
+    {
+        fprintf(stderr, "Could not open report %s: %s.\n",
+                options.jsonl_report, strerror(errno));
+        return 1;
+    }
+
+    if (NULL != options.junit_report
+     && NULL == (junit = fopen(options.junit_report, "w")))
+    {
+        fprintf(stderr, "Could not open report %s: %s.\n",
+                options.junit_report, strerror(errno));
+        return 1;
+    }
+
+    vector<test_binary_t> binaries(options.binaries.size());
+    for (size_t i = 0; i < binaries.size(); ++i)
+    {
+        binaries[i].path = options.binaries[i];
+        binaries[i].fd = -1;
+    }
+
+    printf("[%s] Running %zu binar%s with %u job%s.\n",
+           "==========", binaries.size(), 1 == binaries.size() ? "y" : "ies",
+           options.jobs, 1 == options.jobs ? "" : "s");
+
+    /* a test executable which closes its pipe must not kill the driver. */
+    signal(SIGPIPE, SIG_IGN);
+
+    run_binaries(&options, tmpdir, &binaries);
+
+    unsigned int failed = print_summary(&options, binaries);
+
+    if (NULL != jsonl)
+    {
+        for (size_t i = 0; i < binaries.size(); ++i)
+        {
+            merge_jsonl_report(
+                jsonl, report_path(tmpdir, i, ".jsonl"), &binaries[i]);
+        }
+
+        fprintf(jsonl,
+                "{\"event\":\"driver_end\",\"binaries\":%zu,"
+                "\"failed_binaries\":%u}\n",
+                binaries.size(), failed);
+        fclose(jsonl);
+    }
+
+    if (NULL != junit)
+    {
+        fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n",
+              junit);
+
+        for (size_t i = 0; i < binaries.size(); ++i)
+        {
+            merge_junit_report(
+                junit, report_path(tmpdir, i, ".xml"), &binaries[i]);
+        }
+
+        fputs("</testsuites>\n", junit);
+        fclose(junit);
+    }
+
+    for (size_t i = 0; i < binaries.size(); ++i)
+    {
+        unlink(report_path(tmpdir, i, ".jsonl").c_str());
+        unlink(report_path(tmpdir, i, ".xml").c_str());
+    }
+
+    rmdir(tmpdir.c_str());
+
+    return 0 == failed ? 0 : 1;
+}
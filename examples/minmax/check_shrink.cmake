@@ -0,0 +1,13 @@
+#run the failing shrink property, and check that it was shrunk to its minimal
+#counterexample.
+execute_process(COMMAND ${SHRINK_TEST} OUTPUT_VARIABLE OUTPUT
+                ERROR_VARIABLE OUTPUT RESULT_VARIABLE RESULT)
+
+if (RESULT EQUAL 0)
+    message(FATAL_ERROR "The shrink property passed.\n${OUTPUT}")
+endif()
+
+if (NOT OUTPUT MATCHES "TEST_GEN_INT\\(0, 1000000\\) = 1000\n"
+ OR NOT OUTPUT MATCHES "TEST_GEN_STRING\\(0, 20\\) = \"\"\n")
+    message(FATAL_ERROR "The shrink property was not minimal.\n${OUTPUT}")
+endif()
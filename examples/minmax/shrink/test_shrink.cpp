@@ -0,0 +1,23 @@
+/**
+ * \file examples/minmax/shrink/test_shrink.cpp
+ *
+ * A property of example_max which fails on purpose, so that the shrunk
+ * counterexample can be checked.
+ */
+
+#include <minunit/minunit.h>
+
+#include "../src/minmax.h"
+
+#include <string.h>
+
+TEST_SUITE(shrink);
+
+/* the minimal counterexample is x = 1000 and an empty string. */
+TEST_PROPERTY(max_below_1000, 1000)
+{
+    int64_t x = TEST_GEN_INT(0, 1000000);
+    const char* s = TEST_GEN_STRING(0, 20);
+
+    TEST_ASSERT(example_max(x, (int64_t)strlen(s)) < 1000);
+}
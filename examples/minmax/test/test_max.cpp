@@ -9,9 +9,18 @@
 #include "../src/minmax.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 TEST_SUITE(max);
 
+TEST(no_heap)
+{
+    TEST_EXPECT_MAX_ALLOCS(0);
+    TEST_EXPECT_NO_LEAKS();
+
+    TEST_EXPECT(44 == example_max(-55, 44));
+}
+
 TEST(positive)
 {
     int64_t x = 44;
@@ -29,3 +38,14 @@ TEST(negative)
     TEST_EXPECT(x == example_max(x, y));
     TEST_EXPECT(x == example_max(y, x));
 }
+
+TEST_FUZZ(bytes, data, size)
+{
+    int64_t xy[2] = { 0, 0 };
+    memcpy(xy, data, size < sizeof(xy) ? size : sizeof(xy));
+
+    int64_t z = example_max(xy[0], xy[1]);
+
+    TEST_ASSERT(z >= xy[0] && z >= xy[1]);
+    TEST_ASSERT(z == xy[0] || z == xy[1]);
+}
@@ -27,3 +27,36 @@ TEST(negative)
     TEST_EXPECT(y == example_min(x, y));
     TEST_EXPECT(y == example_min(y, x));
 }
+
+/**
+ * \brief Pairs of inputs, and the minimum of each pair.
+ */
+static const struct min_case
+{
+    int64_t x;
+    int64_t y;
+    int64_t expected;
+} min_cases[] = {
+    { 44, 55, 44 },
+    { -44, -55, -55 },
+    { -44, 55, -44 },
+    { 7, 7, 7 },
+};
+
+TEST_P(table, min_cases)
+{
+    const struct min_case* param = TEST_PARAM();
+
+    TEST_EXPECT_EQ(param->expected, example_min(param->x, param->y));
+    TEST_EXPECT_EQ(param->expected, example_min(param->y, param->x));
+}
+
+TEST_PROPERTY(lower_bound, 1000)
+{
+    int64_t x = TEST_GEN_INT(INT64_MIN, INT64_MAX);
+    int64_t y = TEST_GEN_INT(INT64_MIN, INT64_MAX);
+    int64_t z = example_min(x, y);
+
+    TEST_ASSERT(z <= x && z <= y);
+    TEST_ASSERT(z == x || z == y);
+}
@@ -0,0 +1,314 @@
+/**
+ * \file heap/minunit_heap_shim.cpp
+ *
+ * \brief Heap shim, which interposes malloc and its relatives to count every
+ * allocation in the process.
+ *
+ * The shim forwards each call to the next definition of the function, which is
+ * normally the C library's allocator, and then updates its counters.  While
+ * the next definitions are being looked up, the lookup itself may allocate, so
+ * those allocations are served from a small static arena instead.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <malloc.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+#define MINUNIT_HEAP_SHIM
+#include "minunit_heap.h"
+
+using namespace std;
+
+typedef void* (*malloc_func_t)(size_t);
+typedef void* (*calloc_func_t)(size_t, size_t);
+typedef void* (*realloc_func_t)(void*, size_t);
+typedef void (*free_func_t)(void*);
+typedef void* (*memalign_func_t)(size_t, size_t);
+typedef int (*posix_memalign_func_t)(void**, size_t, size_t);
+
+static malloc_func_t real_malloc;
+static calloc_func_t real_calloc;
+static realloc_func_t real_realloc;
+static free_func_t real_free;
+static memalign_func_t real_memalign;
+static memalign_func_t real_aligned_alloc;
+static posix_memalign_func_t real_posix_memalign;
+
+/**
+ * \brief Size of the arena serving allocations made while looking up the next
+ * definitions.
+ */
+#define BOOTSTRAP_ARENA_SIZE 4096
+
+alignas(16) static char bootstrap_arena[BOOTSTRAP_ARENA_SIZE];
+static size_t bootstrap_used;
+static bool bootstrapping;
+
+static atomic<uint64_t> allocations;
+static atomic<uint64_t> bytes;
+static atomic<uint64_t> live_blocks;
+static atomic<uint64_t> live_bytes;
+static atomic<uint64_t> peak_bytes;
+
+/**
+ * \brief Look up the next definition of each interposed function.
+ */
+static void resolve_allocator()
+{
+    if (NULL != real_free || bootstrapping)
+    {
+        return;
+    }
+
+    bootstrapping = true;
+
+    real_malloc = (malloc_func_t)dlsym(RTLD_NEXT, "malloc");
+    real_calloc = (calloc_func_t)dlsym(RTLD_NEXT, "calloc");
+    real_realloc = (realloc_func_t)dlsym(RTLD_NEXT, "realloc");
+    real_memalign = (memalign_func_t)dlsym(RTLD_NEXT, "memalign");
+    real_aligned_alloc = (memalign_func_t)dlsym(RTLD_NEXT, "aligned_alloc");
+    real_posix_memalign =
+        (posix_memalign_func_t)dlsym(RTLD_NEXT, "posix_memalign");
+    real_free = (free_func_t)dlsym(RTLD_NEXT, "free");
+
+    bootstrapping = false;
+}
+
+/**
+ * \brief Look up the next definitions as soon as the shim is loaded, before
+ * the process starts any threads.
+ */
+__attribute__((constructor)) static void init_allocator()
+{
+    resolve_allocator();
+}
+
+/**
+ * \brief Allocate from the bootstrap arena.
+ *
+ * \param size          The size of the allocation.
+ *
+ * \returns the allocation, which is zeroed, or NULL if the arena is exhausted.
+ */
+static void* bootstrap_alloc(size_t size)
+{
+    size = (size + 15) & ~(size_t)15;
+
+    if (size > BOOTSTRAP_ARENA_SIZE - bootstrap_used)
+    {
+        return NULL;
+    }
+
+    void* ptr = bootstrap_arena + bootstrap_used;
+    bootstrap_used += size;
+
+    return ptr;
+}
+
+/**
+ * \brief Determine whether a block was allocated from the bootstrap arena.
+ *
+ * \param ptr           The block.
+ *
+ * \returns true if the block is in the bootstrap arena.
+ */
+static bool bootstrap_owns(const void* ptr)
+{
+    return
+        (const char*)ptr >= bootstrap_arena
+     && (const char*)ptr < bootstrap_arena + BOOTSTRAP_ARENA_SIZE;
+}
+
+/**
+ * \brief Count an allocated block.
+ *
+ * \param ptr           The block, or NULL if the allocation failed.
+ */
+static void count_alloc(void* ptr)
+{
+    if (NULL == ptr)
+    {
+        return;
+    }
+
+    uint64_t size = malloc_usable_size(ptr);
+
+    allocations.fetch_add(1, memory_order_relaxed);
+    bytes.fetch_add(size, memory_order_relaxed);
+    live_blocks.fetch_add(1, memory_order_relaxed);
+
+    uint64_t live = live_bytes.fetch_add(size, memory_order_relaxed) + size;
+    uint64_t peak = peak_bytes.load(memory_order_relaxed);
+
+    while (live > peak
+        && !peak_bytes.compare_exchange_weak(
+                peak, live, memory_order_relaxed))
+    {
+    }
+}
+
+/**
+ * \brief Count a block about to be freed.
+ *
+ * \param ptr           The block.
+ */
+static void count_free(void* ptr)
+{
+    uint64_t size = malloc_usable_size(ptr);
+
+    live_blocks.fetch_sub(1, memory_order_relaxed);
+    live_bytes.fetch_sub(size, memory_order_relaxed);
+}
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    resolve_allocator();
+    if (NULL == real_malloc)
+        return bootstrap_alloc(size);
+
+    void* ptr = real_malloc(size);
+    count_alloc(ptr);
+
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size)
+{
+    resolve_allocator();
+    if (NULL == real_calloc)
+    {
+        if (0 != size && count > (size_t)-1 / size)
+            return NULL;
+
+        return bootstrap_alloc(count * size);
+    }
+
+    void* ptr = real_calloc(count, size);
+    count_alloc(ptr);
+
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    resolve_allocator();
+
+    if (bootstrap_owns(ptr) || NULL == real_realloc)
+    {
+        void* moved =
+            NULL == real_malloc ? bootstrap_alloc(size) : malloc(size);
+        if (NULL != moved && NULL != ptr)
+        {
+            size_t available =
+                bootstrap_arena + BOOTSTRAP_ARENA_SIZE - (char*)ptr;
+            memcpy(moved, ptr, size < available ? size : available);
+        }
+
+        return moved;
+    }
+
+    if (NULL == ptr)
+    {
+        return malloc(size);
+    }
+
+    /* the old block is counted as freed only if it is released. */
+    uint64_t old_size = malloc_usable_size(ptr);
+    void* moved = real_realloc(ptr, size);
+
+    if (NULL != moved || 0 == size)
+    {
+        live_blocks.fetch_sub(1, memory_order_relaxed);
+        live_bytes.fetch_sub(old_size, memory_order_relaxed);
+        count_alloc(moved);
+    }
+
+    return moved;
+}
+
+void free(void* ptr)
+{
+    if (NULL == ptr || bootstrap_owns(ptr))
+    {
+        return;
+    }
+
+    resolve_allocator();
+
+    count_free(ptr);
+    real_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    resolve_allocator();
+    if (NULL == real_memalign)
+        return NULL;
+
+    void* ptr = real_memalign(alignment, size);
+    count_alloc(ptr);
+
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    resolve_allocator();
+    if (NULL == real_aligned_alloc)
+        return NULL;
+
+    void* ptr = real_aligned_alloc(alignment, size);
+    count_alloc(ptr);
+
+    return ptr;
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    resolve_allocator();
+    if (NULL == real_posix_memalign)
+        return ENOMEM;
+
+    int retval = real_posix_memalign(ptr, alignment, size);
+    if (0 == retval)
+        count_alloc(*ptr);
+
+    return retval;
+}
+
+/**
+ * \brief Read the counters of the heap shim.
+ *
+ * \param counters      The counters to populate.
+ */
+void minunit_heap_read(minunit_heap_counters_t* counters)
+{
+    counters->allocations = allocations.load(memory_order_relaxed);
+    counters->bytes = bytes.load(memory_order_relaxed);
+    counters->live_blocks = live_blocks.load(memory_order_relaxed);
+    counters->live_bytes = live_bytes.load(memory_order_relaxed);
+    counters->peak_bytes = peak_bytes.load(memory_order_relaxed);
+}
+
+/**
+ * \brief Reset the peak of the heap shim to the bytes currently live.
+ */
+void minunit_heap_reset_peak()
+{
+    peak_bytes.store(
+        live_bytes.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+}
@@ -15,7 +15,9 @@ extern "C" {
 #endif /*__cplusplus*/
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 /**
  * \brief Enumeration for supported terminal colors.
@@ -33,6 +35,40 @@ enum minunit_terminal_colors
  */
 typedef void (*terminal_set_color_func_t)(int color);
 
+/**
+ * \brief Enumeration of the orders in which tests can be run.
+ */
+enum minunit_test_order
+{
+    MINUNIT_TEST_ORDER_REGISTRATION,
+    MINUNIT_TEST_ORDER_DURATION,
+    MINUNIT_TEST_ORDER_SHUFFLE
+};
+
+/**
+ * \brief Enumeration of the transports carrying results from forked test
+ * runners.
+ */
+enum minunit_test_transport
+{
+    MINUNIT_TEST_TRANSPORT_SOCKET,
+    MINUNIT_TEST_TRANSPORT_RING
+};
+
+/**
+ * \brief Resource limits of the forked process running a test: its address
+ * space in bytes, its CPU time in seconds, the number of descriptors it may
+ * open, and the bytes of its captured output which are reported.  A limit of
+ * 0 is not applied.
+ */
+typedef struct minunit_test_limits
+{
+    uint64_t memory;
+    unsigned int cpu;
+    unsigned int files;
+    uint64_t output;
+} minunit_test_limits_t;
+
 /**
  * \brief Global test options.
  */
@@ -41,16 +77,301 @@ typedef struct minunit_test_options
     terminal_set_color_func_t terminal_set_color;
     const char* test_suite;
     const char* test;
+    unsigned int jobs;
+    unsigned int slowest;
+    unsigned int timeout;
+    unsigned int benchmark_time;
+    unsigned int benchmark_samples;
+    unsigned int repetitions;
+    const char* save_timings;
+    const char* baseline;
+    unsigned int regression_threshold;
+    unsigned int order;
+    const char* duration_cache;
+    unsigned int shard_index;
+    unsigned int shard_count;
+    const char* shard_durations;
+    bool zygote;
+    bool quiet_pass;
+    unsigned int transport;
+    const char* const* reporters;
+    unsigned int reporter_count;
+    bool perf_counters;
+    bool in_process;
+    unsigned int repeat;
+    bool until_fail;
+    uint64_t shuffle_seed;
+    const char* save_coverage;
+    const char* coverage_index;
+    const char* changed_files;
+    const char* changed_lines;
+    uint64_t property_seed;
+    const char* fuzz;
+    unsigned int fuzz_time;
+    const char* corpus;
+    minunit_test_limits_t limits;
 } minunit_test_options_t;
 
 /**
- * \brief Simple test context that exposes a pass or fail flag.
+ * \brief Enumeration of the heap expectations a test can set.
+ */
+enum minunit_heap_check
+{
+    MINUNIT_HEAP_CHECK_MAX_ALLOCATIONS  = 1,
+    MINUNIT_HEAP_CHECK_NO_LEAKS         = 2,
+};
+
+/**
+ * \brief Simple test context that exposes a pass or fail flag, the number of
+ * iterations a benchmark test should run, the heap expectations set by the
+ * test, the case of the test being run, the state of a property test, and
+ * the corpus input replayed by a fuzz test.
+ *
+ * Assertions may fail on any thread, so while a test runs, the pass flag is
+ * written atomically, through minunit_test_set_pass.
  */
 typedef struct minunit_test_context
 {
     bool pass;
+    uint64_t iterations;
+    unsigned int heap_checks;
+    uint64_t allocation_mark;
+    uint64_t max_allocations;
+    const char* max_allocations_file;
+    int max_allocations_line;
+    const char* no_leaks_file;
+    int no_leaks_line;
+    unsigned int case_index;
+    void* property;
+    const char* input;
 } minunit_test_context_t;
 
+/**
+ * \brief Expect no more than the given number of heap allocations from now
+ * until the test returns.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the expectation.
+ * \param line          The line of the expectation.
+ * \param count         The maximum number of allocations.
+ */
+void minunit_heap_expect_max_allocations(
+    minunit_test_context_t* context, const char* file, int line,
+    uint64_t count);
+
+/**
+ * \brief Expect every heap allocation made by the test to be freed by the
+ * time the test returns.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the expectation.
+ * \param line          The line of the expectation.
+ */
+void minunit_heap_expect_no_leaks(
+    minunit_test_context_t* context, const char* file, int line);
+
+/**
+ * \brief Set whether a test passes.
+ *
+ * This may be called from any thread.
+ *
+ * \param context       The test context.
+ * \param pass          true if the test passes, and false if it fails.
+ */
+void minunit_test_set_pass(minunit_test_context_t* context, bool pass);
+
+/**
+ * \brief Record a failed assertion.
+ *
+ * This may be called from any thread.  The test is failed atomically.  A
+ * failure on the thread running the test is recorded at once, and a failure
+ * on any other thread is held in a buffer belonging to that thread.  Once the
+ * test ends, its failures are collected and passed to the reporters, by way
+ * of the parent when the test runs in a forked test runner.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param file          The file containing the assertion.
+ * \param line          The line of the assertion.
+ * \param message       The expression which was expected to hold.
+ */
+void minunit_test_fail(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const char* file, int line, const char* message);
+
+/**
+ * \brief Enumeration of the kinds of value captured by a comparison.
+ */
+enum minunit_value_kind
+{
+    MINUNIT_VALUE_SIGNED,
+    MINUNIT_VALUE_UNSIGNED,
+    MINUNIT_VALUE_FLOAT,
+    MINUNIT_VALUE_BOOL,
+    MINUNIT_VALUE_CHAR,
+    MINUNIT_VALUE_POINTER,
+    MINUNIT_VALUE_STRING,
+    MINUNIT_VALUE_OBJECT
+};
+
+/**
+ * \brief An operand of a comparison, captured so that it can be formatted if
+ * the comparison fails.
+ *
+ * A string or object is captured by address, and is only valid until the
+ * comparison returns.
+ */
+typedef struct minunit_value
+{
+    int kind;
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        double f;
+        const void* p;
+        const char* s;
+    } as;
+    size_t size;
+} minunit_value_t;
+
+/**
+ * \brief Internal functions.  Do not use.  Capture a comparison operand.
+ */
+static inline minunit_value_t minunit_value_signed(int64_t value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_SIGNED;
+    v.as.i = value;
+    v.size = sizeof(value);
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_unsigned(uint64_t value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_UNSIGNED;
+    v.as.u = value;
+    v.size = sizeof(value);
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_float(double value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_FLOAT;
+    v.as.f = value;
+    v.size = sizeof(value);
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_bool(bool value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_BOOL;
+    v.as.i = value ? 1 : 0;
+    v.size = sizeof(value);
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_char(char value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_CHAR;
+    v.as.i = value;
+    v.size = sizeof(value);
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_pointer(const void* value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_POINTER;
+    v.as.p = value;
+    v.size = sizeof(value);
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_string(const char* value)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_STRING;
+    v.as.s = value;
+    v.size = 0;
+
+    return v;
+}
+
+static inline minunit_value_t minunit_value_object(
+    const void* value, size_t size)
+{
+    minunit_value_t v;
+    v.kind = MINUNIT_VALUE_OBJECT;
+    v.as.p = value;
+    v.size = size;
+
+    return v;
+}
+
+/**
+ * \brief Internal function.  Do not use.  Compare two strings, either of which
+ * may be NULL.
+ */
+static inline bool minunit_string_equal(const char* lhs, const char* rhs)
+{
+    return lhs == rhs || (NULL != lhs && NULL != rhs && !strcmp(lhs, rhs));
+}
+
+/**
+ * \brief Internal function.  Do not use.  Determine whether two floating
+ * point values are within a tolerance of each other.
+ */
+static inline bool minunit_float_near(
+    long double lhs, long double rhs, long double tolerance)
+{
+    long double difference = lhs > rhs ? lhs - rhs : rhs - lhs;
+
+    return difference <= tolerance;
+}
+
+/**
+ * \brief Mark a function as unlikely to be called, so that the compiler keeps
+ * it off the path of passing assertions.
+ */
+#if defined(__GNUC__)
+# define MINUNIT_COLD __attribute__((cold, noinline))
+#else
+# define MINUNIT_COLD
+#endif
+
+/**
+ * \brief Record a failed comparison, along with the values compared.
+ *
+ * The values are only formatted here, once the comparison has failed.  This
+ * may be called from any thread, and behaves like minunit_test_fail.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param file          The file containing the assertion.
+ * \param line          The line of the assertion.
+ * \param message       The comparison which was expected to hold.
+ * \param lhs           The left hand side of the comparison.
+ * \param rhs           The right hand side of the comparison.
+ * \param tolerance     The tolerance of a comparison of floating point
+ *                      values, or NULL.
+ */
+void minunit_test_fail_compare(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const char* file, int line, const char* message,
+    const minunit_value_t* lhs, const minunit_value_t* rhs,
+    const minunit_value_t* tolerance) MINUNIT_COLD;
+
 /**
  * \brief Type of a minunit test function.
  */
@@ -58,32 +379,129 @@ typedef void (*minunit_test_func_t)(
     const minunit_test_options_t*, minunit_test_context_t*);
 
 /**
- * \brief Internal method to register a minunit test.
+ * \brief Type of the body of a concurrent test, which is passed the index of
+ * the thread running it.
+ */
+typedef void (*minunit_thread_func_t)(
+    const minunit_test_options_t*, minunit_test_context_t*, unsigned int);
+
+/**
+ * \brief Run the body of a concurrent test on the given number of threads,
+ * released together once every thread has started.
+ *
+ * \param options       The test options.
+ * \param context       The test context, shared by every thread.
+ * \param threads       The number of threads to run the body on.
+ * \param func          The body of the test.
+ */
+void minunit_run_concurrent(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    unsigned int threads, minunit_thread_func_t func);
+
+/**
+ * \brief The number of examples of a property test run by each case of the
+ * test that the test runner schedules.
+ */
+#define MINUNIT_PROPERTY_EXAMPLES_PER_CASE 100
+
+/**
+ * \brief Run a share of the examples of a property test, and shrink the first
+ * example which fails to a minimal counterexample.
  *
- * \param test_func     The test function to register.
- * \param name          The name of this test function.
+ * The share run is chosen by the case index in the context.
  *
- * \returns 0 on success and non-zero on failure.
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param name          The name of the test, which seeds its examples.
+ * \param examples      The number of examples of the test, across its cases.
+ * \param func          The body of the test, run once for each example.
  */
-int minunit_register_test(minunit_test_func_t test_func, const char* name);
+void minunit_run_property(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const char* name, unsigned int examples, minunit_test_func_t func);
 
 /**
- * \brief Internal method to register a minunit test suite.
+ * \brief Generate an integer for an example of a property test.
  *
- * \param name          The name of this test suite.
+ * \param context       The test context.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param min           The smallest integer to generate.
+ * \param max           The largest integer to generate.
  *
- * \returns 0 on success and non-zero on failure.
+ * \returns the integer.
+ */
+int64_t minunit_generate_int(
+    minunit_test_context_t* context, const char* file, int line,
+    const char* expr, int64_t min, int64_t max);
+
+/**
+ * \brief Generate a buffer of bytes for an example of a property test.
+ *
+ * The buffer is valid until the example returns.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param min           The smallest size to generate.
+ * \param max           The largest size to generate.
+ * \param size          Set to the size of the buffer.
+ *
+ * \returns the buffer.
  */
-int minunit_register_suite(const char* name);
+const uint8_t* minunit_generate_buffer(
+    minunit_test_context_t* context, const char* file, int line,
+    const char* expr, size_t min, size_t max, size_t* size);
 
 /**
- * \brief Internal enumeration to determine whether a node is a test case or a
- * suite.
+ * \brief Generate a string of printable characters for an example of a
+ * property test.
+ *
+ * The string is valid until the example returns.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param min           The smallest length to generate.
+ * \param max           The largest length to generate.
+ *
+ * \returns the string.
+ */
+const char* minunit_generate_string(
+    minunit_test_context_t* context, const char* file, int line,
+    const char* expr, size_t min, size_t max);
+
+/**
+ * \brief Type of the body of a fuzz test, which is passed an input.
+ */
+typedef void (*minunit_fuzz_func_t)(
+    const minunit_test_options_t*, minunit_test_context_t*, const uint8_t*,
+    size_t);
+
+/**
+ * \brief Replay the corpus input named by the context through the body of a
+ * fuzz test, or an empty input if the context names none.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param func          The body of the test.
+ */
+void minunit_run_fuzz_input(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    minunit_fuzz_func_t func);
+
+/**
+ * \brief Internal enumeration to determine whether a node is a test case, a
+ * suite, or a warm-up hook.
  */
 enum minunit_test_type
 {
     MINUNIT_TEST_TYPE_SUITE,
-    MINUNIT_TEST_TYPE_UNIT
+    MINUNIT_TEST_TYPE_UNIT,
+    MINUNIT_TEST_TYPE_WARM_UP
 };
 
 /**
@@ -92,11 +510,20 @@ enum minunit_test_type
 enum minunit_test_flag
 {
     MINUNIT_TEST_FLAG_ENABLED           = 1,
+    MINUNIT_TEST_FLAG_TIMEOUT           = 2,
+    MINUNIT_TEST_FLAG_BENCHMARK         = 4,
+    MINUNIT_TEST_FLAG_FUZZ              = 8,
 };
 
 /**
- * A node in the test case linked list, which can be either a unit test or a
- * suite tag.
+ * A test case descriptor, which can be either a unit test or a suite tag.
+ *
+ * Descriptors are defined in static storage by the test macros.  The file and
+ * ordinal of each descriptor record where it was declared, so that the test
+ * runner can restore declaration order.  A unit test with more than one case
+ * is scheduled as a separate test for each case, and a count of 0 means a
+ * single case.  A fuzz test also records the body which is run over each
+ * input, and a test with resource limits of its own records its limits.
  */
 typedef struct minunit_test_case
 {
@@ -106,8 +533,205 @@ typedef struct minunit_test_case
     minunit_test_func_t method;
     bool failed;
     int flags;
+    unsigned int timeout;
+    const char* file;
+    unsigned int ordinal;
+    unsigned int cases;
+    minunit_fuzz_func_t fuzz;
+    const minunit_test_limits_t* limits;
 } minunit_test_case_t;
 
+/*
+ * Where the toolchain supports it, a pointer to each test case descriptor is
+ * placed in a dedicated linker section, so that the test runner finds every
+ * test case as a contiguous array without any registration at startup.
+ */
+#if defined(__GNUC__) && defined(__ELF__)
+# define MINUNIT_SECTION_REGISTRATION
+# define MINUNIT_SECTION_ATTRIBUTE \
+    __attribute__((section("minunit_test_cases"), used))
+#elif defined(__GNUC__) && defined(__APPLE__) && defined(__MACH__)
+# define MINUNIT_SECTION_REGISTRATION
+# define MINUNIT_SECTION_ATTRIBUTE \
+    __attribute__((section("__DATA,minunit_tests"), used))
+#endif
+
+#ifndef MINUNIT_SECTION_REGISTRATION
+/**
+ * \brief Internal method to register a minunit test case descriptor, for
+ * toolchains without linker section support.
+ *
+ * \param test_case     The statically allocated descriptor to register.
+ *
+ * \returns 0 on success and non-zero on failure.
+ */
+int minunit_register_test_case(minunit_test_case_t* test_case);
+#endif
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#if defined(MINUNIT_SECTION_REGISTRATION)
+# define MINUNIT_REGISTER_TEST_CASE(test_case) \
+    static minunit_test_case_t* test_case ## _entry \
+        MINUNIT_SECTION_ATTRIBUTE = &test_case
+#else
+# define MINUNIT_REGISTER_TEST_CASE(test_case) \
+    static int test_case ## _entry = minunit_register_test_case(&test_case)
+#endif
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_TEST(name, flags, timeout) \
+    MINUNIT_DEFINE_TEST_CASE(name, MINUNIT_TEST_TYPE_UNIT, flags, timeout)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_TEST_CASE(name, type, flags, timeout) \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context); \
+    static minunit_test_case_t minunit_reserved_## name ##_test_case = { \
+        NULL, (type), #name, \
+        &minunit_reserved_## name ##_test_func, false, (flags), (timeout), \
+        __FILE__, __COUNTER__, 0, NULL, NULL }; \
+    MINUNIT_REGISTER_TEST_CASE(minunit_reserved_## name ##_test_case); \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_LIMITED_TEST(name, memory, cpu, files, output) \
+    static const minunit_test_limits_t minunit_reserved_## name ##_limits = { \
+        (memory), (cpu), (files), (output) }; \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context); \
+    static minunit_test_case_t minunit_reserved_## name ##_test_case = { \
+        NULL, MINUNIT_TEST_TYPE_UNIT, #name, \
+        &minunit_reserved_## name ##_test_func, false, \
+        MINUNIT_TEST_FLAG_ENABLED, 0, __FILE__, __COUNTER__, 0, NULL, \
+        &minunit_reserved_## name ##_limits }; \
+    MINUNIT_REGISTER_TEST_CASE(minunit_reserved_## name ##_test_case); \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#if defined(__cplusplus)
+# define MINUNIT_TYPEOF(expr) decltype(expr)
+#else
+# define MINUNIT_TYPEOF(expr) __typeof__(expr)
+#endif
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_CASES(name, cases) \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context); \
+    static minunit_test_case_t minunit_reserved_## name ##_test_case = { \
+        NULL, MINUNIT_TEST_TYPE_UNIT, #name, \
+        &minunit_reserved_## name ##_test_func, false, \
+        MINUNIT_TEST_FLAG_ENABLED, 0, __FILE__, __COUNTER__, \
+        (unsigned int)(cases), NULL, NULL }; \
+    MINUNIT_REGISTER_TEST_CASE(minunit_reserved_## name ##_test_case); \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_PARAM_TEST(name, table) \
+    static void minunit_reserved_## name ##_param_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context, \
+        MINUNIT_TYPEOF(&(table)[0]) minunit_reserved_param); \
+    MINUNIT_DEFINE_CASES(name, sizeof(table) / sizeof((table)[0])) \
+    { \
+        minunit_reserved_## name ##_param_func( \
+            minunit_reserved_options, minunit_reserved_context, \
+            &(table)[minunit_reserved_context->case_index]); \
+    } \
+    static void minunit_reserved_## name ##_param_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context, \
+        MINUNIT_TYPEOF(&(table)[0]) minunit_reserved_param)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_PROPERTY_TEST(name, examples) \
+    static void minunit_reserved_## name ##_property_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context); \
+    MINUNIT_DEFINE_CASES( \
+        name, \
+        ((examples) + MINUNIT_PROPERTY_EXAMPLES_PER_CASE - 1) \
+            / MINUNIT_PROPERTY_EXAMPLES_PER_CASE) \
+    { \
+        minunit_run_property( \
+            minunit_reserved_options, minunit_reserved_context, #name, \
+            (examples), &minunit_reserved_## name ##_property_func); \
+    } \
+    static void minunit_reserved_## name ##_property_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_FUZZ_TEST(name, data, size) \
+    static void minunit_reserved_## name ##_fuzz_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context, \
+        const uint8_t* data, size_t size); \
+    static void minunit_reserved_## name ##_test_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context) \
+    { \
+        minunit_run_fuzz_input( \
+            minunit_reserved_options, minunit_reserved_context, \
+            &minunit_reserved_## name ##_fuzz_func); \
+    } \
+    static minunit_test_case_t minunit_reserved_## name ##_test_case = { \
+        NULL, MINUNIT_TEST_TYPE_UNIT, #name, \
+        &minunit_reserved_## name ##_test_func, false, \
+        MINUNIT_TEST_FLAG_ENABLED | MINUNIT_TEST_FLAG_FUZZ, 0, __FILE__, \
+        __COUNTER__, 0, &minunit_reserved_## name ##_fuzz_func, NULL }; \
+    MINUNIT_REGISTER_TEST_CASE(minunit_reserved_## name ##_test_case); \
+    static void minunit_reserved_## name ##_fuzz_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context, \
+        const uint8_t* data, size_t size)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define MINUNIT_DEFINE_CONCURRENT_TEST(name, threads) \
+    static void minunit_reserved_## name ##_thread_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context, \
+        unsigned int minunit_reserved_thread); \
+    MINUNIT_DEFINE_TEST(name, MINUNIT_TEST_FLAG_ENABLED, 0) \
+    { \
+        minunit_run_concurrent( \
+            minunit_reserved_options, minunit_reserved_context, (threads), \
+            &minunit_reserved_## name ##_thread_func); \
+    } \
+    static void minunit_reserved_## name ##_thread_func( \
+        const minunit_test_options_t* minunit_reserved_options, \
+        minunit_test_context_t* minunit_reserved_context, \
+        unsigned int minunit_reserved_thread)
+
 /**
  * \brief Internal macro.  Do not use.
  */
@@ -118,14 +742,9 @@ typedef struct minunit_test_case
         } \
         else \
         { \
-            printf("%s:%d: ", file, line); \
-            minunit_reserved_options->terminal_set_color( \
-                MINUNIT_TERMINAL_COLOR_RED); \
-            printf("error"); \
-            minunit_reserved_options->terminal_set_color( \
-                MINUNIT_TERMINAL_COLOR_NORMAL); \
-            printf(": expecting %s.\n", message); \
-            minunit_reserved_context->pass = false; \
+            minunit_test_fail( \
+                minunit_reserved_options, minunit_reserved_context, \
+                file, line, message); \
             return; \
         } \
     } while (0)
@@ -140,18 +759,277 @@ typedef struct minunit_test_case
         } \
         else \
         { \
-            printf("%s:%d: ", file, line); \
-            minunit_reserved_options->terminal_set_color( \
-                MINUNIT_TERMINAL_COLOR_RED); \
-            printf("error"); \
-            minunit_reserved_options->terminal_set_color( \
-                MINUNIT_TERMINAL_COLOR_NORMAL); \
-            printf(": expecting %s.\n", message); \
-            minunit_reserved_context->pass = false; \
+            minunit_test_fail( \
+                minunit_reserved_options, minunit_reserved_context, \
+                file, line, message); \
         } \
     } while (0)
 
+/**
+ * \brief Internal macro.  Do not use.
+ *
+ * The operands of a comparison are each evaluated once, into locals which are
+ * only captured as values for formatting if the comparison fails.
+ */
+#if defined(__cplusplus)
+# define MINUNIT_CAPTURE(name, expr) const auto& name = (expr)
+# define MINUNIT_VALUE(x) minunit_make_value(x)
+# define MINUNIT_COMPARE(op_name, op, lhs, rhs) \
+    minunit_compare_ ## op_name((lhs), (rhs))
+#else
+# define MINUNIT_CAPTURE(name, expr) __typeof__(expr) const name = (expr)
+# define MINUNIT_VALUE(x) \
+    _Generic((x), \
+        bool: minunit_value_bool, \
+        char: minunit_value_char, \
+        signed char: minunit_value_signed, \
+        short: minunit_value_signed, \
+        int: minunit_value_signed, \
+        long: minunit_value_signed, \
+        long long: minunit_value_signed, \
+        unsigned char: minunit_value_unsigned, \
+        unsigned short: minunit_value_unsigned, \
+        unsigned int: minunit_value_unsigned, \
+        unsigned long: minunit_value_unsigned, \
+        unsigned long long: minunit_value_unsigned, \
+        float: minunit_value_float, \
+        double: minunit_value_float, \
+        long double: minunit_value_float, \
+        default: minunit_value_pointer)(x)
+# define MINUNIT_COMPARE(op_name, op, lhs, rhs) ((lhs) op (rhs))
+#endif
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define TEST_COMPARE_MESSAGE(message, op_name, op, lhs, rhs, on_failure) \
+    do { \
+        MINUNIT_CAPTURE(minunit_reserved_lhs, lhs); \
+        MINUNIT_CAPTURE(minunit_reserved_rhs, rhs); \
+        if (MINUNIT_COMPARE( \
+                op_name, op, minunit_reserved_lhs, minunit_reserved_rhs)) \
+        { \
+        } \
+        else \
+        { \
+            minunit_value_t minunit_reserved_lhs_value = \
+                MINUNIT_VALUE(minunit_reserved_lhs); \
+            minunit_value_t minunit_reserved_rhs_value = \
+                MINUNIT_VALUE(minunit_reserved_rhs); \
+            minunit_test_fail_compare( \
+                minunit_reserved_options, minunit_reserved_context, \
+                __FILE__, __LINE__, message, \
+                &minunit_reserved_lhs_value, &minunit_reserved_rhs_value, \
+                NULL); \
+            on_failure; \
+        } \
+    } while (0)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define TEST_STREQ_MESSAGE(message, lhs, rhs, on_failure) \
+    do { \
+        const char* minunit_reserved_lhs = (lhs); \
+        const char* minunit_reserved_rhs = (rhs); \
+        if (minunit_string_equal(minunit_reserved_lhs, minunit_reserved_rhs)) \
+        { \
+        } \
+        else \
+        { \
+            minunit_value_t minunit_reserved_lhs_value = \
+                minunit_value_string(minunit_reserved_lhs); \
+            minunit_value_t minunit_reserved_rhs_value = \
+                minunit_value_string(minunit_reserved_rhs); \
+            minunit_test_fail_compare( \
+                minunit_reserved_options, minunit_reserved_context, \
+                __FILE__, __LINE__, message, \
+                &minunit_reserved_lhs_value, &minunit_reserved_rhs_value, \
+                NULL); \
+            on_failure; \
+        } \
+    } while (0)
+
+/**
+ * \brief Internal macro.  Do not use.
+ */
+#define TEST_NEAR_MESSAGE(message, lhs, rhs, tolerance, on_failure) \
+    do { \
+        long double minunit_reserved_lhs = (lhs); \
+        long double minunit_reserved_rhs = (rhs); \
+        long double minunit_reserved_tolerance = (tolerance); \
+        if (minunit_float_near( \
+                minunit_reserved_lhs, minunit_reserved_rhs, \
+                minunit_reserved_tolerance)) \
+        { \
+        } \
+        else \
+        { \
+            minunit_value_t minunit_reserved_lhs_value = \
+                minunit_value_float(minunit_reserved_lhs); \
+            minunit_value_t minunit_reserved_rhs_value = \
+                minunit_value_float(minunit_reserved_rhs); \
+            minunit_value_t minunit_reserved_tolerance_value = \
+                minunit_value_float(minunit_reserved_tolerance); \
+            minunit_test_fail_compare( \
+                minunit_reserved_options, minunit_reserved_context, \
+                __FILE__, __LINE__, message, \
+                &minunit_reserved_lhs_value, &minunit_reserved_rhs_value, \
+                &minunit_reserved_tolerance_value); \
+            on_failure; \
+        } \
+    } while (0)
+
+#ifdef   __cplusplus
+}
+#endif /*__cplusplus*/
+
 #ifdef   __cplusplus
+/* this header may be included within an extern "C" block. */
+extern "C++" {
+
+# include <cstddef>
+# include <type_traits>
+# include <utility>
+
+/**
+ * \brief Internal type.  Do not use.  Whether a type is a string class, with
+ * a c_str() member.
+ */
+template <typename T, typename = void>
+struct minunit_has_c_str : std::false_type
+{
+};
+
+template <typename T>
+struct minunit_has_c_str<
+    T, decltype((void)std::declval<const T&>().c_str())> : std::true_type
+{
+};
+
+/**
+ * \brief Internal functions.  Do not use.  Capture a comparison operand by its
+ * type.
+ */
+inline minunit_value_t minunit_make_value(bool value)
+{
+    return minunit_value_bool(value);
+}
+
+inline minunit_value_t minunit_make_value(char value)
+{
+    return minunit_value_char(value);
+}
+
+template <typename T>
+inline typename std::enable_if<
+    (std::is_integral<T>::value && std::is_signed<T>::value)
+        || std::is_enum<T>::value,
+    minunit_value_t>::type
+minunit_make_value(const T& value)
+{
+    return minunit_value_signed((int64_t)value);
+}
+
+template <typename T>
+inline typename std::enable_if<
+    std::is_integral<T>::value && std::is_unsigned<T>::value,
+    minunit_value_t>::type
+minunit_make_value(const T& value)
+{
+    return minunit_value_unsigned((uint64_t)value);
+}
+
+template <typename T>
+inline typename std::enable_if<
+    std::is_floating_point<T>::value, minunit_value_t>::type
+minunit_make_value(const T& value)
+{
+    return minunit_value_float(value);
+}
+
+template <typename T>
+inline typename std::enable_if<
+    std::is_pointer<T>::value
+        || std::is_same<T, std::nullptr_t>::value,
+    minunit_value_t>::type
+minunit_make_value(const T& value)
+{
+    return minunit_value_pointer((const void*)value);
+}
+
+template <typename T>
+inline typename std::enable_if<
+    minunit_has_c_str<T>::value, minunit_value_t>::type
+minunit_make_value(const T& value)
+{
+    return minunit_value_string(value.c_str());
+}
+
+template <typename T>
+inline typename std::enable_if<
+    !std::is_arithmetic<T>::value && !std::is_enum<T>::value
+        && !std::is_pointer<T>::value
+        && !std::is_same<T, std::nullptr_t>::value
+        && !minunit_has_c_str<T>::value,
+    minunit_value_t>::type
+minunit_make_value(const T& value)
+{
+    return minunit_value_object(&value, sizeof(value));
+}
+
+/*
+ * The operands of a comparison may differ in signedness, as they may in the
+ * equivalent TEST_EXPECT, where a literal operand draws no warning.
+ */
+# if defined(__GNUC__)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wsign-compare"
+# endif
+
+/**
+ * \brief Internal functions.  Do not use.  Compare two operands.
+ */
+template <typename L, typename R>
+inline bool minunit_compare_eq(const L& lhs, const R& rhs)
+{
+    return lhs == rhs;
+}
+
+template <typename L, typename R>
+inline bool minunit_compare_ne(const L& lhs, const R& rhs)
+{
+    return lhs != rhs;
+}
+
+template <typename L, typename R>
+inline bool minunit_compare_lt(const L& lhs, const R& rhs)
+{
+    return lhs < rhs;
+}
+
+template <typename L, typename R>
+inline bool minunit_compare_le(const L& lhs, const R& rhs)
+{
+    return lhs <= rhs;
+}
+
+template <typename L, typename R>
+inline bool minunit_compare_gt(const L& lhs, const R& rhs)
+{
+    return lhs > rhs;
+}
+
+template <typename L, typename R>
+inline bool minunit_compare_ge(const L& lhs, const R& rhs)
+{
+    return lhs >= rhs;
+}
+
+# if defined(__GNUC__)
+#  pragma GCC diagnostic pop
+# endif
+
 }
 #endif /*__cplusplus*/
 
@@ -31,22 +31,230 @@ extern "C" {
  * source file.
  */
 #define TEST_SUITE(name) \
-    static int minunit_reserved_## name ##_init = \
-        minunit_register_suite(#name)
+    static minunit_test_case_t minunit_reserved_## name ##_suite = { \
+        NULL, MINUNIT_TEST_TYPE_SUITE, #name, NULL, false, \
+        MINUNIT_TEST_FLAG_ENABLED, 0, __FILE__, __COUNTER__, 0, NULL, \
+        NULL }; \
+    MINUNIT_REGISTER_TEST_CASE(minunit_reserved_## name ##_suite)
 
 /**
  * \brief Unit Test definition.
  */
 
 #define TEST(name) \
-    static void minunit_reserved_## name ##_test_func( \
-        const minunit_test_options_t* minunit_reserved_options, \
-        minunit_test_context_t* minunit_reserved_context); \
-    static int minunit_reserved_## name ##_init = \
-        minunit_register_test(&minunit_reserved_## name ## _test_func, #name); \
-    static void minunit_reserved_## name ##_test_func( \
-        const minunit_test_options_t* minunit_reserved_options, \
-        minunit_test_context_t* minunit_reserved_context)
+    MINUNIT_DEFINE_TEST(name, MINUNIT_TEST_FLAG_ENABLED, 0)
+
+/**
+ * \brief Unit Test definition with a timeout in milliseconds.
+ *
+ * If this test runs for longer than the given timeout, the forked test runner
+ * kills it and reports a timeout.  This timeout overrides the default timeout
+ * of the test runner.
+ */
+#define TEST_WITH_TIMEOUT(name, timeout) \
+    MINUNIT_DEFINE_TEST( \
+        name, MINUNIT_TEST_FLAG_ENABLED | MINUNIT_TEST_FLAG_TIMEOUT, (timeout))
+
+/**
+ * \brief Unit Test definition with resource limits.
+ *
+ * The forked process running this test may map at most the given bytes of
+ * memory, use at most the given seconds of CPU time, open at most the given
+ * number of files beyond those already open, and have at most the given bytes
+ * of its standard output and standard error reported.  A test which exceeds
+ * its memory or CPU limit is killed and reported as OOM or CPU-LIMIT, and one
+ * which returns with files still open is reported as FD-LEAK.  Captured output
+ * past its limit is dropped from the report.  A limit of 0 falls
+ * back to the limit given to the test runner.  Limits are not applied to tests
+ * run in the test runner's own process.
+ */
+#define TEST_WITH_LIMITS(name, memory, cpu, files, output) \
+    MINUNIT_DEFINE_LIMITED_TEST(name, memory, cpu, files, output)
+
+/**
+ * \brief Benchmark test definition.
+ *
+ * A benchmark test runs its measured operation TEST_BENCHMARK_ITERATIONS()
+ * times.  The test runner calls the body repeatedly, first to warm up, then to
+ * calibrate the iteration count, and finally to take timing samples.  The
+ * mean, median, and standard deviation of the time per operation are
+ * reported, along with the throughput.  Assertions can be used as in any other
+ * test, and a failure stops the benchmark.
+ */
+#define TEST_BENCHMARK(name) \
+    MINUNIT_DEFINE_TEST( \
+        name, MINUNIT_TEST_FLAG_ENABLED | MINUNIT_TEST_FLAG_BENCHMARK, 0)
+
+/**
+ * \brief Concurrent test definition.
+ *
+ * The body of a concurrent test runs on the given number of threads at once.
+ * Every thread is started before any of them runs the body, and then they are
+ * released together, so that the body can stress code shared between threads,
+ * such as a lock-free structure.  TEST_THREAD_INDEX() gives the index of the
+ * thread running the body, from 0.  Assertions can be used on every thread,
+ * and a failure on any thread fails the test.  A failed assertion returns only
+ * from the body on the thread where it failed.
+ */
+#define TEST_CONCURRENT(name, threads) \
+    MINUNIT_DEFINE_CONCURRENT_TEST(name, threads)
+
+/**
+ * \brief The index of the thread running the body of a concurrent test.
+ */
+#define TEST_THREAD_INDEX() \
+    ((void)minunit_reserved_options, minunit_reserved_thread)
+
+/**
+ * \brief Parameterized test definition.
+ *
+ * The body of a parameterized test runs once for each row of the given table,
+ * which must be an array declared before the test.  TEST_PARAM() gives a
+ * pointer to the row.  Each row is scheduled as a test of its own, named for
+ * the test and the index of the row, such as "name/2", so that rows run in
+ * parallel and a failure names the row that failed.
+ */
+#define TEST_P(name, table) \
+    MINUNIT_DEFINE_PARAM_TEST(name, table)
+
+/**
+ * \brief The row of the table for which a parameterized test is running.
+ */
+#define TEST_PARAM() \
+    ((void)minunit_reserved_options, minunit_reserved_param)
+
+/**
+ * \brief Property test definition.
+ *
+ * The body of a property test runs for the given number of examples, each
+ * drawing its inputs from the TEST_GEN_ generators, and should assert a
+ * property that holds for every input.  The examples are seeded from the
+ * --property-seed option, which is random by default, and are scheduled in
+ * cases of MINUNIT_PROPERTY_EXAMPLES_PER_CASE examples each.  When an example
+ * fails, its inputs are shrunk to a minimal counterexample, which is printed
+ * along with the seed that reproduces it.
+ */
+#define TEST_PROPERTY(name, examples) \
+    MINUNIT_DEFINE_PROPERTY_TEST(name, examples)
+
+/**
+ * \brief Generate an int64_t from min to max inclusive, which shrinks towards
+ * zero.
+ */
+#define TEST_GEN_INT(min, max) \
+    ((void)minunit_reserved_options, \
+     minunit_generate_int( \
+        minunit_reserved_context, __FILE__, __LINE__, \
+        "TEST_GEN_INT(" #min ", " #max ")", (min), (max)))
+
+/**
+ * \brief Generate a buffer of min to max bytes, setting size to its size,
+ * which shrinks towards fewer bytes of lower value.
+ */
+#define TEST_GEN_BUFFER(min, max, size) \
+    ((void)minunit_reserved_options, \
+     minunit_generate_buffer( \
+        minunit_reserved_context, __FILE__, __LINE__, \
+        "TEST_GEN_BUFFER(" #min ", " #max ")", (min), (max), (size)))
+
+/**
+ * \brief Generate a string of min to max printable characters, which shrinks
+ * towards fewer characters nearer 'a'.
+ */
+#define TEST_GEN_STRING(min, max) \
+    ((void)minunit_reserved_options, \
+     minunit_generate_string( \
+        minunit_reserved_context, __FILE__, __LINE__, \
+        "TEST_GEN_STRING(" #min ", " #max ")", (min), (max)))
+
+/**
+ * \brief Fuzz test definition.
+ *
+ * The body of a fuzz test is passed an input of size bytes at data, and should
+ * exercise the code under test with it, asserting anything that should hold
+ * for every input.  In a normal run, each file in the corpus of the test is
+ * replayed as a test of its own, named for the test and the file, such as
+ * "name/seed".  The corpus is the directory named for the test under a
+ * "corpus" directory beside the source file, or under the directory given by
+ * the --corpus option.  A test with an empty corpus runs once, on an empty
+ * input.
+ *
+ * Under --fuzz=name, each forked test runner runs the body in a loop over
+ * mutated inputs for --fuzz-time, keeping the inputs which reach new edges in
+ * an output corpus, which is the directory named for the test under the
+ * --corpus option, or by default under "fuzz-corpus" in the current
+ * directory.  The corpus beside the source file is only read.  Fuzzing stops
+ * at the first input which crashes, fails, or hangs, and saves it in the
+ * current directory.  Edges are only counted in code built with
+ * -fsanitize-coverage=trace-pc-guard or trace-pc, such as by linking the
+ * minunit_fuzz target.
+ */
+#define TEST_FUZZ(name, data, size) \
+    MINUNIT_DEFINE_FUZZ_TEST(name, data, size)
+
+/**
+ * \brief Warm-up hook definition.
+ *
+ * A warm-up hook performs expensive setup shared by every test, such as
+ * loading fixtures or priming caches.  Warm-up hooks run once in each test
+ * runner, in registration order, before the runner executes any tests.  In
+ * zygote mode, they run once in the template process from which every test is
+ * forked, so that each test starts from the warmed-up state.  A failed
+ * assertion in a warm-up hook stops the run before any test, and the hook is
+ * reported as having failed.
+ */
+#define TEST_WARM_UP(name) \
+    MINUNIT_DEFINE_TEST_CASE( \
+        name, MINUNIT_TEST_TYPE_WARM_UP, MINUNIT_TEST_FLAG_ENABLED, 0)
+
+/**
+ * \brief The number of iterations a benchmark test should run.
+ */
+#define TEST_BENCHMARK_ITERATIONS() \
+    ((void)minunit_reserved_options, minunit_reserved_context->iterations)
+
+/**
+ * \brief Prevent the compiler from optimizing away a value computed by a
+ * benchmark.
+ */
+#if defined(__GNUC__)
+# define TEST_DO_NOT_OPTIMIZE(value) \
+    __asm__ __volatile__("" : : "r,m"(value) : "memory")
+#else
+# define TEST_DO_NOT_OPTIMIZE(value) \
+    do { \
+        volatile auto minunit_reserved_sink = (value); \
+        (void)minunit_reserved_sink; \
+    } while (0)
+#endif
+
+/**
+ * \brief Expect the test to make no more than the given number of heap
+ * allocations from this point until it returns.
+ *
+ * This expectation is checked once the test returns, and only when the heap
+ * shim is loaded.
+ */
+#define TEST_EXPECT_MAX_ALLOCS(n) \
+    do { \
+        (void)minunit_reserved_options; \
+        minunit_heap_expect_max_allocations( \
+            minunit_reserved_context, __FILE__, __LINE__, (n)); \
+    } while (0)
+
+/**
+ * \brief Expect the test to free every heap allocation it makes before it
+ * returns.
+ *
+ * This expectation is checked once the test returns, and only when the heap
+ * shim is loaded.
+ */
+#define TEST_EXPECT_NO_LEAKS() \
+    do { \
+        (void)minunit_reserved_options; \
+        minunit_heap_expect_no_leaks( \
+            minunit_reserved_context, __FILE__, __LINE__); \
+    } while (0)
 
 /**
  * \brief If this is the last statement in a test, and no assertions failed,
@@ -55,7 +263,7 @@ extern "C" {
 #define TEST_SUCCESS() \
     do { \
         (void)minunit_reserved_options; \
-        minunit_reserved_context->pass = true; \
+        minunit_test_set_pass(minunit_reserved_context, true); \
     } while (0)
 
 /**
@@ -64,7 +272,7 @@ extern "C" {
 #define TEST_FAILURE() \
     do { \
         (void)minunit_reserved_options; \
-        minunit_reserved_context->pass = false; \
+        minunit_test_set_pass(minunit_reserved_context, false); \
     } while (0)
 
 /**
@@ -83,6 +291,64 @@ extern "C" {
  */
 #define TEST_EXPECT(cond) TEST_EXPECT_MESSAGE(#cond, __FILE__, __LINE__, cond)
 
+/**
+ * \brief Expect two values to compare as given.
+ *
+ * Each operand is evaluated once.  If the comparison fails, the test fails,
+ * and the failure records both values, which are only formatted once the
+ * comparison has failed.  Execution continues.
+ */
+#define TEST_EXPECT_EQ(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " == " #rhs, eq, ==, lhs, rhs, )
+#define TEST_EXPECT_NE(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " != " #rhs, ne, !=, lhs, rhs, )
+#define TEST_EXPECT_LT(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " < " #rhs, lt, <, lhs, rhs, )
+#define TEST_EXPECT_LE(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " <= " #rhs, le, <=, lhs, rhs, )
+#define TEST_EXPECT_GT(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " > " #rhs, gt, >, lhs, rhs, )
+#define TEST_EXPECT_GE(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " >= " #rhs, ge, >=, lhs, rhs, )
+
+/**
+ * \brief Expect two C strings, either of which may be NULL, to be equal.
+ */
+#define TEST_EXPECT_STREQ(lhs, rhs) \
+    TEST_STREQ_MESSAGE("strcmp(" #lhs ", " #rhs ") == 0", lhs, rhs, )
+
+/**
+ * \brief Expect two floating point values to differ by no more than the given
+ * tolerance.
+ */
+#define TEST_EXPECT_NEAR(lhs, rhs, tolerance) \
+    TEST_NEAR_MESSAGE( \
+        #lhs " == " #rhs " within " #tolerance, lhs, rhs, tolerance, )
+
+/**
+ * \brief Assert that two values compare as given.
+ *
+ * These behave like the TEST_EXPECT_ comparisons, except that control is
+ * returned immediately to the runner when the comparison fails.
+ */
+#define TEST_ASSERT_EQ(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " == " #rhs, eq, ==, lhs, rhs, return)
+#define TEST_ASSERT_NE(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " != " #rhs, ne, !=, lhs, rhs, return)
+#define TEST_ASSERT_LT(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " < " #rhs, lt, <, lhs, rhs, return)
+#define TEST_ASSERT_LE(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " <= " #rhs, le, <=, lhs, rhs, return)
+#define TEST_ASSERT_GT(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " > " #rhs, gt, >, lhs, rhs, return)
+#define TEST_ASSERT_GE(lhs, rhs) \
+    TEST_COMPARE_MESSAGE(#lhs " >= " #rhs, ge, >=, lhs, rhs, return)
+#define TEST_ASSERT_STREQ(lhs, rhs) \
+    TEST_STREQ_MESSAGE("strcmp(" #lhs ", " #rhs ") == 0", lhs, rhs, return)
+#define TEST_ASSERT_NEAR(lhs, rhs, tolerance) \
+    TEST_NEAR_MESSAGE( \
+        #lhs " == " #rhs " within " #tolerance, lhs, rhs, tolerance, return)
+
 #ifdef   __cplusplus
 }
 #endif /*__cplusplus*/
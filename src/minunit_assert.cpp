@@ -0,0 +1,505 @@
+/**
+ * \file src/minunit_assert.cpp
+ *
+ * \brief Failed assertions, recorded safely from any thread.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "minunit_assert.h"
+
+using namespace std;
+
+/**
+ * \brief The number of failures each thread other than the one running the
+ * test records for a test.  Further failures are only counted, so that an
+ * assertion failing in a tight loop does not flood the report.
+ */
+#define THREAD_MESSAGE_LIMIT 8
+
+/**
+ * \brief The number of failures the thread running the test records for it.
+ */
+#define TEST_MESSAGE_LIMIT 100
+
+/**
+ * \brief The most characters of a string, and bytes of an object, shown in a
+ * formatted value.
+ */
+#define STRING_FORMAT_LIMIT 256
+#define OBJECT_FORMAT_LIMIT 16
+
+/**
+ * \brief The failures held by a thread.
+ *
+ * The thread appends to its buffer under the buffer's own lock, so threads
+ * only ever contend with the test runner collecting their failures.  A buffer
+ * is registered with the test runner when it receives a failure that the test
+ * runner has not yet seen.
+ */
+typedef struct thread_messages
+{
+    mutex lock;
+    int thread_index;
+    bool registered;
+    vector<minunit_failure_t> messages;
+    unsigned int dropped;
+} thread_messages_t;
+
+static mutex registry_lock;
+static vector<shared_ptr<thread_messages_t>> registry;
+
+static thread_local shared_ptr<thread_messages_t> local_messages;
+static thread_local int local_thread_index = -1;
+static thread_local bool running_tests;
+static thread_local bool quiet_failures;
+static thread_local vector<minunit_failure_t> test_failures;
+static thread_local size_t sunk_failures;
+static thread_local minunit_failure_sink_t failure_sink;
+static thread_local void* failure_sink_arg;
+
+/**
+ * \brief Format a character as it would appear in a C literal, without the
+ * quotes.
+ *
+ * \param c             The character.
+ * \param quote         The quote which must be escaped.
+ *
+ * \returns the formatted character.
+ */
+static string escape_char(unsigned char c, char quote)
+{
+    switch (c)
+    {
+        case '\n':  return "\\n";
+        case '\r':  return "\\r";
+        case '\t':  return "\\t";
+        case '\\':  return "\\\\";
+        default:    break;
+    }
+
+    if (c == (unsigned char)quote)
+        return string("\\") + quote;
+
+    if (c < 0x20 || c >= 0x7f)
+    {
+        char buffer[8];
+        snprintf(buffer, sizeof(buffer), "\\x%02x", c);
+        return buffer;
+    }
+
+    return string(1, (char)c);
+}
+
+/**
+ * \brief Format a floating point value with the fewest digits which read back
+ * as the same value.
+ *
+ * \param value         The value.
+ *
+ * \returns the formatted value.
+ */
+static string format_float(double value)
+{
+    char buffer[64];
+
+    for (int precision = 1; precision < 40; ++precision)
+    {
+        snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (strtod(buffer, NULL) == value)
+            break;
+    }
+
+    return buffer;
+}
+
+/**
+ * \brief Format a captured comparison operand.
+ *
+ * \param value         The value.
+ *
+ * \returns the formatted value.
+ */
+static string format_value(const minunit_value_t* value)
+{
+    char buffer[64];
+
+    switch (value->kind)
+    {
+        case MINUNIT_VALUE_SIGNED:
+            snprintf(buffer, sizeof(buffer), "%" PRId64, value->as.i);
+            return buffer;
+
+        case MINUNIT_VALUE_UNSIGNED:
+            snprintf(buffer, sizeof(buffer), "%" PRIu64, value->as.u);
+            return buffer;
+
+        case MINUNIT_VALUE_FLOAT:
+            return format_float(value->as.f);
+
+        case MINUNIT_VALUE_BOOL:
+            return value->as.i ? "true" : "false";
+
+        case MINUNIT_VALUE_CHAR:
+            snprintf(buffer, sizeof(buffer), " (%d)", (int)value->as.i);
+            return
+                "'" + escape_char((unsigned char)value->as.i, '\'') + "'"
+              + buffer;
+
+        case MINUNIT_VALUE_POINTER:
+            if (NULL == value->as.p)
+                return "NULL";
+
+            snprintf(buffer, sizeof(buffer), "%p", value->as.p);
+            return buffer;
+
+        case MINUNIT_VALUE_STRING:
+        {
+            if (NULL == value->as.s)
+                return "NULL";
+
+            string text = "\"";
+            size_t i = 0;
+            for (; '\0' != value->as.s[i] && i < STRING_FORMAT_LIMIT; ++i)
+            {
+                text += escape_char((unsigned char)value->as.s[i], '"');
+            }
+
+            text += "\"";
+            if ('\0' != value->as.s[i])
+                text += "...";
+
+            return text;
+        }
+
+        default:
+        {
+            const uint8_t* bytes = (const uint8_t*)value->as.p;
+
+            snprintf(buffer, sizeof(buffer), "<%zu-byte object", value->size);
+            string text = buffer;
+            for (size_t i = 0; i < value->size && i < OBJECT_FORMAT_LIMIT; ++i)
+            {
+                snprintf(buffer, sizeof(buffer), " %02x", bytes[i]);
+                text += buffer;
+            }
+
+            if (value->size > OBJECT_FORMAT_LIMIT)
+                text += " ...";
+
+            return text + ">";
+        }
+    }
+}
+
+/**
+ * \brief Describe what a failure expected and the values it compared.
+ *
+ * \param failure       The failure.
+ *
+ * \returns the description, starting after the location of the failure.
+ */
+static string describe_expectation(const minunit_failure_t* failure)
+{
+    char buffer[64];
+    string text = "expecting " + failure->expression;
+
+    if (MINUNIT_FAILURE_OTHER_THREAD == failure->thread)
+    {
+        text += " on another thread";
+    }
+    else if (failure->thread >= 0)
+    {
+        snprintf(buffer, sizeof(buffer), " on thread %d", failure->thread);
+        text += buffer;
+    }
+
+    text += ".\n";
+
+    if ("" != failure->lhs || "" != failure->rhs)
+    {
+        text += "    lhs: " + failure->lhs + "\n";
+        text += "    rhs: " + failure->rhs + "\n";
+    }
+
+    if (failure->dropped > 0)
+    {
+        snprintf(buffer, sizeof(buffer), "... and %u more failure%s",
+                 failure->dropped, 1 == failure->dropped ? "" : "s");
+        text += buffer;
+        text += " on this thread.\n";
+    }
+
+    return text;
+}
+
+string minunit_failure_describe(const minunit_failure_t* failure)
+{
+    char buffer[32];
+
+    snprintf(buffer, sizeof(buffer), ":%d: ", failure->line);
+
+    return failure->file + buffer + describe_expectation(failure);
+}
+
+void minunit_failure_print(
+    const minunit_test_options_t* options, const minunit_failure_t* failure)
+{
+    printf("%s:%d: ", failure->file.c_str(), failure->line);
+    options->terminal_set_color(MINUNIT_TERMINAL_COLOR_RED);
+    printf("error");
+    options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    printf(": %s", describe_expectation(failure).c_str());
+}
+
+/**
+ * \brief Hold a failure in the calling thread's buffer.
+ *
+ * \param failure       The failure, which is moved into the buffer.
+ */
+static void hold_failure(minunit_failure_t* failure)
+{
+    if (!local_messages)
+    {
+        local_messages = make_shared<thread_messages_t>();
+        local_messages->registered = false;
+        local_messages->dropped = 0;
+    }
+
+    thread_messages_t* messages = local_messages.get();
+    bool unregistered;
+
+    {
+        lock_guard<mutex> guard(messages->lock);
+
+        messages->thread_index = local_thread_index;
+        if (messages->messages.size() < THREAD_MESSAGE_LIMIT)
+            messages->messages.push_back(move(*failure));
+        else
+            ++messages->dropped;
+
+        unregistered = !messages->registered;
+        messages->registered = true;
+    }
+
+    if (unregistered)
+    {
+        lock_guard<mutex> guard(registry_lock);
+        registry.push_back(local_messages);
+    }
+}
+
+/**
+ * \brief Record a failure, on the thread running the test or in the calling
+ * thread's buffer, unless failures are quiet.
+ *
+ * \param failure       The failure, which is moved into the record.
+ */
+static void record_failure(minunit_failure_t* failure)
+{
+    if (!running_tests)
+    {
+        hold_failure(failure);
+    }
+    else if (quiet_failures)
+    {
+    }
+    else if (test_failures.size() < TEST_MESSAGE_LIMIT)
+    {
+        failure->thread = MINUNIT_FAILURE_TEST_THREAD;
+        test_failures.push_back(move(*failure));
+
+        /* the last failure kept counts those dropped after it. */
+        if (NULL != failure_sink && test_failures.size() < TEST_MESSAGE_LIMIT)
+        {
+            failure_sink(&test_failures.back(), failure_sink_arg);
+            sunk_failures = test_failures.size();
+        }
+    }
+    else
+    {
+        ++test_failures.back().dropped;
+    }
+}
+
+/**
+ * \brief Record a failed assertion.
+ *
+ * This may be called from any thread.  The test is failed atomically.  A
+ * failure on the thread running the test is recorded at once, unless failures
+ * are quiet, and a failure on any other thread is held until the test ends.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param file          The file containing the assertion.
+ * \param line          The line of the assertion.
+ * \param message       The expression which was expected to hold.
+ */
+void minunit_test_fail(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const char* file, int line, const char* message)
+{
+    (void)options;
+    minunit_test_set_pass(context, false);
+
+    minunit_failure_t failure;
+    failure.file = file;
+    failure.line = line;
+    failure.expression = message;
+    failure.thread = MINUNIT_FAILURE_OTHER_THREAD;
+    failure.dropped = 0;
+
+    record_failure(&failure);
+}
+
+void minunit_test_fail_compare(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const char* file, int line, const char* message,
+    const minunit_value_t* lhs, const minunit_value_t* rhs,
+    const minunit_value_t* tolerance)
+{
+    (void)options;
+    minunit_test_set_pass(context, false);
+
+    /* quiet failures are not formatted at all. */
+    if (running_tests && quiet_failures)
+        return;
+
+    minunit_failure_t failure;
+    failure.file = file;
+    failure.line = line;
+    failure.expression = message;
+    failure.lhs = format_value(lhs);
+    failure.rhs = format_value(rhs);
+    failure.thread = MINUNIT_FAILURE_OTHER_THREAD;
+    failure.dropped = 0;
+
+    if (NULL != tolerance)
+        failure.rhs += " +/- " + format_value(tolerance);
+
+    record_failure(&failure);
+}
+
+/**
+ * \brief Set whether a test passes.
+ *
+ * This may be called from any thread.
+ *
+ * \param context       The test context.
+ * \param pass          true if the test passes, and false if it fails.
+ */
+void minunit_test_set_pass(minunit_test_context_t* context, bool pass)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(&context->pass, pass, __ATOMIC_RELAXED);
+#else
+    context->pass = pass;
+#endif
+}
+
+/**
+ * \brief Mark the calling thread as the one running tests, and discard any
+ * failures it recorded that were not collected.
+ */
+void minunit_assert_begin()
+{
+    running_tests = true;
+    test_failures.clear();
+    sunk_failures = 0;
+}
+
+/**
+ * \brief Pass each failure recorded from now on by the thread running the test
+ * to a sink.
+ *
+ * \param sink          The sink, or NULL to hold every failure until the test
+ *                      ends.
+ * \param arg           The argument passed to the sink.
+ */
+void minunit_assert_set_sink(minunit_failure_sink_t sink, void* arg)
+{
+    failure_sink = sink;
+    failure_sink_arg = arg;
+}
+
+/**
+ * \brief Collect the failures of the test, recorded by the thread running it
+ * and then by other threads in the order of their first failures.
+ *
+ * \param failures      The failures to append to.
+ */
+void minunit_assert_end(std::vector<minunit_failure_t>* failures)
+{
+    for (size_t i = sunk_failures; i < test_failures.size(); ++i)
+    {
+        failures->push_back(move(test_failures[i]));
+    }
+
+    test_failures.clear();
+    sunk_failures = 0;
+
+    vector<shared_ptr<thread_messages_t>> held;
+
+    {
+        lock_guard<mutex> guard(registry_lock);
+        held.swap(registry);
+    }
+
+    for (const shared_ptr<thread_messages_t>& messages : held)
+    {
+        vector<minunit_failure_t> thread_failures;
+        unsigned int dropped;
+        int thread_index;
+
+        {
+            lock_guard<mutex> guard(messages->lock);
+
+            thread_failures.swap(messages->messages);
+            dropped = messages->dropped;
+            thread_index = messages->thread_index;
+            messages->dropped = 0;
+            messages->registered = false;
+        }
+
+        for (minunit_failure_t& failure : thread_failures)
+        {
+            failure.thread =
+                thread_index >= 0 ? thread_index : MINUNIT_FAILURE_OTHER_THREAD;
+            failures->push_back(move(failure));
+        }
+
+        if (!thread_failures.empty())
+            failures->back().dropped = dropped;
+    }
+}
+
+/**
+ * \brief Set whether failures on the thread running tests are recorded.
+ *
+ * \param quiet         true to fail the test without recording failures.
+ */
+void minunit_assert_quiet(bool quiet)
+{
+    quiet_failures = quiet;
+}
+
+/**
+ * \brief Set the index under which the calling thread's failures are
+ * recorded.
+ *
+ * \param index         The index of the thread within a concurrent test, or
+ *                      -1 if the thread is not part of one.
+ */
+void minunit_assert_set_thread_index(int index)
+{
+    local_thread_index = index;
+}
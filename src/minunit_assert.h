@@ -0,0 +1,128 @@
+/**
+ * \file src/minunit_assert.h
+ *
+ * \brief Failed assertions, recorded safely from any thread.
+ *
+ * Each failed assertion is recorded as a failure, holding where it failed,
+ * what was expected, and the values compared, if any.  A failure on the
+ * thread running the test is recorded by that thread alone.  A failure on any
+ * other thread is held in a buffer belonging to that thread, so that threads
+ * racing each other only contend with the test runner collecting their
+ * failures.  Once the test ends, its failures are collected together, so that
+ * a forked test runner can send them to the parent, and reporters can render
+ * them, rather than each failure being printed from wherever it happened.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_ASSERT_HEADER_GUARD
+# define MINUNIT_ASSERT_HEADER_GUARD
+
+#include <minunit/minunit.h>
+#include <string>
+#include <vector>
+
+/**
+ * \brief The thread of a failure on the thread running the test, and of a
+ * failure on another thread outside of a concurrent test.  A failure on a
+ * thread of a concurrent test has the index of the thread instead.
+ */
+#define MINUNIT_FAILURE_TEST_THREAD     -1
+#define MINUNIT_FAILURE_OTHER_THREAD    -2
+
+/**
+ * \brief A failed assertion.
+ *
+ * The values compared are empty unless the assertion was a comparison.  A
+ * thread records a limited number of failures for each test, and the number
+ * of further failures it dropped is counted on the last failure it recorded.
+ */
+typedef struct minunit_failure
+{
+    std::string file;
+    int line;
+    std::string expression;
+    std::string lhs;
+    std::string rhs;
+    int thread;
+    unsigned int dropped;
+} minunit_failure_t;
+
+/**
+ * \brief A function which is passed each failure on the thread running the
+ * test as soon as it is recorded.
+ *
+ * \param failure       The failure.
+ * \param arg           The argument given with the sink.
+ */
+typedef void (*minunit_failure_sink_t)(
+    const minunit_failure_t* failure, void* arg);
+
+/**
+ * \brief Mark the calling thread as the one running tests, and discard any
+ * failures it recorded that were not collected.
+ */
+void minunit_assert_begin();
+
+/**
+ * \brief Pass each failure recorded from now on by the thread running the test
+ * to a sink, so that a forked test runner can send it before the test has a
+ * chance to crash.
+ *
+ * Failures passed to the sink are not collected again by minunit_assert_end.
+ * The last failure the thread records for a test is held back, since the
+ * number of failures dropped after it is only known once the test ends.
+ *
+ * \param sink          The sink, or NULL to hold every failure until the test
+ *                      ends.
+ * \param arg           The argument passed to the sink.
+ */
+void minunit_assert_set_sink(minunit_failure_sink_t sink, void* arg);
+
+/**
+ * \brief Collect the failures of the test, recorded by the thread running it
+ * and then by other threads in the order of their first failures.
+ *
+ * \param failures      The failures to append to.
+ */
+void minunit_assert_end(std::vector<minunit_failure_t>* failures);
+
+/**
+ * \brief Set whether failures on the thread running tests are recorded, so
+ * that the examples of a property test can be searched and shrunk without
+ * recording every failure along the way.
+ *
+ * \param quiet         true to fail the test without recording failures.
+ */
+void minunit_assert_quiet(bool quiet);
+
+/**
+ * \brief Set the index under which the calling thread's failures are
+ * recorded.
+ *
+ * \param index         The index of the thread within a concurrent test, or
+ *                      -1 if the thread is not part of one.
+ */
+void minunit_assert_set_thread_index(int index);
+
+/**
+ * \brief Print a failure to standard output.
+ *
+ * \param options       The test options.
+ * \param failure       The failure.
+ */
+void minunit_failure_print(
+    const minunit_test_options_t* options, const minunit_failure_t* failure);
+
+/**
+ * \brief Describe a failure in plain text, as printed but without the error
+ * tag.
+ *
+ * \param failure       The failure.
+ *
+ * \returns the description, with a line for each value compared.
+ */
+std::string minunit_failure_describe(const minunit_failure_t* failure);
+
+#endif /*MINUNIT_ASSERT_HEADER_GUARD*/
@@ -0,0 +1,140 @@
+/**
+ * \file src/minunit_benchmark.cpp
+ *
+ * \brief Calibration and statistics for benchmark tests.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "minunit_benchmark.h"
+
+using namespace std;
+
+/**
+ * \brief Fraction of the benchmark time spent warming up.
+ */
+#define BENCHMARK_WARMUP_DIVISOR 10
+
+/**
+ * \brief Maximum factor by which the iteration count grows per calibration
+ * round.
+ */
+#define BENCHMARK_MAX_GROWTH 100
+
+/**
+ * \brief Run the benchmark body once with the given iteration count.
+ *
+ * \param options       The test options.
+ * \param test          The benchmark test.
+ * \param context       The test context.
+ * \param iterations    The number of iterations to run.
+ *
+ * \returns the elapsed time in nanoseconds.
+ */
+static uint64_t benchmark_sample(
+    const minunit_test_options_t* options, const minunit_test_case_t* test,
+    minunit_test_context_t* context, uint64_t iterations)
+{
+    context->iterations = iterations;
+
+    auto start = chrono::steady_clock::now();
+    test->method(options, context);
+    auto end = chrono::steady_clock::now();
+
+    return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+/**
+ * \brief Run a benchmark test.
+ *
+ * \param options       The test options, which hold the benchmark time and
+ *                      number of samples.
+ * \param test          The benchmark test to run.
+ * \param context       The test context which receives the result.
+ * \param stats         The statistics measured for this benchmark.
+ */
+void minunit_benchmark_run(
+    const minunit_test_options_t* options, const minunit_test_case_t* test,
+    minunit_test_context_t* context, test_benchmark_t* stats)
+{
+    uint64_t target_ns = (uint64_t)options->benchmark_time * 1000000ULL;
+    unsigned int samples = max(1U, options->benchmark_samples);
+    uint64_t sample_ns = max((uint64_t)1, target_ns / samples);
+
+    memset(stats, 0, sizeof(*stats));
+
+    /* warm up caches, branch predictors, and lazy initialization. */
+    uint64_t warmup_ns = 0;
+    do
+    {
+        warmup_ns += benchmark_sample(options, test, context, 1);
+        if (!context->pass)
+            return;
+    } while (warmup_ns < target_ns / BENCHMARK_WARMUP_DIVISOR);
+
+    /* grow the iteration count until a sample takes the sample time. */
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        uint64_t elapsed =
+            benchmark_sample(options, test, context, iterations);
+        if (!context->pass)
+            return;
+
+        if (elapsed >= sample_ns)
+            break;
+
+        double predicted =
+            elapsed > 0
+                ? (double)iterations * 1.2 * sample_ns / elapsed
+                : (double)iterations * BENCHMARK_MAX_GROWTH;
+        predicted =
+            min(predicted, (double)iterations * BENCHMARK_MAX_GROWTH);
+
+        if (predicted >= (double)UINT32_MAX * UINT32_MAX)
+            break;
+
+        iterations = max(iterations + 1, (uint64_t)predicted);
+    }
+
+    /* measure. */
+    vector<double> per_op;
+    per_op.reserve(samples);
+    for (unsigned int i = 0; i < samples; ++i)
+    {
+        uint64_t elapsed =
+            benchmark_sample(options, test, context, iterations);
+        if (!context->pass)
+            return;
+
+        per_op.push_back((double)elapsed / iterations);
+    }
+
+    double sum = 0.0;
+    for (double sample : per_op)
+        sum += sample;
+
+    double mean = sum / samples;
+    double variance = 0.0;
+    for (double sample : per_op)
+        variance += (sample - mean) * (sample - mean);
+
+    sort(per_op.begin(), per_op.end());
+
+    stats->iterations = iterations;
+    stats->samples = samples;
+    stats->mean_ns = mean;
+    stats->median_ns =
+        samples % 2
+            ? per_op[samples / 2]
+            : (per_op[samples / 2 - 1] + per_op[samples / 2]) / 2.0;
+    stats->stddev_ns = samples > 1 ? sqrt(variance / (samples - 1)) : 0.0;
+}
@@ -0,0 +1,35 @@
+/**
+ * \file src/minunit_benchmark.h
+ *
+ * \brief Micro-benchmark support for the minunit test runner.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_BENCHMARK_HEADER_GUARD
+# define MINUNIT_BENCHMARK_HEADER_GUARD
+
+#include <minunit/minunit.h>
+
+#include "minunit_protocol.h"
+
+/**
+ * \brief Run a benchmark test.
+ *
+ * The benchmark body is first run for a short warm-up period.  The iteration
+ * count is then calibrated so that a single sample takes roughly the benchmark
+ * time divided by the number of samples, and the body is run once per sample
+ * with that iteration count.
+ *
+ * \param options       The test options, which hold the benchmark time and
+ *                      number of samples.
+ * \param test          The benchmark test to run.
+ * \param context       The test context which receives the result.
+ * \param stats         The statistics measured for this benchmark.
+ */
+void minunit_benchmark_run(
+    const minunit_test_options_t* options, const minunit_test_case_t* test,
+    minunit_test_context_t* context, test_benchmark_t* stats);
+
+#endif /*MINUNIT_BENCHMARK_HEADER_GUARD*/
@@ -0,0 +1,106 @@
+/**
+ * \file src/minunit_concurrent.cpp
+ *
+ * \brief Run the body of a concurrent test on several threads at once.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "minunit_assert.h"
+
+using namespace std;
+
+/**
+ * \brief The barrier which releases the threads of a concurrent test.
+ *
+ * The threads spin rather than sleep on the barrier, so that they start the
+ * body as close together as the scheduler allows, which gives races in the
+ * code under test the best chance to show.
+ */
+typedef struct concurrent_barrier
+{
+    atomic<unsigned int> ready;
+    atomic<bool> released;
+} concurrent_barrier_t;
+
+/**
+ * \brief Run the body of a concurrent test on one of its threads.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param func          The body of the test.
+ * \param index         The index of this thread.
+ * \param barrier       The barrier to wait on before running the body.
+ */
+static void run_concurrent_thread(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    minunit_thread_func_t func, unsigned int index,
+    concurrent_barrier_t* barrier)
+{
+    minunit_assert_set_thread_index((int)index);
+
+    barrier->ready.fetch_add(1, memory_order_acq_rel);
+    while (!barrier->released.load(memory_order_acquire))
+        this_thread::yield();
+
+    func(options, context, index);
+}
+
+/**
+ * \brief Run the body of a concurrent test on the given number of threads,
+ * released together once every thread has started.
+ *
+ * \param options       The test options.
+ * \param context       The test context, shared by every thread.
+ * \param threads       The number of threads to run the body on.
+ * \param func          The body of the test.
+ */
+void minunit_run_concurrent(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    unsigned int threads, minunit_thread_func_t func)
+{
+    concurrent_barrier_t barrier;
+    barrier.ready.store(0);
+    barrier.released.store(false);
+
+    vector<thread> started;
+    started.reserve(threads);
+
+    for (unsigned int index = 0; index < threads; ++index)
+    {
+        try
+        {
+            started.emplace_back(
+                run_concurrent_thread, options, context, func, index,
+                &barrier);
+        }
+        catch (const system_error&)
+        {
+            char message[80];
+            snprintf(
+                message, sizeof(message),
+                "%u test threads to start, started %u", threads, index);
+            minunit_test_fail(options, context, __FILE__, __LINE__, message);
+            break;
+        }
+    }
+
+    /* release the threads together, or let the ones started run down. */
+    while (barrier.ready.load(memory_order_acquire) < started.size())
+        this_thread::yield();
+
+    barrier.released.store(true, memory_order_release);
+
+    for (thread& t : started)
+    {
+        t.join();
+    }
+}
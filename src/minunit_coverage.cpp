@@ -0,0 +1,1001 @@
+/**
+ * \file src/minunit_coverage.cpp
+ *
+ * \brief Per-test coverage capture, and selection of the tests affected by a
+ * change.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef COVERAGE_CAPTURE
+# include <dirent.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "minunit_coverage.h"
+
+using namespace std;
+
+/**
+ * \brief First line of a coverage index.
+ */
+#define MINUNIT_COVERAGE_HEADER "# minunit coverage 1"
+
+#ifdef COVERAGE_CAPTURE
+
+/**
+ * \brief Magic numbers of gcov data and note files.
+ */
+#define GCOV_DATA_MAGIC                 0x67636461
+#define GCOV_NOTE_MAGIC                 0x67636e6f
+
+/**
+ * \brief Tags of the gcov records read here.
+ */
+#define GCOV_TAG_FUNCTION               0x01000000
+#define GCOV_TAG_ARCS_COUNTER           0x01a10000
+
+/**
+ * \brief The hooks provided by libgcov.  These are weak, so that an executable
+ * built without coverage still links, and only runs without capturing it.
+ */
+extern "C" void __gcov_reset(void) __attribute__((weak));
+extern "C" void __gcov_dump(void) __attribute__((weak));
+
+/**
+ * \brief A function described by a gcov note file.
+ */
+typedef struct gcov_function
+{
+    string source;
+    unsigned int first;
+    unsigned int last;
+} gcov_function_t;
+
+/**
+ * \brief The functions described by a gcov note file, keyed by their ident
+ * and line number checksum.
+ */
+typedef struct gcov_notes
+{
+    bool valid;
+    uint32_t stamp;
+    map<pair<uint32_t, uint32_t>, gcov_function_t> functions;
+} gcov_notes_t;
+
+/**
+ * \brief A cursor over the words of a gcov file.
+ *
+ * Before GCC 12, record lengths are counted in words, and strings are padded
+ * to a whole number of words.  From GCC 12, lengths are counted in bytes, and
+ * strings are not padded.
+ */
+typedef struct gcov_reader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    unsigned int major;
+} gcov_reader_t;
+
+static string capture_dir;
+static map<string, gcov_notes_t> notes_cache;
+
+/**
+ * \brief Get the major version of GCC which wrote a gcov file.
+ *
+ * \param version       The version word of the file.
+ *
+ * \returns the major version.
+ */
+static unsigned int gcov_major(uint32_t version)
+{
+    char major = (char)(version >> 24);
+    char minor = (char)(version >> 16);
+
+    if (major >= 'A')
+        return (major - 'A') * 10 + (minor - '0');
+
+    return major - '0';
+}
+
+/**
+ * \brief Read a word from a gcov file.
+ *
+ * \param reader        The reader.
+ * \param word          Set to the word read.
+ *
+ * \returns true on success, and false at the end of the data.
+ */
+static bool read_word(gcov_reader_t* reader, uint32_t* word)
+{
+    if (reader->size - reader->offset < sizeof(*word))
+        return false;
+
+    memcpy(word, reader->data + reader->offset, sizeof(*word));
+    reader->offset += sizeof(*word);
+
+    return true;
+}
+
+/**
+ * \brief Get the number of bytes of a record or string of the given length.
+ *
+ * \param reader        The reader.
+ * \param length        The length read from the file.
+ *
+ * \returns the number of bytes that follow the length.
+ */
+static size_t gcov_bytes(const gcov_reader_t* reader, uint32_t length)
+{
+    if (reader->major < 12)
+        return (size_t)length * 4;
+
+    /* a negative length marks counters which are all zero, and omitted. */
+    if ((int32_t)length < 0)
+        return 0;
+
+    return length;
+}
+
+/**
+ * \brief Read a string from a gcov file.
+ *
+ * \param reader        The reader.
+ * \param str           Set to the string read.
+ *
+ * \returns true on success, and false at the end of the data.
+ */
+static bool read_string(gcov_reader_t* reader, string* str)
+{
+    uint32_t length;
+    if (!read_word(reader, &length))
+        return false;
+
+    size_t bytes = gcov_bytes(reader, length);
+    if (reader->size - reader->offset < bytes)
+        return false;
+
+    const char* start = (const char*)reader->data + reader->offset;
+    str->assign(start, strnlen(start, bytes));
+    reader->offset += bytes;
+
+    return true;
+}
+
+/**
+ * \brief Read a whole file.
+ *
+ * \param path          The path of the file.
+ * \param data          Set to the contents of the file.
+ *
+ * \returns true on success, and false on failure.
+ */
+static bool read_file(const string& path, vector<uint8_t>* data)
+{
+    FILE* in = fopen(path.c_str(), "rb");
+    if (NULL == in)
+        return false;
+
+    uint8_t buffer[65536];
+    size_t count;
+
+    data->clear();
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        data->insert(data->end(), buffer, buffer + count);
+
+    bool valid = !ferror(in);
+    fclose(in);
+
+    return valid;
+}
+
+/**
+ * \brief Read the header of a gcov file.
+ *
+ * \param reader        The reader.
+ * \param magic         The magic number expected.
+ * \param stamp         Set to the stamp shared by the note and data files of
+ *                      an object.
+ *
+ * \returns true if the header is that of a supported version, and false
+ * otherwise.
+ */
+static bool read_header(gcov_reader_t* reader, uint32_t magic, uint32_t* stamp)
+{
+    uint32_t word;
+    uint32_t version;
+
+    if (!read_word(reader, &word) || magic != word
+     || !read_word(reader, &version) || !read_word(reader, stamp))
+    {
+        return false;
+    }
+
+    /* function line ranges are only recorded from GCC 8. */
+    reader->major = gcov_major(version);
+    if (reader->major < 8)
+        return false;
+
+    /* GCC 12 adds a checksum to the header. */
+    if (reader->major >= 12 && !read_word(reader, &word))
+        return false;
+
+    return true;
+}
+
+/**
+ * \brief Read the functions described by a gcov note file.
+ *
+ * \param path          The path of the note file.
+ * \param notes         The notes to populate.
+ *
+ * \returns true on success, and false if the file could not be read or is not
+ * understood.
+ */
+static bool read_notes(const string& path, gcov_notes_t* notes)
+{
+    vector<uint8_t> data;
+    if (!read_file(path, &data))
+        return false;
+
+    gcov_reader_t reader = { data.data(), data.size(), 0, 0 };
+    string cwd;
+    uint32_t word;
+
+    /* the working directory of the compiler, and unexecuted block support. */
+    if (!read_header(&reader, GCOV_NOTE_MAGIC, &notes->stamp)
+     || !read_string(&reader, &cwd) || !read_word(&reader, &word))
+    {
+        return false;
+    }
+
+    uint32_t tag;
+    uint32_t length;
+
+    while (read_word(&reader, &tag) && read_word(&reader, &length))
+    {
+        size_t bytes = gcov_bytes(&reader, length);
+        if (reader.size - reader.offset < bytes)
+            return false;
+
+        gcov_reader_t record = reader;
+        record.size = reader.offset + bytes;
+        reader.offset += bytes;
+
+        if (GCOV_TAG_FUNCTION != tag)
+            continue;
+
+        uint32_t ident, lineno_checksum, cfg_checksum, artificial;
+        uint32_t first, column, last;
+        string name;
+        gcov_function_t function;
+
+        if (!read_word(&record, &ident)
+         || !read_word(&record, &lineno_checksum)
+         || !read_word(&record, &cfg_checksum)
+         || !read_string(&record, &name)
+         || !read_word(&record, &artificial)
+         || !read_string(&record, &function.source)
+         || !read_word(&record, &first) || !read_word(&record, &column)
+         || !read_word(&record, &last))
+        {
+            return false;
+        }
+
+        /* compiler generated functions have no lines of their own. */
+        if (artificial)
+            continue;
+
+        if ('/' != function.source[0] && "" != cwd)
+            function.source = cwd + "/" + function.source;
+
+        function.first = first;
+        function.last = max(first, last);
+        notes->functions[make_pair(ident, lineno_checksum)] = function;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Get the functions described by a gcov note file, reading the file on
+ * first use.
+ *
+ * \param path          The path of the note file.
+ *
+ * \returns the notes, which are invalid if the file could not be read.
+ */
+static const gcov_notes_t* get_notes(const string& path)
+{
+    auto i = notes_cache.find(path);
+    if (notes_cache.end() != i)
+        return &i->second;
+
+    gcov_notes_t* notes = &notes_cache[path];
+    notes->valid = read_notes(path, notes);
+
+    return notes;
+}
+
+/**
+ * \brief Add the functions executed according to a gcov data file to the
+ * coverage of a test.
+ *
+ * A function was executed if any of its arc counters is nonzero, since the
+ * counts of the remaining arcs are derived from them.
+ *
+ * \param path          The path of the data file.
+ * \param notes         The notes of the object the data file belongs to.
+ * \param coverage      The coverage to add to.
+ */
+static void read_data(
+    const string& path, const gcov_notes_t* notes,
+    minunit_test_coverage_t* coverage)
+{
+    vector<uint8_t> data;
+    if (!read_file(path, &data))
+        return;
+
+    gcov_reader_t reader = { data.data(), data.size(), 0, 0 };
+    uint32_t stamp;
+
+    /* data left by an older build of the object can't be matched. */
+    if (!read_header(&reader, GCOV_DATA_MAGIC, &stamp)
+     || stamp != notes->stamp)
+    {
+        return;
+    }
+
+    const gcov_function_t* function = nullptr;
+    uint32_t tag;
+    uint32_t length;
+
+    while (read_word(&reader, &tag) && read_word(&reader, &length))
+    {
+        size_t bytes = gcov_bytes(&reader, length);
+        if (reader.size - reader.offset < bytes)
+            return;
+
+        gcov_reader_t record = reader;
+        record.size = reader.offset + bytes;
+        reader.offset += bytes;
+
+        if (GCOV_TAG_FUNCTION == tag)
+        {
+            uint32_t ident, lineno_checksum;
+            function = nullptr;
+
+            if (read_word(&record, &ident)
+             && read_word(&record, &lineno_checksum))
+            {
+                auto i =
+                    notes->functions.find(make_pair(ident, lineno_checksum));
+                if (notes->functions.end() != i)
+                    function = &i->second;
+            }
+        }
+        else if (GCOV_TAG_ARCS_COUNTER == tag && nullptr != function)
+        {
+            uint32_t word;
+            bool executed = false;
+
+            while (!executed && read_word(&record, &word))
+                executed = 0 != word;
+
+            if (executed)
+            {
+                (*coverage)[function->source].push_back(
+                    make_pair(function->first, function->last));
+            }
+
+            function = nullptr;
+        }
+    }
+}
+
+/**
+ * \brief Find the gcov data files in a directory tree.
+ *
+ * \param dir           The directory to search.
+ * \param files         The paths of the data files found.
+ */
+static void find_data_files(const string& dir, vector<string>* files)
+{
+    DIR* d = opendir(dir.c_str());
+    if (NULL == d)
+        return;
+
+    vector<string> subdirs;
+    struct dirent* entry;
+
+    while (NULL != (entry = readdir(d)))
+    {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+
+        string path = dir + "/" + entry->d_name;
+        struct stat st;
+
+        if (0 != lstat(path.c_str(), &st))
+            continue;
+
+        size_t length = strlen(entry->d_name);
+
+        if (S_ISDIR(st.st_mode))
+            subdirs.push_back(path);
+        else if (length > 5 && !strcmp(entry->d_name + length - 5, ".gcda"))
+            files->push_back(path);
+    }
+
+    closedir(d);
+
+    for (const string& subdir : subdirs)
+        find_data_files(subdir, files);
+}
+
+/**
+ * \brief Remove a directory tree.
+ *
+ * \param dir           The directory to remove.
+ */
+static void remove_tree(const string& dir)
+{
+    DIR* d = opendir(dir.c_str());
+    if (NULL == d)
+        return;
+
+    vector<string> subdirs;
+    struct dirent* entry;
+
+    while (NULL != (entry = readdir(d)))
+    {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+
+        string path = dir + "/" + entry->d_name;
+        struct stat st;
+
+        if (0 == lstat(path.c_str(), &st) && S_ISDIR(st.st_mode))
+            subdirs.push_back(path);
+        else
+            unlink(path.c_str());
+    }
+
+    closedir(d);
+
+    for (const string& subdir : subdirs)
+        remove_tree(subdir);
+
+    rmdir(dir.c_str());
+}
+
+/**
+ * \brief Sort ranges of lines, and merge those which overlap or touch.
+ *
+ * \param ranges        The ranges to merge.
+ */
+static void merge_ranges(minunit_line_ranges_t* ranges)
+{
+    sort(ranges->begin(), ranges->end());
+
+    minunit_line_ranges_t merged;
+    for (const auto& range : *ranges)
+    {
+        if (!merged.empty() && range.first <= merged.back().second + 1)
+            merged.back().second = max(merged.back().second, range.second);
+        else
+            merged.push_back(range);
+    }
+
+    ranges->swap(merged);
+}
+
+#endif /*COVERAGE_CAPTURE*/
+
+/**
+ * \brief Determine whether the coverage hooks of libgcov are linked into this
+ * executable.
+ *
+ * \returns true if coverage can be captured, and false otherwise.
+ */
+bool minunit_coverage_available()
+{
+#ifdef COVERAGE_CAPTURE
+    return nullptr != &__gcov_reset && nullptr != &__gcov_dump;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Start capturing the coverage of each test, into a temporary
+ * directory.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+bool minunit_coverage_capture_start()
+{
+#ifdef COVERAGE_CAPTURE
+    const char* tmp = getenv("TMPDIR");
+    string dir =
+        string(NULL != tmp && strcmp(tmp, "") ? tmp : "/tmp")
+      + "/minunit-coverage.XXXXXX";
+    if (NULL == mkdtemp(&dir[0]))
+        return false;
+
+    /* data files are found by their full paths under the test's directory. */
+    unsetenv("GCOV_PREFIX_STRIP");
+    capture_dir = dir;
+
+    return true;
+#else
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+/**
+ * \brief Reset the coverage counters before a test, if coverage is being
+ * captured.
+ */
+void minunit_coverage_test_begin()
+{
+#ifdef COVERAGE_CAPTURE
+    if ("" != capture_dir)
+        __gcov_reset();
+#endif
+}
+
+/**
+ * \brief Dump the coverage counters after a test, if coverage is being
+ * captured.
+ *
+ * libgcov writes each data file under the directory named by GCOV_PREFIX,
+ * creating the directories it needs, and merges with any data already there.
+ *
+ * \param index         The plan index of the test.
+ */
+void minunit_coverage_test_end(uint32_t index)
+{
+#ifdef COVERAGE_CAPTURE
+    if ("" == capture_dir)
+        return;
+
+    string prefix = capture_dir + "/" + to_string(index);
+    setenv("GCOV_PREFIX", prefix.c_str(), 1);
+    __gcov_dump();
+#else
+    (void)index;
+#endif
+}
+
+/**
+ * \brief Read the coverage captured for a test.
+ *
+ * Each data file was dumped under the test's directory by its full path, and
+ * its note file is found alongside the object it was dumped for.
+ *
+ * \param index         The plan index of the test.
+ * \param coverage      The coverage to populate.
+ *
+ * \returns true if coverage was captured for the test, and false otherwise.
+ */
+bool minunit_coverage_collect(
+    uint32_t index, minunit_test_coverage_t* coverage)
+{
+    coverage->clear();
+
+#ifdef COVERAGE_CAPTURE
+    if ("" == capture_dir)
+        return false;
+
+    string prefix = capture_dir + "/" + to_string(index);
+    struct stat st;
+    if (0 != stat(prefix.c_str(), &st))
+        return false;
+
+    vector<string> files;
+    find_data_files(prefix, &files);
+
+    for (const string& path : files)
+    {
+        string object = path.substr(prefix.size());
+        const gcov_notes_t* notes =
+            get_notes(object.substr(0, object.size() - 5) + ".gcno");
+
+        if (notes->valid)
+            read_data(path, notes, coverage);
+    }
+
+    for (auto& source : *coverage)
+        merge_ranges(&source.second);
+
+    return true;
+#else
+    (void)index;
+    return false;
+#endif
+}
+
+/**
+ * \brief Stop capturing coverage, and remove the temporary directory.
+ */
+void minunit_coverage_capture_stop()
+{
+#ifdef COVERAGE_CAPTURE
+    if ("" == capture_dir)
+        return;
+
+    remove_tree(capture_dir);
+    capture_dir = "";
+    notes_cache.clear();
+#endif
+}
+
+/**
+ * \brief Read a line of any length from a file.
+ *
+ * \param in            The file.
+ * \param line          Set to the line, without its newline.
+ *
+ * \returns true if a line was read, and false at the end of the file.
+ */
+static bool read_line(FILE* in, string* line)
+{
+    char buffer[1024];
+
+    line->clear();
+    while (NULL != fgets(buffer, sizeof(buffer), in))
+    {
+        *line += buffer;
+
+        if ('\n' == line->back())
+        {
+            line->pop_back();
+            return true;
+        }
+    }
+
+    return "" != *line;
+}
+
+/**
+ * \brief Parse a line number.
+ *
+ * \param value         The line number to parse.
+ * \param line          Set to the line number.
+ *
+ * \returns true on success, and false if the line number is malformed.
+ */
+static bool parse_line_number(const string& value, unsigned int* line)
+{
+    char* end = nullptr;
+    unsigned long number = strtoul(value.c_str(), &end, 10);
+
+    if ("" == value || !isdigit((unsigned char)value[0]) || '\0' != *end
+     || 0 == number || number > UINT_MAX)
+    {
+        return false;
+    }
+
+    *line = (unsigned int)number;
+
+    return true;
+}
+
+/**
+ * \brief Parse a range of lines, of the form "LINE" or "FIRST-LAST".
+ *
+ * \param value         The range to parse.
+ * \param range         Set to the range.
+ *
+ * \returns true on success, and false if the range is malformed.
+ */
+static bool parse_line_range(
+    const string& value, pair<unsigned int, unsigned int>* range)
+{
+    size_t dash = value.find('-');
+
+    if (string::npos == dash)
+    {
+        if (!parse_line_number(value, &range->first))
+            return false;
+
+        range->second = range->first;
+        return true;
+    }
+
+    return
+        parse_line_number(value.substr(0, dash), &range->first)
+     && parse_line_number(value.substr(dash + 1), &range->second)
+     && range->first <= range->second;
+}
+
+/**
+ * \brief Split a comma separated list, dropping empty items.
+ *
+ * \param list          The list.
+ *
+ * \returns the items of the list.
+ */
+static vector<string> split_list(const char* list)
+{
+    vector<string> items;
+    string item;
+
+    for (const char* ch = list; ; ++ch)
+    {
+        if (',' == *ch || '\0' == *ch)
+        {
+            if ("" != item)
+                items.push_back(item);
+
+            item.clear();
+        }
+        else
+        {
+            item += *ch;
+        }
+
+        if ('\0' == *ch)
+            break;
+    }
+
+    return items;
+}
+
+/**
+ * \brief Load a coverage index from a file.
+ *
+ * \param path          The path of the file.
+ * \param index         The index to add the loaded coverage to.
+ *
+ * \returns true on success, and false if the file could not be read or is
+ * malformed.  errno is set if the file could not be opened.
+ */
+bool minunit_coverage_load(const char* path, minunit_coverage_index_t* index)
+{
+    FILE* in = fopen(path, "r");
+    if (NULL == in)
+    {
+        return false;
+    }
+
+    string line;
+    minunit_test_coverage_t* coverage = nullptr;
+    bool valid = true;
+
+    while (valid && read_line(in, &line))
+    {
+        if ("" == line || '#' == line[0])
+            continue;
+
+        if (' ' != line[0])
+        {
+            coverage = &(*index)[line];
+            coverage->clear();
+            continue;
+        }
+
+        size_t space = line.find(' ', 1);
+        if (nullptr == coverage || string::npos == space
+         || space + 1 == line.size())
+        {
+            valid = false;
+            break;
+        }
+
+        minunit_line_ranges_t* ranges = &(*coverage)[line.substr(space + 1)];
+        string list = line.substr(1, space - 1);
+
+        for (const string& item : split_list(list.c_str()))
+        {
+            pair<unsigned int, unsigned int> range;
+            if (!parse_line_range(item, &range))
+            {
+                valid = false;
+                break;
+            }
+
+            ranges->push_back(range);
+        }
+    }
+
+    if (ferror(in))
+    {
+        valid = false;
+    }
+
+    fclose(in);
+
+    if (!valid)
+    {
+        errno = EINVAL;
+    }
+
+    return valid;
+}
+
+/**
+ * \brief Save a coverage index to a file.
+ *
+ * \param path          The path of the file.
+ * \param index         The index to save.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+bool minunit_coverage_save(
+    const char* path, const minunit_coverage_index_t& index)
+{
+    string temp = string(path) + ".tmp";
+
+    FILE* out = fopen(temp.c_str(), "w");
+    if (NULL == out)
+    {
+        return false;
+    }
+
+    fprintf(out, "%s\n", MINUNIT_COVERAGE_HEADER);
+    fprintf(out, "# test, then \" first-last,... source\" for each source\n");
+
+    for (const auto& test : index)
+    {
+        fprintf(out, "%s\n", test.first.c_str());
+
+        for (const auto& source : test.second)
+        {
+            const char* separator = " ";
+
+            for (const auto& range : source.second)
+            {
+                if (range.first == range.second)
+                    fprintf(out, "%s%u", separator, range.first);
+                else
+                    fprintf(out, "%s%u-%u", separator, range.first,
+                            range.second);
+
+                separator = ",";
+            }
+
+            fprintf(out, " %s\n", source.first.c_str());
+        }
+    }
+
+    bool written = !ferror(out);
+    int error = errno;
+
+    if (0 != fclose(out))
+    {
+        written = false;
+        error = errno;
+    }
+
+    if (!written || 0 != rename(temp.c_str(), path))
+    {
+        if (written)
+            error = errno;
+
+        remove(temp.c_str());
+        errno = error;
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Parse a comma separated list of changed files.
+ *
+ * \param list          The list of files.
+ * \param changes       The changes to append to.
+ *
+ * \returns true on success, and false if the list is malformed.
+ */
+bool minunit_coverage_parse_files(
+    const char* list, vector<minunit_change_t>* changes)
+{
+    for (const string& item : split_list(list))
+    {
+        changes->push_back({ item, 1, UINT_MAX });
+    }
+
+    return true;
+}
+
+/**
+ * \brief Parse a comma separated list of changed lines, each of the form
+ * "FILE:LINE" or "FILE:FIRST-LAST".
+ *
+ * \param list          The list of lines.
+ * \param changes       The changes to append to.
+ *
+ * \returns true on success, and false if the list is malformed.
+ */
+bool minunit_coverage_parse_lines(
+    const char* list, vector<minunit_change_t>* changes)
+{
+    for (const string& item : split_list(list))
+    {
+        size_t colon = item.rfind(':');
+        pair<unsigned int, unsigned int> range;
+
+        if (string::npos == colon || 0 == colon
+         || !parse_line_range(item.substr(colon + 1), &range))
+        {
+            return false;
+        }
+
+        changes->push_back(
+            { item.substr(0, colon), range.first, range.second });
+    }
+
+    return true;
+}
+
+/**
+ * \brief Determine whether a change names a covered source file.
+ *
+ * \param source        The path of the covered source file.
+ * \param change        The path given by the change.
+ *
+ * \returns true if the change names the source file, and false otherwise.
+ */
+static bool same_source(const string& source, const string& change)
+{
+    string path = change;
+    while (0 == path.compare(0, 2, "./"))
+        path.erase(0, 2);
+
+    if (path.size() > source.size()
+     || 0 != source.compare(source.size() - path.size(), path.size(), path))
+    {
+        return false;
+    }
+
+    return
+        path.size() == source.size() || '/' == path[0]
+     || '/' == source[source.size() - path.size() - 1];
+}
+
+/**
+ * \brief Determine whether a test covers any of the changes.
+ *
+ * \param coverage      The coverage of the test.
+ * \param changes       The changes.
+ *
+ * \returns true if the test is affected by the changes, and false otherwise.
+ */
+bool minunit_coverage_affected(
+    const minunit_test_coverage_t& coverage,
+    const vector<minunit_change_t>& changes)
+{
+    for (const minunit_change_t& change : changes)
+    {
+        for (const auto& source : coverage)
+        {
+            if (!same_source(source.first, change.path))
+                continue;
+
+            for (const auto& range : source.second)
+            {
+                if (range.first <= change.last && range.second >= change.first)
+                    return true;
+            }
+        }
+    }
+
+    return false;
+}
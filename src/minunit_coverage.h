@@ -0,0 +1,171 @@
+/**
+ * \file src/minunit_coverage.h
+ *
+ * \brief Per-test coverage capture, and selection of the tests affected by a
+ * change.
+ *
+ * When coverage is captured, the coverage counters are reset before each test
+ * and dumped after it into a directory of its own, by way of the hooks that
+ * libgcov provides.  The coverage of each test is then read back as the
+ * functions it executed, and saved in a coverage index.
+ *
+ * The index is a plain text file.  Each test is named on a line of its own,
+ * and is followed by a line for each source file it covers, holding the
+ * ranges of lines of the functions it executed and then the path of the
+ * source file, indented by a space.  Lines beginning with '#' are comments.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_COVERAGE_HEADER_GUARD
+# define MINUNIT_COVERAGE_HEADER_GUARD
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Sorted, disjoint ranges of lines, each from its first line to its
+ * last line inclusive.
+ */
+typedef std::vector<std::pair<unsigned int, unsigned int>>
+    minunit_line_ranges_t;
+
+/**
+ * \brief The lines covered by a test, keyed by source path.
+ */
+typedef std::map<std::string, minunit_line_ranges_t> minunit_test_coverage_t;
+
+/**
+ * \brief The coverage of each test, keyed by "suite::test".
+ */
+typedef std::map<std::string, minunit_test_coverage_t>
+    minunit_coverage_index_t;
+
+/**
+ * \brief A changed range of lines in a source file.  A changed file is a range
+ * covering every line.
+ */
+typedef struct minunit_change
+{
+    std::string path;
+    unsigned int first;
+    unsigned int last;
+} minunit_change_t;
+
+/**
+ * \brief Determine whether the coverage hooks of libgcov are linked into this
+ * executable.
+ *
+ * \returns true if coverage can be captured, and false otherwise.
+ */
+bool minunit_coverage_available();
+
+/**
+ * \brief Start capturing the coverage of each test, into a temporary
+ * directory.
+ *
+ * This must be called before any test runner is forked.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+bool minunit_coverage_capture_start();
+
+/**
+ * \brief Reset the coverage counters before a test, if coverage is being
+ * captured.
+ */
+void minunit_coverage_test_begin();
+
+/**
+ * \brief Dump the coverage counters after a test, if coverage is being
+ * captured.
+ *
+ * \param index         The plan index of the test.
+ */
+void minunit_coverage_test_end(uint32_t index);
+
+/**
+ * \brief Read the coverage captured for a test.
+ *
+ * \param index         The plan index of the test.
+ * \param coverage      The coverage to populate.
+ *
+ * \returns true if coverage was captured for the test, and false otherwise.
+ */
+bool minunit_coverage_collect(
+    uint32_t index, minunit_test_coverage_t* coverage);
+
+/**
+ * \brief Stop capturing coverage, and remove the temporary directory.
+ */
+void minunit_coverage_capture_stop();
+
+/**
+ * \brief Load a coverage index from a file.
+ *
+ * \param path          The path of the file.
+ * \param index         The index to add the loaded coverage to.
+ *
+ * \returns true on success, and false if the file could not be read or is
+ * malformed.  errno is set if the file could not be opened.
+ */
+bool minunit_coverage_load(const char* path, minunit_coverage_index_t* index);
+
+/**
+ * \brief Save a coverage index to a file.
+ *
+ * The index is written to a temporary file which then replaces the file, so
+ * that readers never see a partially written file.
+ *
+ * \param path          The path of the file.
+ * \param index         The index to save.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+bool minunit_coverage_save(
+    const char* path, const minunit_coverage_index_t& index);
+
+/**
+ * \brief Parse a comma separated list of changed files.
+ *
+ * \param list          The list of files.
+ * \param changes       The changes to append to.
+ *
+ * \returns true on success, and false if the list is malformed.
+ */
+bool minunit_coverage_parse_files(
+    const char* list, std::vector<minunit_change_t>* changes);
+
+/**
+ * \brief Parse a comma separated list of changed lines, each of the form
+ * "FILE:LINE" or "FILE:FIRST-LAST".
+ *
+ * \param list          The list of lines.
+ * \param changes       The changes to append to.
+ *
+ * \returns true on success, and false if the list is malformed.
+ */
+bool minunit_coverage_parse_lines(
+    const char* list, std::vector<minunit_change_t>* changes);
+
+/**
+ * \brief Determine whether a test covers any of the changes.
+ *
+ * A change names the same file as a covered source path if it is that path,
+ * or a suffix of it starting after a '/', so that changes may be given
+ * relative to the root of the source tree.
+ *
+ * \param coverage      The coverage of the test.
+ * \param changes       The changes.
+ *
+ * \returns true if the test is affected by the changes, and false otherwise.
+ */
+bool minunit_coverage_affected(
+    const minunit_test_coverage_t& coverage,
+    const std::vector<minunit_change_t>& changes);
+
+#endif /*MINUNIT_COVERAGE_HEADER_GUARD*/
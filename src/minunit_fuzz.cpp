@@ -0,0 +1,940 @@
+/**
+ * \file src/minunit_fuzz.cpp
+ *
+ * \brief Fuzz tests, replayed from their corpus in a normal run, and fuzzed
+ * with coverage feedback on request.
+ *
+ * Each process counts the edges it takes in a map of its own, from the
+ * callbacks of -fsanitize-coverage.  Clang numbers each edge with a guard
+ * under trace-pc-guard, and GCC reports each block under trace-pc, from which
+ * edges are hashed from consecutive blocks.  While fuzzing, the counts are
+ * bucketed by magnitude, and the buckets seen by any test runner are merged
+ * into a map shared by every test runner, so that an input is only kept when
+ * no test runner has already reached what it reaches.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <minunit/minunit.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef HAS_OPENDIR
+# include <dirent.h>
+#endif
+
+#ifdef FUZZ_RUNNER
+# include <sys/mman.h>
+# include <sys/wait.h>
+#endif
+
+#include "minunit_assert.h"
+#include "minunit_fuzz.h"
+
+using namespace std;
+
+/**
+ * \brief The number of edges counted, beyond which edges share counters.
+ */
+#define FUZZ_MAP_SIZE 65536
+
+/**
+ * \brief The largest input generated by mutation.
+ */
+#define FUZZ_MAX_INPUT 4096
+
+/**
+ * \brief The exit status of a test runner whose input failed an assertion.
+ */
+#define FUZZ_FAILED_STATUS 86
+
+/**
+ * \brief How often, in milliseconds, a test runner picks up the inputs added
+ * to the corpus by the others, and the parent checks on the test runners.
+ */
+#define FUZZ_RELOAD_INTERVAL 1000
+#define FUZZ_POLL_INTERVAL 50
+
+/**
+ * \brief The directory, under the current directory, which holds the inputs
+ * found by fuzzing when no corpus directory is given.
+ */
+#define FUZZ_OUTPUT_DIR "fuzz-corpus"
+
+/**
+ * \brief How long, in milliseconds, an input may run before it is deemed to
+ * hang, unless the test runner has a timeout of its own.
+ */
+#define FUZZ_DEFAULT_HANG_TIME 10000
+
+static uint8_t edge_map[FUZZ_MAP_SIZE];
+static uint32_t guard_count;
+static uintptr_t previous_block;
+
+/**
+ * \brief Number the edge guards of a module instrumented with trace-pc-guard.
+ */
+extern "C" void __sanitizer_cov_trace_pc_guard_init(
+    uint32_t* start, uint32_t* stop)
+{
+    if (start == stop || 0 != *start)
+        return;
+
+    for (uint32_t* guard = start; guard < stop; ++guard)
+    {
+        *guard = ++guard_count;
+    }
+}
+
+/**
+ * \brief Count an edge instrumented with trace-pc-guard.
+ */
+extern "C" void __sanitizer_cov_trace_pc_guard(uint32_t* guard)
+{
+    if (0 != *guard)
+        ++edge_map[*guard % FUZZ_MAP_SIZE];
+}
+
+/**
+ * \brief Count the edge into a block instrumented with trace-pc, from the
+ * block before it.
+ */
+extern "C" void __sanitizer_cov_trace_pc()
+{
+    uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+    uintptr_t block = (pc ^ (pc >> 16)) * 0x9e3779b1U;
+
+    ++edge_map[(block ^ previous_block) % FUZZ_MAP_SIZE];
+    previous_block = block >> 1;
+}
+
+/**
+ * \brief Read an input from a file.
+ *
+ * \param path          The path of the file.
+ * \param input         The input to populate.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+static bool read_input(const string& path, vector<uint8_t>* input)
+{
+    FILE* in = fopen(path.c_str(), "rb");
+    if (NULL == in)
+        return false;
+
+    input->clear();
+
+    uint8_t buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        input->insert(input->end(), buffer, buffer + size);
+    }
+
+    bool ok = !ferror(in);
+    fclose(in);
+
+    return ok;
+}
+
+void minunit_run_fuzz_input(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    minunit_fuzz_func_t func)
+{
+    vector<uint8_t> input;
+
+    if (NULL != context->input && !read_input(context->input, &input))
+    {
+        printf("Could not read fuzz input %s: %s.\n",
+               context->input, strerror(errno));
+        minunit_test_set_pass(context, false);
+        return;
+    }
+
+    /* an empty input still points somewhere. */
+    input.reserve(1);
+    func(options, context, input.data(), input.size());
+}
+
+std::string minunit_fuzz_seed_dir(const minunit_test_case_t* test)
+{
+    string file = test->file;
+    size_t slash = file.rfind('/');
+    string dir = string::npos != slash ? file.substr(0, slash) : ".";
+
+    return dir + "/corpus/" + test->name;
+}
+
+std::string minunit_fuzz_corpus_dir(
+    const minunit_test_options_t* options, const minunit_test_case_t* test)
+{
+    if (NULL != options->corpus)
+        return string(options->corpus) + "/" + test->name;
+
+    return minunit_fuzz_seed_dir(test);
+}
+
+void minunit_fuzz_corpus_inputs(
+    const std::string& dir, std::vector<std::string>* names)
+{
+    names->clear();
+
+#ifdef HAS_OPENDIR
+    DIR* d = opendir(dir.c_str());
+    if (NULL == d)
+        return;
+
+    struct dirent* ent;
+    while (NULL != (ent = readdir(d)))
+    {
+        /* hidden files, such as inputs still being written, are skipped. */
+        if ('.' == ent->d_name[0])
+            continue;
+
+        struct stat st;
+        string path = dir + "/" + ent->d_name;
+        if (0 == stat(path.c_str(), &st) && S_ISREG(st.st_mode))
+            names->push_back(ent->d_name);
+    }
+
+    closedir(d);
+    sort(names->begin(), names->end());
+#else
+    (void)dir;
+#endif
+}
+
+#ifdef FUZZ_RUNNER
+/**
+ * \brief The state a test runner shares with the parent, through which the
+ * parent watches for hangs and saves the input that was running when the
+ * test runner died.
+ */
+typedef struct fuzz_slot
+{
+    uint64_t execs;
+    uint32_t size;
+    uint8_t input[FUZZ_MAX_INPUT];
+} fuzz_slot_t;
+
+/**
+ * \brief The memory shared by the parent and every test runner.
+ */
+typedef struct fuzz_shared
+{
+    uint8_t seen[FUZZ_MAP_SIZE];
+    fuzz_slot_t slots[1];
+} fuzz_shared_t;
+
+/**
+ * \brief The state of a test runner while it fuzzes.
+ */
+typedef struct fuzz_worker
+{
+    const minunit_test_options_t* options;
+    const minunit_test_case_t* test;
+    fuzz_shared_t* shared;
+    fuzz_slot_t* slot;
+    string seed_dir;
+    string dir;
+    set<string> paths;
+    vector<vector<uint8_t>> corpus;
+    uint64_t random;
+} fuzz_worker_t;
+
+/**
+ * \brief Get the next number from a splitmix64 sequence.
+ *
+ * \param state         The state of the sequence, which is advanced.
+ *
+ * \returns the next number in the sequence.
+ */
+static uint64_t next_random(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+/**
+ * \brief Draw a number below a limit.
+ *
+ * \param worker        The test runner, whose random sequence is advanced.
+ * \param limit         The limit, which must be above 0.
+ *
+ * \returns the number.
+ */
+static size_t draw(fuzz_worker_t* worker, size_t limit)
+{
+    return (size_t)(next_random(&worker->random) % limit);
+}
+
+/**
+ * \brief Name an input by the hash of its contents, as 16 hex digits.
+ *
+ * \param data          The input.
+ * \param size          The size of the input.
+ *
+ * \returns the name.
+ */
+static string input_name(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016" PRIx64, hash);
+
+    return name;
+}
+
+/**
+ * \brief Write an input to a file, by way of a hidden temporary file which
+ * then replaces it, so that no reader sees a partially written input.
+ *
+ * \param dir           The directory of the file.
+ * \param name          The name of the file.
+ * \param data          The input.
+ * \param size          The size of the input.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+static bool write_input(
+    const string& dir, const string& name, const uint8_t* data, size_t size)
+{
+    string path = dir + "/" + name;
+    string temp = dir + "/." + name + "." + to_string(getpid());
+
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (NULL == out)
+        return false;
+
+    bool ok = size == fwrite(data, 1, size, out);
+    ok = 0 == fclose(out) && ok;
+
+    if (!ok || 0 != rename(temp.c_str(), path.c_str()))
+    {
+        int err = errno;
+        unlink(temp.c_str());
+        errno = err;
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Create a directory and any missing parents.
+ *
+ * \param dir           The directory.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+static bool make_dirs(const string& dir)
+{
+    for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1))
+    {
+        string prefix = dir.substr(0, slash);
+        if (0 != mkdir(prefix.c_str(), 0777) && EEXIST != errno)
+            return false;
+
+        if (string::npos == slash)
+            return true;
+    }
+}
+
+/**
+ * \brief Add the inputs in a directory which this test runner has not seen yet
+ * to its corpus.
+ *
+ * \param worker        The test runner.
+ * \param dir           The directory.
+ */
+static void load_inputs(fuzz_worker_t* worker, const string& dir)
+{
+    vector<string> names;
+    minunit_fuzz_corpus_inputs(dir, &names);
+
+    for (const string& name : names)
+    {
+        vector<uint8_t> input;
+        string path = dir + "/" + name;
+
+        if (worker->paths.count(path) || !read_input(path, &input))
+            continue;
+
+        if (input.size() > FUZZ_MAX_INPUT)
+            input.resize(FUZZ_MAX_INPUT);
+
+        worker->paths.insert(path);
+        worker->corpus.push_back(input);
+    }
+}
+
+/**
+ * \brief Add the inputs in the seed corpus and the output corpus which this
+ * test runner has not seen yet to its corpus.
+ *
+ * \param worker        The test runner.
+ */
+static void load_corpus(fuzz_worker_t* worker)
+{
+    load_inputs(worker, worker->seed_dir);
+    load_inputs(worker, worker->dir);
+}
+
+/**
+ * \brief Bucket the number of times an edge was taken by magnitude, so that
+ * only a change in magnitude counts as new coverage.
+ *
+ * \param count         The number of times the edge was taken.
+ *
+ * \returns the bucket, as a single bit.
+ */
+static uint8_t edge_bucket(uint8_t count)
+{
+    if (count <= 3)
+        return (uint8_t)(1 << (count - 1));
+    else if (count <= 7)
+        return 8;
+    else if (count <= 15)
+        return 16;
+    else if (count <= 31)
+        return 32;
+    else if (count <= 127)
+        return 64;
+    else
+        return 128;
+}
+
+/**
+ * \brief Merge the edges taken by the last input into the edges seen by every
+ * test runner.
+ *
+ * \param shared        The shared memory.
+ *
+ * \returns true if the input reached an edge, or a bucket of an edge, that no
+ * test runner had reached before.
+ */
+static bool merge_edges(fuzz_shared_t* shared)
+{
+    bool found = false;
+    const uint64_t* words = (const uint64_t*)edge_map;
+
+    for (size_t w = 0; w < FUZZ_MAP_SIZE / sizeof(uint64_t); ++w)
+    {
+        /* most of the map is untouched by any one input. */
+        if (0 == words[w])
+            continue;
+
+        for (size_t i = w * sizeof(uint64_t);
+             i < (w + 1) * sizeof(uint64_t); ++i)
+        {
+            if (0 == edge_map[i])
+                continue;
+
+            uint8_t bucket = edge_bucket(edge_map[i]);
+            if (bucket & ~__atomic_load_n(&shared->seen[i], __ATOMIC_RELAXED))
+            {
+                __atomic_fetch_or(&shared->seen[i], bucket, __ATOMIC_RELAXED);
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * \brief Run the test on an input, exiting the test runner if it fails.
+ *
+ * The input is published in the test runner's slot first, so that the parent
+ * can save it if the test crashes or hangs.
+ *
+ * \param worker        The test runner.
+ * \param input         The input.
+ *
+ * \returns true if the input reached new coverage, and false otherwise.
+ */
+static bool run_input(fuzz_worker_t* worker, const vector<uint8_t>& input)
+{
+    fuzz_slot_t* slot = worker->slot;
+
+    memcpy(slot->input, input.data(), input.size());
+    __atomic_store_n(&slot->size, (uint32_t)input.size(), __ATOMIC_RELEASE);
+
+    memset(edge_map, 0, sizeof(edge_map));
+    previous_block = 0;
+
+    minunit_test_context_t context = {};
+    context.pass = true;
+    context.iterations = 1;
+    worker->test->fuzz(
+        worker->options, &context, input.data(), input.size());
+
+    if (!context.pass)
+    {
+        vector<minunit_failure_t> failures;
+        minunit_assert_end(&failures);
+
+        for (const minunit_failure_t& failure : failures)
+        {
+            minunit_failure_print(worker->options, &failure);
+        }
+
+        printf("Input of %zu byte%s failed.\n",
+               input.size(), 1 == input.size() ? "" : "s");
+        fflush(stdout);
+        _exit(FUZZ_FAILED_STATUS);
+    }
+
+    __atomic_fetch_add(&slot->execs, 1, __ATOMIC_RELEASE);
+
+    return merge_edges(worker->shared);
+}
+
+/**
+ * \brief Mutate an input with a few random edits.
+ *
+ * \param worker        The test runner, whose corpus supplies splices.
+ * \param input         The input to mutate.
+ */
+static void mutate_input(fuzz_worker_t* worker, vector<uint8_t>* input)
+{
+    static const uint8_t interesting[] = {
+        0x00, 0x01, 0x10, 0x20, 0x40, 0x7f, 0x80, 0xff };
+
+    size_t edits = 1 + draw(worker, 4);
+
+    for (size_t edit = 0; edit < edits; ++edit)
+    {
+        size_t size = input->size();
+        size_t pos = draw(worker, size + 1);
+        size_t kind = 0 == size ? 4 : draw(worker, 8);
+
+        switch (kind)
+        {
+            /* flip a bit. */
+            case 0:
+                (*input)[pos % size] ^= (uint8_t)(1 << draw(worker, 8));
+                break;
+
+            /* set a random byte. */
+            case 1:
+                (*input)[pos % size] = (uint8_t)draw(worker, 256);
+                break;
+
+            /* set an interesting byte. */
+            case 2:
+                (*input)[pos % size] =
+                    interesting[draw(worker, sizeof(interesting))];
+                break;
+
+            /* add to or subtract from a byte. */
+            case 3:
+                (*input)[pos % size] +=
+                    (uint8_t)(draw(worker, 2) ? 1 + draw(worker, 16)
+                                              : 0 - (1 + draw(worker, 16)));
+                break;
+
+            /* insert random bytes. */
+            case 4:
+                for (size_t count = 1 + draw(worker, 4); count > 0; --count)
+                {
+                    input->insert(
+                        input->begin() + pos, (uint8_t)draw(worker, 256));
+                }
+                break;
+
+            /* erase a run of bytes. */
+            case 5:
+            {
+                size_t count = 1 + draw(worker, min(size, (size_t)16));
+                pos = min(pos, size - count);
+                input->erase(
+                    input->begin() + pos, input->begin() + pos + count);
+                break;
+            }
+
+            /* copy a run of bytes to another position. */
+            case 6:
+            {
+                size_t from = draw(worker, size);
+                size_t count = 1 + draw(worker, min(size - from, (size_t)16));
+                vector<uint8_t> run(
+                    input->begin() + from, input->begin() + from + count);
+                input->insert(input->begin() + pos, run.begin(), run.end());
+                break;
+            }
+
+            /* splice in the tail of another input in the corpus. */
+            default:
+            {
+                const vector<uint8_t>& other =
+                    worker->corpus[draw(worker, worker->corpus.size())];
+                size_t from = draw(worker, other.size() + 1);
+                input->resize(pos);
+                input->insert(
+                    input->end(), other.begin() + from, other.end());
+                break;
+            }
+        }
+
+        if (input->size() > FUZZ_MAX_INPUT)
+            input->resize(FUZZ_MAX_INPUT);
+    }
+}
+
+/**
+ * \brief Fuzz the test in a forked test runner until the deadline, exiting
+ * with a failure status as soon as an input fails.
+ *
+ * \param worker        The test runner.
+ * \param deadline      The time at which to stop, or the epoch for none.
+ */
+static void fuzz_worker(
+    fuzz_worker_t* worker, chrono::steady_clock::time_point deadline)
+{
+    bool timed = chrono::steady_clock::time_point() != deadline;
+
+    minunit_assert_begin();
+
+    /* run the corpus first, to learn the coverage it already reaches. */
+    load_corpus(worker);
+    if (worker->corpus.empty())
+        worker->corpus.push_back(vector<uint8_t>());
+
+    for (size_t i = 0; i < worker->corpus.size(); ++i)
+    {
+        run_input(worker, worker->corpus[i]);
+    }
+
+    auto reload = chrono::steady_clock::now();
+
+    for (;;)
+    {
+        auto now = chrono::steady_clock::now();
+        if (timed && now >= deadline)
+            break;
+
+        if (now - reload >= chrono::milliseconds(FUZZ_RELOAD_INTERVAL))
+        {
+            size_t known = worker->corpus.size();
+            load_corpus(worker);
+            for (size_t i = known; i < worker->corpus.size(); ++i)
+            {
+                run_input(worker, worker->corpus[i]);
+            }
+
+            reload = now;
+        }
+
+        vector<uint8_t> input =
+            worker->corpus[draw(worker, worker->corpus.size())];
+        mutate_input(worker, &input);
+
+        if (run_input(worker, input))
+        {
+            string name = input_name(input.data(), input.size());
+            if (worker->paths.insert(worker->dir + "/" + name).second)
+            {
+                write_input(worker->dir, name, input.data(), input.size());
+                worker->corpus.push_back(input);
+            }
+        }
+    }
+
+    fflush(stdout);
+    _exit(0);
+}
+
+/**
+ * \brief A forked test runner, as the parent sees it.
+ */
+typedef struct fuzz_child
+{
+    pid_t pid;
+    uint64_t execs;
+    chrono::steady_clock::time_point progress;
+} fuzz_child_t;
+
+static volatile sig_atomic_t fuzz_interrupted;
+
+/**
+ * \brief Stop fuzzing when the run is interrupted.
+ */
+static void fuzz_interrupt(int)
+{
+    fuzz_interrupted = 1;
+}
+
+/**
+ * \brief Fork a test runner to fuzz the test.
+ *
+ * \param worker        The state of the test runner, which the child takes
+ *                      over.
+ * \param child         The child to start.
+ * \param deadline      The time at which to stop, or the epoch for none.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+static bool start_fuzz_child(
+    fuzz_worker_t* worker, fuzz_child_t* child,
+    chrono::steady_clock::time_point deadline)
+{
+    fflush(stdout);
+
+    child->pid = fork();
+    if (child->pid < 0)
+        return false;
+
+    if (0 == child->pid)
+    {
+        /* only the parent is interrupted, and it then stops the children. */
+        signal(SIGINT, SIG_IGN);
+        signal(SIGTERM, SIG_DFL);
+        fuzz_worker(worker, deadline);
+    }
+
+    child->execs = worker->slot->execs;
+    child->progress = chrono::steady_clock::now();
+
+    return true;
+}
+
+/**
+ * \brief Save the input a test runner was running when it crashed, failed, or
+ * hung, in the current directory.
+ *
+ * \param kind          The kind of failure, which prefixes the file name.
+ * \param slot          The slot of the test runner.
+ *
+ * \returns true on success, and false on failure.
+ */
+static bool save_failing_input(const char* kind, const fuzz_slot_t* slot)
+{
+    uint32_t size = min(
+        __atomic_load_n(&slot->size, __ATOMIC_ACQUIRE),
+        (uint32_t)FUZZ_MAX_INPUT);
+    string name = string(kind) + "-" + input_name(slot->input, size);
+
+    if (!write_input(".", name, slot->input, size))
+    {
+        fprintf(stderr, "Could not save failing input %s: %s.\n",
+                name.c_str(), strerror(errno));
+        return false;
+    }
+
+    printf("Saved the input of %u byte%s which %s to %s.\n",
+           size, 1 == size ? "" : "s",
+           !strcmp(kind, "crash") ? "crashed"
+               : !strcmp(kind, "timeout") ? "hung" : "failed",
+           name.c_str());
+    fflush(stdout);
+
+    return true;
+}
+
+int minunit_fuzz_run(
+    const minunit_test_options_t* options, const minunit_test_case_t* test)
+{
+    unsigned int jobs = max(options->jobs, 1U);
+    string seed_dir = minunit_fuzz_seed_dir(test);
+    string dir =
+        NULL != options->corpus
+            ? minunit_fuzz_corpus_dir(options, test)
+            : string(FUZZ_OUTPUT_DIR) + "/" + test->name;
+
+    if (!make_dirs(dir))
+    {
+        fprintf(stderr, "Could not create corpus %s: %s.\n",
+                dir.c_str(), strerror(errno));
+        return 1;
+    }
+
+    size_t shared_size =
+        sizeof(fuzz_shared_t) + (jobs - 1) * sizeof(fuzz_slot_t);
+    void* mem =
+        mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == mem)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    fuzz_shared_t* shared = (fuzz_shared_t*)mem;
+    unsigned int hang_time =
+        0 != options->timeout ? options->timeout : FUZZ_DEFAULT_HANG_TIME;
+
+    auto start = chrono::steady_clock::now();
+    auto deadline = chrono::steady_clock::time_point();
+    if (0 != options->fuzz_time)
+        deadline = start + chrono::milliseconds(options->fuzz_time);
+
+    printf("Fuzzing %s with %u job%s, from seed corpus %s into corpus %s.\n",
+           test->name, jobs, 1 == jobs ? "" : "s", seed_dir.c_str(),
+           dir.c_str());
+
+    fuzz_interrupted = 0;
+    signal(SIGINT, &fuzz_interrupt);
+    signal(SIGTERM, &fuzz_interrupt);
+
+    vector<fuzz_worker_t> workers(jobs);
+    vector<fuzz_child_t> children(jobs);
+    unsigned int running = 0;
+    bool failed = false;
+    int ret = 0;
+
+    for (unsigned int i = 0; i < jobs; ++i)
+    {
+        fuzz_worker_t* worker = &workers[i];
+        worker->options = options;
+        worker->test = test;
+        worker->shared = shared;
+        worker->slot = &shared->slots[i];
+        worker->seed_dir = seed_dir;
+        worker->dir = dir;
+        worker->random = options->property_seed + i;
+
+        if (!start_fuzz_child(worker, &children[i], deadline))
+        {
+            perror("fork");
+            ret = 1;
+            break;
+        }
+
+        ++running;
+    }
+
+    while (running > 0 && !failed && !fuzz_interrupted)
+    {
+        this_thread::sleep_for(chrono::milliseconds(FUZZ_POLL_INTERVAL));
+        auto now = chrono::steady_clock::now();
+
+        /* kill any test runner which has made no progress for too long. */
+        for (unsigned int i = 0; i < jobs; ++i)
+        {
+            fuzz_child_t* child = &children[i];
+            uint64_t execs =
+                __atomic_load_n(&workers[i].slot->execs, __ATOMIC_ACQUIRE);
+
+            if (child->pid <= 0)
+            {
+                continue;
+            }
+            else if (execs != child->execs)
+            {
+                child->execs = execs;
+                child->progress = now;
+            }
+            else if (now - child->progress
+                        >= chrono::milliseconds(hang_time))
+            {
+                kill(child->pid, SIGKILL);
+                child->progress = now;
+            }
+        }
+
+        /* stop at the first test runner which died on an input. */
+        int status;
+        pid_t pid;
+        while (!failed && (pid = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            unsigned int i = 0;
+            while (i < jobs && children[i].pid != pid)
+                ++i;
+
+            if (i == jobs)
+                continue;
+
+            children[i].pid = 0;
+            --running;
+
+            if (WIFEXITED(status) && 0 == WEXITSTATUS(status))
+                continue;
+
+            const char* kind = "crash";
+            if (WIFEXITED(status) && FUZZ_FAILED_STATUS == WEXITSTATUS(status))
+                kind = "failure";
+            else if (WIFSIGNALED(status) && SIGKILL == WTERMSIG(status))
+                kind = "timeout";
+
+            save_failing_input(kind, workers[i].slot);
+            failed = true;
+        }
+    }
+
+    /* stop whatever is still running. */
+    for (fuzz_child_t& child : children)
+    {
+        if (child.pid > 0)
+        {
+            kill(child.pid, SIGKILL);
+            waitpid(child.pid, NULL, 0);
+        }
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    uint64_t execs = 0;
+    for (unsigned int i = 0; i < jobs; ++i)
+    {
+        execs += shared->slots[i].execs;
+    }
+
+    unsigned int edges = 0;
+    for (size_t i = 0; i < FUZZ_MAP_SIZE; ++i)
+    {
+        if (0 != shared->seen[i])
+            ++edges;
+    }
+
+    vector<string> names;
+    minunit_fuzz_corpus_inputs(dir, &names);
+
+    double seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Ran %" PRIu64 " inputs in %.1f s (%.0f/s), reaching %u edges, "
+           "with %zu input%s in the corpus.\n",
+           execs, seconds, seconds > 0.0 ? (double)execs / seconds : 0.0,
+           edges, names.size(), 1 == names.size() ? "" : "s");
+
+    if (0 == edges)
+    {
+        printf("No edges were reached; build the code under test with "
+               "-fsanitize-coverage=trace-pc-guard or trace-pc.\n");
+    }
+
+    options->terminal_set_color(
+        failed ? MINUNIT_TERMINAL_COLOR_RED : MINUNIT_TERMINAL_COLOR_GREEN);
+    printf(failed ? "Found a failing input.\n" : "Found no failing input.\n");
+    options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    fflush(stdout);
+
+    munmap(mem, shared_size);
+
+    return failed ? 1 : ret;
+}
+#endif
@@ -0,0 +1,82 @@
+/**
+ * \file src/minunit_fuzz.h
+ *
+ * \brief Fuzz tests, replayed from their corpus in a normal run, and fuzzed
+ * with coverage feedback on request.
+ *
+ * The corpus of a fuzz test is a directory holding one input per file.  In a
+ * normal run, each input is replayed as a test of its own.  When fuzzing,
+ * each forked test runner runs the test in a loop over mutated inputs, and
+ * adds every input which reaches new edges of the code under test to the
+ * corpus.  Edges are counted by the callbacks of -fsanitize-coverage, which
+ * are defined by the library, so that no other fuzzing runtime is needed.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_FUZZ_HEADER_GUARD
+# define MINUNIT_FUZZ_HEADER_GUARD
+
+#include <minunit/minunit.h>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Get the seed corpus directory of a fuzz test, which is checked in
+ * beside the source file declaring the test.
+ *
+ * The seed corpus of a test is the directory named for the test under a
+ * directory named "corpus" beside the source file declaring the test.  It is
+ * only ever read.
+ *
+ * \param test          The fuzz test.
+ *
+ * \returns the path of the seed corpus directory.
+ */
+std::string minunit_fuzz_seed_dir(const minunit_test_case_t* test);
+
+/**
+ * \brief Get the corpus directory of a fuzz test.
+ *
+ * The corpus of a test is the directory named for the test under the corpus
+ * directory given by the options, or by default its seed corpus.
+ *
+ * \param options       The test options.
+ * \param test          The fuzz test.
+ *
+ * \returns the path of the corpus directory.
+ */
+std::string minunit_fuzz_corpus_dir(
+    const minunit_test_options_t* options, const minunit_test_case_t* test);
+
+/**
+ * \brief List the inputs in a corpus directory, sorted by name.
+ *
+ * \param dir           The corpus directory.
+ * \param names         The names of the inputs found, which are left empty if
+ *                      the directory does not exist.
+ */
+void minunit_fuzz_corpus_inputs(
+    const std::string& dir, std::vector<std::string>* names);
+
+/**
+ * \brief Fuzz a test until the fuzz time runs out or the run is interrupted,
+ * on as many forked test runners as there are jobs.
+ *
+ * Inputs are drawn from the seed corpus and the output corpus, and the inputs
+ * which reach new edges are written to the output corpus only.  The output
+ * corpus is the corpus directory given by the options, or by default the
+ * directory named for the test under "fuzz-corpus" in the current directory.
+ * Fuzzing stops early at the first input that makes the test crash, fail, or
+ * hang, which is saved in the current directory.
+ *
+ * \param options       The test options.
+ * \param test          The fuzz test.
+ *
+ * \returns 0 if no failing input was found, and 1 otherwise.
+ */
+int minunit_fuzz_run(
+    const minunit_test_options_t* options, const minunit_test_case_t* test);
+
+#endif /*MINUNIT_FUZZ_HEADER_GUARD*/
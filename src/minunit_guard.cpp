@@ -0,0 +1,200 @@
+/**
+ * \file src/minunit_guard.cpp
+ *
+ * \brief Crash containment for tests run in the test runner's own process.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#ifdef CRASH_CONTAINMENT
+# include <setjmp.h>
+# include <signal.h>
+# include <sys/time.h>
+#endif
+
+#include "minunit_guard.h"
+
+#ifdef CRASH_CONTAINMENT
+
+/**
+ * \brief Size of the stack the signal handlers run on, so that a test which
+ * overflows its stack can still be recovered.
+ */
+#define GUARD_STACK_SIZE (64U * 1024U)
+
+/**
+ * \brief The signals handled by the guard.
+ */
+static const int guarded_signals[] = {
+    SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGALRM };
+
+#define GUARDED_SIGNAL_COUNT \
+    (sizeof(guarded_signals) / sizeof(guarded_signals[0]))
+
+static struct sigaction saved_actions[GUARDED_SIGNAL_COUNT];
+static stack_t saved_stack;
+static char* guard_stack;
+
+/**
+ * \brief Where a guarded call resumes after a signal, and whether a guarded
+ * call is running.
+ */
+static sigjmp_buf guard_jump;
+static volatile sig_atomic_t guard_armed;
+
+/**
+ * \brief Jump out of the guarded call which raised a signal.
+ *
+ * \param sig           The signal raised.
+ */
+static void guard_handler(int sig)
+{
+    if (guard_armed)
+    {
+        guard_armed = 0;
+        siglongjmp(guard_jump, sig);
+    }
+
+    /* a timer which fired just as the guarded call returned is harmless. */
+    if (SIGALRM == sig)
+    {
+        return;
+    }
+
+    /* outside of a guarded call, a fault is as fatal as it would otherwise
+     * be. */
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * \brief Start or stop the timer limiting a guarded call.
+ *
+ * \param timeout       The time in milliseconds until SIGALRM is raised, or 0
+ *                      to stop the timer.
+ */
+static void set_guard_timer(unsigned int timeout)
+{
+    struct itimerval timer;
+
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = timeout / 1000;
+    timer.it_value.tv_usec = (timeout % 1000) * 1000;
+
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+/**
+ * \brief Install the signal handlers of the guard.
+ *
+ * \returns true if crashes can be contained on this platform, and false
+ * otherwise.
+ */
+bool minunit_guard_install()
+{
+    guard_stack = new char[GUARD_STACK_SIZE];
+
+    stack_t stack;
+    memset(&stack, 0, sizeof(stack));
+    stack.ss_sp = guard_stack;
+    stack.ss_size = GUARD_STACK_SIZE;
+
+    if (0 != sigaltstack(&stack, &saved_stack))
+    {
+        delete[] guard_stack;
+        guard_stack = NULL;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &guard_handler;
+    action.sa_flags = NULL != guard_stack ? SA_ONSTACK : 0;
+    sigemptyset(&action.sa_mask);
+
+    for (size_t i = 0; i < GUARDED_SIGNAL_COUNT; ++i)
+    {
+        sigaction(guarded_signals[i], &action, &saved_actions[i]);
+    }
+
+    return true;
+}
+
+/**
+ * \brief Restore the signal handlers replaced by the guard.
+ */
+void minunit_guard_remove()
+{
+    for (size_t i = 0; i < GUARDED_SIGNAL_COUNT; ++i)
+    {
+        sigaction(guarded_signals[i], &saved_actions[i], NULL);
+    }
+
+    if (NULL != guard_stack)
+    {
+        sigaltstack(&saved_stack, NULL);
+        delete[] guard_stack;
+        guard_stack = NULL;
+    }
+}
+
+/**
+ * \brief Call a function, recovering if it crashes or runs out of time.
+ *
+ * \param timeout       The time in milliseconds the function may run for, or 0
+ *                      for no limit.
+ * \param func          The function to call.
+ * \param arg           The argument to pass to the function.
+ *
+ * \returns 0 if the function returned, SIGALRM if it ran out of time, or the
+ * number of the signal it raised.
+ */
+int minunit_guard_call(
+    unsigned int timeout, minunit_guarded_func_t func, void* arg)
+{
+    /* the signal mask is saved, so that the signal which ends the call is
+     * unblocked again when it jumps back here. */
+    int sig = sigsetjmp(guard_jump, 1);
+
+    if (0 == sig)
+    {
+        guard_armed = 1;
+        if (timeout > 0)
+            set_guard_timer(timeout);
+
+        func(arg);
+
+        guard_armed = 0;
+    }
+
+    if (timeout > 0)
+        set_guard_timer(0);
+
+    return sig;
+}
+
+#else
+
+bool minunit_guard_install()
+{
+    return false;
+}
+
+void minunit_guard_remove()
+{
+}
+
+int minunit_guard_call(
+    unsigned int timeout, minunit_guarded_func_t func, void* arg)
+{
+    (void)timeout;
+
+    func(arg);
+
+    return 0;
+}
+
+#endif
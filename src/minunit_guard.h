@@ -0,0 +1,52 @@
+/**
+ * \file src/minunit_guard.h
+ *
+ * \brief Crash containment for tests run in the test runner's own process.
+ *
+ * A guarded call installs handlers for the signals raised by common faults,
+ * and if one of them is raised while the call runs, jumps back out of the
+ * call with sigsetjmp and siglongjmp.  This lets the test runner survive most
+ * crashing tests without forking, but a test which crashes part way through
+ * updating shared state, such as the C library's heap, may leave that state
+ * corrupt for the tests which follow it.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_GUARD_HEADER_GUARD
+# define MINUNIT_GUARD_HEADER_GUARD
+
+/**
+ * \brief Type of a function called under the guard.
+ */
+typedef void (*minunit_guarded_func_t)(void* arg);
+
+/**
+ * \brief Install the signal handlers of the guard.
+ *
+ * \returns true if crashes can be contained on this platform, and false
+ * otherwise.
+ */
+bool minunit_guard_install();
+
+/**
+ * \brief Restore the signal handlers replaced by the guard.
+ */
+void minunit_guard_remove();
+
+/**
+ * \brief Call a function, recovering if it crashes or runs out of time.
+ *
+ * \param timeout       The time in milliseconds the function may run for, or 0
+ *                      for no limit.
+ * \param func          The function to call.
+ * \param arg           The argument to pass to the function.
+ *
+ * \returns 0 if the function returned, SIGALRM if it ran out of time, or the
+ * number of the signal it raised.
+ */
+int minunit_guard_call(
+    unsigned int timeout, minunit_guarded_func_t func, void* arg);
+
+#endif /*MINUNIT_GUARD_HEADER_GUARD*/
@@ -0,0 +1,161 @@
+/**
+ * \file src/minunit_heap.cpp
+ *
+ * \brief Heap accounting of tests, using the counters of the heap shim.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "minunit_heap.h"
+
+/**
+ * \brief Read the counters of the heap shim, if it is loaded.
+ *
+ * \param counters      The counters to populate.
+ *
+ * \returns true if the heap shim is loaded, and false otherwise.
+ */
+static bool read_heap_counters(minunit_heap_counters_t* counters)
+{
+    memset(counters, 0, sizeof(*counters));
+
+#ifdef MINUNIT_HEAP_ACCOUNTING
+    if (NULL != &minunit_heap_read)
+    {
+        minunit_heap_read(counters);
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+/**
+ * \brief Expect no more than the given number of heap allocations from now
+ * until the test returns.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the expectation.
+ * \param line          The line of the expectation.
+ * \param count         The maximum number of allocations.
+ */
+void minunit_heap_expect_max_allocations(
+    minunit_test_context_t* context, const char* file, int line,
+    uint64_t count)
+{
+    minunit_heap_counters_t counters;
+    read_heap_counters(&counters);
+
+    context->heap_checks |= MINUNIT_HEAP_CHECK_MAX_ALLOCATIONS;
+    context->allocation_mark = counters.allocations;
+    context->max_allocations = count;
+    context->max_allocations_file = file;
+    context->max_allocations_line = line;
+}
+
+/**
+ * \brief Expect every heap allocation made by the test to be freed by the
+ * time the test returns.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the expectation.
+ * \param line          The line of the expectation.
+ */
+void minunit_heap_expect_no_leaks(
+    minunit_test_context_t* context, const char* file, int line)
+{
+    context->heap_checks |= MINUNIT_HEAP_CHECK_NO_LEAKS;
+    context->no_leaks_file = file;
+    context->no_leaks_line = line;
+}
+
+/**
+ * \brief Start heap accounting for a test.
+ *
+ * \param start         Set to the counters at the start of the test.
+ *
+ * \returns true if the heap shim is loaded, and false otherwise.
+ */
+bool minunit_heap_begin(minunit_heap_counters_t* start)
+{
+#ifdef MINUNIT_HEAP_ACCOUNTING
+    if (NULL != &minunit_heap_reset_peak)
+    {
+        minunit_heap_reset_peak();
+    }
+#endif
+
+    return read_heap_counters(start);
+}
+
+/**
+ * \brief Finish heap accounting for a test, and check the heap expectations
+ * set by the test.
+ *
+ * \param options       The test options.
+ * \param context       The test context holding the expectations, which is
+ *                      failed, with a failure recorded where the expectation
+ *                      was set, if the expectation is not met.
+ * \param start         The counters at the start of the test.
+ * \param heap          The heap usage of the test to populate.
+ */
+void minunit_heap_end(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const minunit_heap_counters_t* start, test_heap_t* heap)
+{
+    minunit_heap_counters_t end;
+
+    memset(heap, 0, sizeof(*heap));
+
+    if (!read_heap_counters(&end))
+    {
+        return;
+    }
+
+    heap->tracked = 1;
+    heap->allocations = end.allocations - start->allocations;
+    heap->bytes = end.bytes - start->bytes;
+    heap->peak_bytes =
+        end.peak_bytes > start->live_bytes
+            ? end.peak_bytes - start->live_bytes : 0;
+
+    /* a test which frees more than it allocates has not leaked. */
+    if (end.live_blocks > start->live_blocks)
+        heap->leaked_blocks = end.live_blocks - start->live_blocks;
+    if (end.live_bytes > start->live_bytes)
+        heap->leaked_bytes = end.live_bytes - start->live_bytes;
+
+    char message[128];
+
+    if ((context->heap_checks & MINUNIT_HEAP_CHECK_MAX_ALLOCATIONS)
+     && end.allocations - context->allocation_mark > context->max_allocations)
+    {
+        snprintf(
+            message, sizeof(message),
+            "at most %llu heap allocations, made %llu",
+            (unsigned long long)context->max_allocations,
+            (unsigned long long)(end.allocations - context->allocation_mark));
+        minunit_test_fail(
+            options, context, context->max_allocations_file,
+            context->max_allocations_line, message);
+    }
+
+    if ((context->heap_checks & MINUNIT_HEAP_CHECK_NO_LEAKS)
+     && (heap->leaked_blocks > 0 || heap->leaked_bytes > 0))
+    {
+        snprintf(
+            message, sizeof(message),
+            "no heap leaks, leaked %llu bytes in %llu block%s",
+            (unsigned long long)heap->leaked_bytes,
+            (unsigned long long)heap->leaked_blocks,
+            1 == heap->leaked_blocks ? "" : "s");
+        minunit_test_fail(
+            options, context, context->no_leaks_file, context->no_leaks_line,
+            message);
+    }
+}
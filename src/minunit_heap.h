@@ -0,0 +1,96 @@
+/**
+ * \file src/minunit_heap.h
+ *
+ * \brief Heap accounting, shared between the test runner and the heap shim.
+ *
+ * The heap shim is a separate shared library which interposes malloc and its
+ * relatives, and keeps running counters of every allocation in the process.
+ * It is enabled by linking a test executable against it, or by preloading it.
+ * The test runner finds the counters through weak references, so that without
+ * the shim, heap accounting is simply unavailable.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_HEAP_HEADER_GUARD
+# define MINUNIT_HEAP_HEADER_GUARD
+
+#include <minunit/minunit.h>
+#include <stdint.h>
+
+#include "minunit_protocol.h"
+
+/*
+ * The test runner refers to the shim through weak references, which requires
+ * ELF symbol interposition.
+ */
+#if defined(__GNUC__) && defined(__ELF__)
+# define MINUNIT_HEAP_ACCOUNTING
+# ifdef MINUNIT_HEAP_SHIM
+#  define MINUNIT_HEAP_WEAK
+# else
+#  define MINUNIT_HEAP_WEAK __attribute__((weak))
+# endif
+#endif
+
+/**
+ * \brief Running counters kept by the heap shim.
+ *
+ * Sizes are the usable sizes of the allocated blocks, as reported by the
+ * allocator.
+ */
+typedef struct minunit_heap_counters
+{
+    uint64_t allocations;
+    uint64_t bytes;
+    uint64_t live_blocks;
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+} minunit_heap_counters_t;
+
+#ifdef MINUNIT_HEAP_ACCOUNTING
+extern "C" {
+
+/**
+ * \brief Read the counters of the heap shim.
+ *
+ * \param counters      The counters to populate.
+ */
+void minunit_heap_read(minunit_heap_counters_t* counters) MINUNIT_HEAP_WEAK;
+
+/**
+ * \brief Reset the peak of the heap shim to the bytes currently live.
+ */
+void minunit_heap_reset_peak() MINUNIT_HEAP_WEAK;
+
+}
+#endif
+
+/**
+ * \brief Start heap accounting for a test.
+ *
+ * \param start         Set to the counters at the start of the test.
+ *
+ * \returns true if the heap shim is loaded, and false otherwise.
+ */
+bool minunit_heap_begin(minunit_heap_counters_t* start);
+
+/**
+ * \brief Finish heap accounting for a test, and check the heap expectations
+ * set by the test.
+ *
+ * A failure is recorded for each expectation that the test did not meet, at
+ * the file and line where the test set it.
+ *
+ * \param options       The test options.
+ * \param context       The test context holding the expectations, which is
+ *                      failed if an expectation is not met.
+ * \param start         The counters at the start of the test.
+ * \param heap          The heap usage of the test to populate.
+ */
+void minunit_heap_end(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const minunit_heap_counters_t* start, test_heap_t* heap);
+
+#endif /*MINUNIT_HEAP_HEADER_GUARD*/
@@ -0,0 +1,241 @@
+/**
+ * \file src/minunit_limits.cpp
+ *
+ * \brief Resource limits of the forked processes which run tests.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef RESOURCE_LIMITS
+# include <dirent.h>
+# include <signal.h>
+# include <sys/time.h>
+# include <sys/wait.h>
+# include <unistd.h>
+# include <algorithm>
+# include <exception>
+# include <new>
+# include <vector>
+#endif
+
+#include "minunit_limits.h"
+
+#ifdef RESOURCE_LIMITS
+
+using namespace std;
+
+/**
+ * \brief The terminate handler replaced by the one which reports running out
+ * of memory.
+ */
+static std::terminate_handler default_terminate;
+
+/**
+ * \brief Exit with the out of memory status if the process is terminating
+ * over an allocation that failed, and otherwise terminate as before.
+ *
+ * A test that catches std::bad_alloc can still check how it handles running
+ * out of memory.  Only an allocation failure that nothing handled ends the
+ * test as out of memory.
+ */
+static void terminate_out_of_memory()
+{
+    std::exception_ptr exception = std::current_exception();
+
+    if (exception)
+    {
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::bad_alloc&)
+        {
+            fflush(stdout);
+            _exit(MINUNIT_LIMITS_OOM_STATUS);
+        }
+        catch (...)
+        {
+        }
+    }
+
+    if (NULL != default_terminate)
+        default_terminate();
+
+    abort();
+}
+
+/**
+ * \brief List the descriptors open in this process.
+ *
+ * \param fds           Set to the open descriptors, in ascending order.
+ *
+ * \returns true on success, and false if they can't be listed.
+ */
+static bool list_open_files(vector<int>* fds)
+{
+    static const char* const paths[] = { "/proc/self/fd", "/dev/fd" };
+
+    for (const char* path : paths)
+    {
+        DIR* dir = opendir(path);
+        if (NULL == dir)
+            continue;
+
+        int self = dirfd(dir);
+        struct dirent* entry;
+
+        fds->clear();
+        while (NULL != (entry = readdir(dir)))
+        {
+            if ('.' == entry->d_name[0])
+                continue;
+
+            int fd = atoi(entry->d_name);
+            if (fd != self)
+                fds->push_back(fd);
+        }
+
+        closedir(dir);
+        sort(fds->begin(), fds->end());
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \brief Lower the soft limit of a resource, saving the previous limit.
+ *
+ * The hard limit is left alone, since an unprivileged process can't raise it
+ * again for the next test.
+ *
+ * \param resource      The resource.
+ * \param value         The soft limit to apply.
+ * \param saved         Set to the previous limit.
+ */
+static void lower_limit(int resource, rlim_t value, struct rlimit* saved)
+{
+    if (0 != getrlimit(resource, saved))
+    {
+        perror("getrlimit");
+        return;
+    }
+
+    struct rlimit limit = *saved;
+    if (RLIM_INFINITY != limit.rlim_max && value > limit.rlim_max)
+        value = limit.rlim_max;
+
+    limit.rlim_cur = value;
+    if (0 != setrlimit(resource, &limit))
+        perror("setrlimit");
+}
+
+void minunit_limits_begin(
+    const minunit_test_limits_t* limits, minunit_limits_state_t* state)
+{
+    state->limits = *limits;
+    state->open_files = -1;
+
+    if (0 != limits->memory)
+    {
+        if (terminate_out_of_memory != std::get_terminate())
+            default_terminate = std::set_terminate(&terminate_out_of_memory);
+
+        lower_limit(RLIMIT_AS, (rlim_t)limits->memory, &state->memory);
+    }
+
+    /* CPU time accumulates over the life of the process. */
+    if (0 != limits->cpu)
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        rlim_t used =
+            (rlim_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1);
+        lower_limit(RLIMIT_CPU, used + limits->cpu, &state->cpu);
+    }
+
+    /* the limit is on descriptor numbers, so it is raised past each open
+     * descriptor below it, leaving just as many free numbers as the test may
+     * open. */
+    vector<int> fds;
+    if (0 != limits->files && list_open_files(&fds))
+    {
+        rlim_t value = limits->files;
+        for (int fd : fds)
+        {
+            if ((rlim_t)fd < value)
+                ++value;
+        }
+
+        state->open_files = (int)fds.size();
+        lower_limit(RLIMIT_NOFILE, value, &state->files);
+    }
+}
+
+void minunit_limits_end(
+    minunit_limits_state_t* state, uint64_t* leaked_files)
+{
+    *leaked_files = 0;
+
+    if (0 != state->limits.memory)
+        setrlimit(RLIMIT_AS, &state->memory);
+
+    if (0 != state->limits.cpu)
+        setrlimit(RLIMIT_CPU, &state->cpu);
+
+    vector<int> fds;
+    if (state->open_files >= 0)
+    {
+        setrlimit(RLIMIT_NOFILE, &state->files);
+
+        if (list_open_files(&fds) && (int)fds.size() > state->open_files)
+            *leaked_files = (uint64_t)((int)fds.size() - state->open_files);
+    }
+}
+
+int minunit_limits_exceeded(int status)
+{
+    if (WIFSIGNALED(status) && SIGXCPU == WTERMSIG(status))
+        return MINUNIT_LIMIT_CPU;
+
+    if (WIFEXITED(status)
+     && MINUNIT_LIMITS_OOM_STATUS == WEXITSTATUS(status))
+    {
+        return MINUNIT_LIMIT_MEMORY;
+    }
+
+    return MINUNIT_LIMIT_NONE;
+}
+
+#else
+
+void minunit_limits_begin(
+    const minunit_test_limits_t* limits, minunit_limits_state_t* state)
+{
+    state->limits = *limits;
+    state->open_files = -1;
+}
+
+void minunit_limits_end(
+    minunit_limits_state_t* state, uint64_t* leaked_files)
+{
+    (void)state;
+    *leaked_files = 0;
+}
+
+int minunit_limits_exceeded(int status)
+{
+    (void)status;
+
+    return MINUNIT_LIMIT_NONE;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * \file src/minunit_limits.h
+ *
+ * \brief Resource limits of the forked processes which run tests.
+ *
+ * Limits are applied with setrlimit in the process running a test, just
+ * before the test starts, and lifted again once it returns, so that a forked
+ * test runner can go on to run tests with other limits.  A test which runs
+ * out of address space or CPU time is killed, along with its process, and the
+ * test runner reports the limit it exceeded.  A test has run out of memory if
+ * it ends with an uncaught std::bad_alloc.  A crash is always reported as a
+ * crash, since a crash after a failed malloc can't be told apart from any
+ * other crash.  Under a limit on open files, a test must close every
+ * descriptor it opens.  The limit on output is not a resource limit of the
+ * process, and is applied by the test runner to the output it captures.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_LIMITS_HEADER_GUARD
+# define MINUNIT_LIMITS_HEADER_GUARD
+
+#include <config.h>
+#include <minunit/minunit.h>
+
+#ifdef RESOURCE_LIMITS
+# include <sys/resource.h>
+#endif
+
+/**
+ * \brief The exit status of a process which ran out of memory under a memory
+ * limit.
+ */
+#define MINUNIT_LIMITS_OOM_STATUS 87
+
+/**
+ * \brief The limit a test exceeded, as told from the wait status of the
+ * process which ran it.
+ */
+enum minunit_limit
+{
+    MINUNIT_LIMIT_NONE,
+    MINUNIT_LIMIT_MEMORY,
+    MINUNIT_LIMIT_CPU
+};
+
+/**
+ * \brief The limits applied to a test, and the limits they replaced.
+ */
+typedef struct minunit_limits_state
+{
+    minunit_test_limits_t limits;
+    int open_files;
+#ifdef RESOURCE_LIMITS
+    struct rlimit memory;
+    struct rlimit cpu;
+    struct rlimit files;
+#endif
+} minunit_limits_state_t;
+
+/**
+ * \brief Apply limits to this process for the test about to run.
+ *
+ * \param limits        The limits, where a limit of 0 is not applied.
+ * \param state         The state to restore when the test ends.
+ */
+void minunit_limits_begin(
+    const minunit_test_limits_t* limits, minunit_limits_state_t* state);
+
+/**
+ * \brief Lift the limits applied for a test which has returned.
+ *
+ * \param state         The state saved when the test began.
+ * \param leaked_files  Set to the number of descriptors the test left open,
+ *                      which is only counted under a limit on open files.
+ */
+void minunit_limits_end(
+    minunit_limits_state_t* state, uint64_t* leaked_files);
+
+/**
+ * \brief Determine which limit, if any, a test exceeded.
+ *
+ * \param status        The wait status of the process which ran the test.
+ *
+ * \returns the limit exceeded, or MINUNIT_LIMIT_NONE.
+ */
+int minunit_limits_exceeded(int status);
+
+#endif /*MINUNIT_LIMITS_HEADER_GUARD*/
@@ -0,0 +1,301 @@
+/**
+ * \file src/minunit_perf.cpp
+ *
+ * \brief Performance counters of tests, read through perf_event_open.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef PERF_EVENT_COUNTERS
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+#endif
+
+#include "minunit_perf.h"
+
+/**
+ * \brief Names of the performance counters.
+ */
+static const char* const counter_names[MINUNIT_PERF_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "branch_misses",
+    "l1d_misses",
+    "llc_misses",
+    "page_faults",
+    "context_switches",
+};
+
+/**
+ * \brief Get the name of a performance counter.
+ *
+ * \param counter       The counter.
+ *
+ * \returns the name of the counter, in lower case with words separated by
+ * underscores.
+ */
+const char* minunit_perf_counter_name(int counter)
+{
+    return counter_names[counter];
+}
+
+#ifdef PERF_EVENT_COUNTERS
+
+/**
+ * \brief Configuration of a read miss event in the given cache.
+ */
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+   | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/**
+ * \brief The event counted by a performance counter.
+ */
+typedef struct perf_event_desc
+{
+    uint32_t type;
+    uint64_t config;
+} perf_event_desc_t;
+
+static const perf_event_desc_t counter_events[MINUNIT_PERF_COUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+    { PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL) },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+/**
+ * \brief The process which opened the counters, or 0 if none has.
+ */
+static pid_t counter_owner;
+
+/**
+ * \brief The mask of counters opened, and their descriptors.
+ */
+static uint32_t counters_open;
+static int counter_fds[MINUNIT_PERF_COUNTERS];
+
+/**
+ * \brief The leaders of the hardware and software counter groups, or -1.
+ */
+static int group_leaders[2] = { -1, -1 };
+
+/**
+ * \brief Open a counter for this process and the threads it starts.
+ *
+ * Counting in the kernel is attempted first, and if that is not permitted,
+ * only user space is counted.
+ *
+ * \param counter       The counter to open.
+ * \param group_fd      The leader of the group to join, or -1 to open a
+ *                      disabled group leader.
+ *
+ * \returns the descriptor of the counter, or -1 if it could not be opened.
+ */
+static int open_counter(int counter, int group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter_events[counter].type;
+    attr.config = counter_events[counter].config;
+    attr.disabled = -1 == group_fd ? 1 : 0;
+    attr.inherit = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd =
+        (int)syscall(
+            SYS_perf_event_open, &attr, 0, -1, group_fd,
+            PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0 && (EACCES == errno || EPERM == errno))
+    {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd =
+            (int)syscall(
+                SYS_perf_event_open, &attr, 0, -1, group_fd,
+                PERF_FLAG_FD_CLOEXEC);
+    }
+
+    return fd;
+}
+
+/**
+ * \brief Open a group of counters, skipping any which can't be opened.
+ *
+ * \param first         The first counter of the group.
+ * \param last          One past the last counter of the group.
+ *
+ * \returns the leader of the group, or -1 if no counter could be opened.
+ */
+static int open_counter_group(int first, int last)
+{
+    int leader = -1;
+
+    for (int counter = first; counter < last; ++counter)
+    {
+        int fd = open_counter(counter, leader);
+        if (fd < 0)
+            continue;
+
+        if (-1 == leader)
+            leader = fd;
+
+        counter_fds[counter] = fd;
+        counters_open |= 1U << counter;
+    }
+
+    return leader;
+}
+
+/**
+ * \brief Close the counters, which may have been inherited from the process
+ * which opened them.
+ */
+static void close_counters()
+{
+    for (int counter = 0; counter < MINUNIT_PERF_COUNTERS; ++counter)
+    {
+        if (counters_open & (1U << counter))
+            close(counter_fds[counter]);
+    }
+
+    counters_open = 0;
+    group_leaders[0] = group_leaders[1] = -1;
+}
+
+/**
+ * \brief Determine which performance counters this process may open.
+ *
+ * \returns a mask with the bit of each counter that could be opened.
+ */
+uint32_t minunit_perf_probe()
+{
+    uint32_t available = 0;
+
+    for (int counter = 0; counter < MINUNIT_PERF_COUNTERS; ++counter)
+    {
+        int fd = open_counter(counter, -1);
+        if (fd < 0)
+            continue;
+
+        available |= 1U << counter;
+        close(fd);
+    }
+
+    return available;
+}
+
+/**
+ * \brief Open the counters of this process, if they are not already open,
+ * without counting anything.
+ */
+void minunit_perf_open()
+{
+    pid_t pid = getpid();
+
+    /* counters inherited over fork count the process that opened them. */
+    if (pid != counter_owner)
+    {
+        close_counters();
+
+        /* hardware counters are grouped so that they are scheduled together,
+         * and so are the software counters. */
+        group_leaders[0] =
+            open_counter_group(MINUNIT_PERF_CYCLES, MINUNIT_PERF_PAGE_FAULTS);
+        group_leaders[1] =
+            open_counter_group(
+                MINUNIT_PERF_PAGE_FAULTS, MINUNIT_PERF_COUNTERS);
+        counter_owner = pid;
+    }
+}
+
+/**
+ * \brief Start counting for a test, opening the counters if need be.
+ */
+void minunit_perf_begin()
+{
+    minunit_perf_open();
+
+    for (int leader : group_leaders)
+    {
+        if (-1 == leader)
+            continue;
+
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+/**
+ * \brief Stop counting for a test, and read the counters.
+ *
+ * \param perf          The counts of the test to populate.
+ */
+void minunit_perf_end(test_perf_t* perf)
+{
+    for (int leader : group_leaders)
+    {
+        if (-1 != leader)
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    memset(perf, 0, sizeof(*perf));
+
+    for (int counter = 0; counter < MINUNIT_PERF_COUNTERS; ++counter)
+    {
+        /* the value, followed by the time enabled and the time running. */
+        uint64_t values[3];
+
+        if (!(counters_open & (1U << counter))
+         || (ssize_t)sizeof(values) !=
+                read(counter_fds[counter], values, sizeof(values)))
+        {
+            continue;
+        }
+
+        /* a group which was never scheduled has counted nothing. */
+        if (0 == values[2])
+            continue;
+
+        perf->counted |= 1U << counter;
+        perf->counts[counter] =
+            values[2] < values[1]
+                ? (uint64_t)((double)values[0] * values[1] / values[2])
+                : values[0];
+    }
+}
+
+#else
+
+uint32_t minunit_perf_probe()
+{
+    return 0;
+}
+
+void minunit_perf_open()
+{
+}
+
+void minunit_perf_begin()
+{
+}
+
+void minunit_perf_end(test_perf_t* perf)
+{
+    memset(perf, 0, sizeof(*perf));
+}
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * \file src/minunit_perf.h
+ *
+ * \brief Performance counters of tests, read through perf_event_open.
+ *
+ * The counters are opened by the process which runs the tests, the first time
+ * a test is run in that process, and are enabled only while a test runs.
+ * Hardware counters are often unavailable, for instance in containers or
+ * virtual machines, in which case only the software counters are counted, or
+ * nothing at all.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_PERF_HEADER_GUARD
+# define MINUNIT_PERF_HEADER_GUARD
+
+#include <stdint.h>
+
+#include "minunit_protocol.h"
+
+/**
+ * \brief The counters which count hardware events.
+ */
+#define MINUNIT_PERF_HARDWARE_COUNTERS \
+    ((1U << MINUNIT_PERF_CYCLES) | (1U << MINUNIT_PERF_INSTRUCTIONS) \
+   | (1U << MINUNIT_PERF_BRANCH_MISSES) | (1U << MINUNIT_PERF_L1D_MISSES) \
+   | (1U << MINUNIT_PERF_LLC_MISSES))
+
+/**
+ * \brief Get the name of a performance counter.
+ *
+ * \param counter       The counter.
+ *
+ * \returns the name of the counter, in lower case with words separated by
+ * underscores.
+ */
+const char* minunit_perf_counter_name(int counter);
+
+/**
+ * \brief Determine which performance counters this process may open.
+ *
+ * \returns a mask with the bit of each counter that could be opened.
+ */
+uint32_t minunit_perf_probe();
+
+/**
+ * \brief Open the counters of this process, if they are not already open,
+ * without counting anything.
+ *
+ * The counters are opened once in each process, so that a process forked from
+ * one that opened them opens its own.
+ */
+void minunit_perf_open();
+
+/**
+ * \brief Start counting for a test, opening the counters if need be.
+ */
+void minunit_perf_begin();
+
+/**
+ * \brief Stop counting for a test, and read the counters.
+ *
+ * A counter which was multiplexed with others is scaled up to the time the
+ * test ran.
+ *
+ * \param perf          The counts of the test to populate.
+ */
+void minunit_perf_end(test_perf_t* perf);
+
+#endif /*MINUNIT_PERF_HEADER_GUARD*/
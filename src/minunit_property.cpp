@@ -0,0 +1,577 @@
+/**
+ * \file src/minunit_property.cpp
+ *
+ * \brief Property tests, run over generated examples which are shrunk to a
+ * minimal counterexample when the property fails.
+ *
+ * Every generator draws its values from a sequence of choices.  An example is
+ * generated by drawing the choices at random, and replayed by drawing them
+ * from a recorded sequence instead.  Each generator maps smaller choices to
+ * simpler values, so a failing example is shrunk by deleting and lowering the
+ * choices it drew, keeping each simpler sequence that still fails, without
+ * the generators needing to know how to shrink their own values.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <inttypes.h>
+#include <minunit/minunit.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "minunit_assert.h"
+
+using namespace std;
+
+/**
+ * \brief The most times a failing example is replayed while shrinking it.
+ */
+#define PROPERTY_SHRINK_LIMIT 1000
+
+/**
+ * \brief The most bytes of a generated buffer shown in a counterexample.
+ */
+#define PROPERTY_DESCRIBE_LIMIT 64
+
+/**
+ * \brief The state of a property test while it runs an example.
+ */
+typedef struct property_state
+{
+    bool replay;
+    uint64_t random;
+    vector<uint64_t> source;
+    vector<uint64_t> drawn;
+    vector<bool> sizes;
+    vector<bool> failing_sizes;
+    vector<vector<uint8_t>> buffers;
+    bool describe;
+    vector<string> values;
+} property_state_t;
+
+/**
+ * \brief Get the next number from a splitmix64 sequence.
+ *
+ * \param state         The state of the sequence, which is advanced.
+ *
+ * \returns the next number in the sequence.
+ */
+static uint64_t next_random(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+/**
+ * \brief Compute the seed of an example, so that every example of every
+ * property test draws a different sequence from the same property seed.
+ *
+ * \param seed          The property seed of the run.
+ * \param name          The name of the test.
+ * \param example       The index of the example.
+ *
+ * \returns the seed of the example.
+ */
+static uint64_t example_seed(
+    uint64_t seed, const char* name, unsigned int example)
+{
+    uint64_t state = seed;
+
+    for (const char* ch = name; '\0' != *ch; ++ch)
+    {
+        state ^= (unsigned char)*ch;
+        state *= 1099511628211ULL;
+    }
+
+    state ^= (uint64_t)example * 0x9e3779b97f4a7c15ULL;
+
+    return next_random(&state);
+}
+
+/**
+ * \brief Draw the next choice of an example.
+ *
+ * A replayed choice beyond the limit is lowered to the limit, and a replayed
+ * sequence which runs out is extended with zeros, so that any sequence can be
+ * replayed.
+ *
+ * \param state         The property state.
+ * \param limit         The largest choice to draw.
+ *
+ * \returns a choice from 0 to limit inclusive.
+ */
+static uint64_t draw(property_state_t* state, uint64_t limit)
+{
+    uint64_t choice;
+
+    if (!state->replay)
+    {
+        choice = next_random(&state->random);
+        if (UINT64_MAX != limit)
+            choice %= limit + 1;
+    }
+    else if (state->drawn.size() < state->source.size())
+    {
+        choice = min(state->source[state->drawn.size()], limit);
+    }
+    else
+    {
+        choice = 0;
+    }
+
+    state->drawn.push_back(choice);
+    state->sizes.push_back(false);
+
+    return choice;
+}
+
+/**
+ * \brief Record a generated value, if the example is being described.
+ *
+ * \param state         The property state.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param value         The generated value.
+ */
+static void describe_value(
+    property_state_t* state, const char* file, int line, const char* expr,
+    const string& value)
+{
+    if (state->describe)
+    {
+        state->values.push_back(
+            string(file) + ":" + to_string(line) + ": " + expr + " = "
+          + value);
+    }
+}
+
+/**
+ * \brief Draw the size of a generated buffer or string.
+ *
+ * The choice is marked as a size, so that shrinking can lower it along with
+ * the choices it covers.
+ *
+ * \param state         The property state.
+ * \param min           The smallest size.
+ * \param max           The largest size.
+ *
+ * \returns the size.
+ */
+static size_t draw_size(property_state_t* state, size_t min, size_t max)
+{
+    if (min > max)
+        swap(min, max);
+
+    size_t size = min + (size_t)draw(state, max - min);
+    state->sizes.back() = true;
+
+    return size;
+}
+
+/**
+ * \brief Generate an integer for an example of a property test.
+ *
+ * The integer is drawn as a sign, a bit width, and a magnitude from the value
+ * in range nearest zero, so that small values are as likely as large ones,
+ * and each choice shrinks towards zero.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param min           The smallest integer to generate.
+ * \param max           The largest integer to generate.
+ *
+ * \returns the integer.
+ */
+int64_t minunit_generate_int(
+    minunit_test_context_t* context, const char* file, int line,
+    const char* expr, int64_t min, int64_t max)
+{
+    property_state_t* state = (property_state_t*)context->property;
+
+    if (min > max)
+        swap(min, max);
+
+    int64_t origin = min > 0 ? min : (max < 0 ? max : 0);
+    if (nullptr == state)
+        return origin;
+
+    uint64_t below = (uint64_t)origin - (uint64_t)min;
+    uint64_t above = (uint64_t)max - (uint64_t)origin;
+    bool negative = 0 != below && (0 == above || 0 != draw(state, 1));
+    uint64_t side = negative ? below : above;
+
+    unsigned int bits = (unsigned int)draw(state, 64);
+    uint64_t width = bits >= 64 ? UINT64_MAX : (1ULL << bits) - 1;
+    uint64_t magnitude = draw(state, std::min(side, width));
+
+    int64_t value =
+        (int64_t)(negative
+            ? (uint64_t)origin - magnitude : (uint64_t)origin + magnitude);
+
+    describe_value(state, file, line, expr, to_string(value));
+
+    return value;
+}
+
+/**
+ * \brief Generate a buffer of bytes for an example of a property test.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param min           The smallest size to generate.
+ * \param max           The largest size to generate.
+ * \param size          Set to the size of the buffer.
+ *
+ * \returns the buffer.
+ */
+const uint8_t* minunit_generate_buffer(
+    minunit_test_context_t* context, const char* file, int line,
+    const char* expr, size_t min, size_t max, size_t* size)
+{
+    property_state_t* state = (property_state_t*)context->property;
+    static const uint8_t empty[1] = { 0 };
+
+    if (nullptr == state)
+    {
+        *size = 0;
+        return empty;
+    }
+
+    *size = draw_size(state, min, max);
+
+    /* the extra byte keeps the buffer valid when it is empty. */
+    state->buffers.emplace_back(*size + 1, 0);
+    vector<uint8_t>& buffer = state->buffers.back();
+
+    for (size_t i = 0; i < *size; ++i)
+        buffer[i] = (uint8_t)draw(state, UINT8_MAX);
+
+    if (state->describe)
+    {
+        char hex[3];
+        string value = "{";
+
+        for (size_t i = 0; i < *size && i < PROPERTY_DESCRIBE_LIMIT; ++i)
+        {
+            snprintf(hex, sizeof(hex), "%02x", buffer[i]);
+            value += (0 == i ? "" : " ") + string(hex);
+        }
+
+        if (*size > PROPERTY_DESCRIBE_LIMIT)
+            value += " ...";
+
+        value += "} (" + to_string(*size) + " bytes)";
+        describe_value(state, file, line, expr, value);
+    }
+
+    return buffer.data();
+}
+
+/**
+ * \brief Generate a string of printable characters for an example of a
+ * property test.
+ *
+ * Characters are drawn from the printable ASCII characters, starting from 'a'
+ * so that they shrink towards lower case letters.
+ *
+ * \param context       The test context.
+ * \param file          The file containing the generator.
+ * \param line          The line of the generator.
+ * \param expr          The generator, as written.
+ * \param min           The smallest length to generate.
+ * \param max           The largest length to generate.
+ *
+ * \returns the string.
+ */
+const char* minunit_generate_string(
+    minunit_test_context_t* context, const char* file, int line,
+    const char* expr, size_t min, size_t max)
+{
+    property_state_t* state = (property_state_t*)context->property;
+
+    if (nullptr == state)
+        return "";
+
+    size_t length = draw_size(state, min, max);
+
+    state->buffers.emplace_back(length + 1, 0);
+    vector<uint8_t>& buffer = state->buffers.back();
+
+    for (size_t i = 0; i < length; ++i)
+        buffer[i] = (uint8_t)(' ' + ('a' - ' ' + draw(state, 94)) % 95);
+
+    if (state->describe)
+    {
+        string value = "\"";
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            if ('"' == buffer[i] || '\\' == buffer[i])
+                value += '\\';
+
+            value += (char)buffer[i];
+        }
+
+        describe_value(state, file, line, expr, value + "\"");
+    }
+
+    return (const char*)buffer.data();
+}
+
+/**
+ * \brief Run an example of a property test.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param func          The body of the test.
+ * \param state         The property state, set up to generate or replay the
+ *                      example.
+ *
+ * \returns true if the example passed, and false if it failed.
+ */
+static bool run_example(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    minunit_test_func_t func, property_state_t* state)
+{
+    state->drawn.clear();
+    state->sizes.clear();
+    state->buffers.clear();
+    state->values.clear();
+
+    minunit_test_set_pass(context, true);
+    func(options, context);
+
+    return context->pass;
+}
+
+/**
+ * \brief Replay a sequence of choices, and keep the choices it drew if it
+ * still fails and is simpler than the failing sequence so far.
+ *
+ * A sequence is simpler if it is shorter, or as long and lexicographically
+ * smaller.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param func          The body of the test.
+ * \param state         The property state.
+ * \param candidate     The sequence to replay.
+ * \param failing       The simplest failing sequence so far.
+ * \param runs          The number of replays so far, which is incremented.
+ *
+ * \returns true if the failing sequence was replaced, and false otherwise.
+ */
+static bool shrink_to(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    minunit_test_func_t func, property_state_t* state,
+    const vector<uint64_t>& candidate, vector<uint64_t>* failing,
+    unsigned int* runs)
+{
+    if (*runs >= PROPERTY_SHRINK_LIMIT)
+        return false;
+
+    ++*runs;
+    state->replay = true;
+    state->source = candidate;
+
+    if (run_example(options, context, func, state))
+        return false;
+
+    const vector<uint64_t>& drawn = state->drawn;
+    if (drawn.size() > failing->size()
+     || (drawn.size() == failing->size() && !(drawn < *failing)))
+    {
+        return false;
+    }
+
+    *failing = drawn;
+    state->failing_sizes = state->sizes;
+
+    return true;
+}
+
+/**
+ * \brief Shrink a failing sequence of choices, first by deleting blocks of
+ * choices, along with the size which covered them where there is one, and
+ * then by lowering each choice to the lowest value which still fails, until
+ * neither makes progress.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param func          The body of the test.
+ * \param state         The property state, holding which choices of the
+ *                      failing sequence are sizes.
+ * \param failing       The failing sequence, which is shrunk.
+ *
+ * \returns the number of times the sequence was shrunk.
+ */
+static unsigned int shrink_example(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    minunit_test_func_t func, property_state_t* state,
+    vector<uint64_t>* failing)
+{
+    unsigned int runs = 0;
+    unsigned int steps = 0;
+    bool progress = true;
+
+    while (progress && runs < PROPERTY_SHRINK_LIMIT)
+    {
+        progress = false;
+
+        for (size_t block = 8; block > 0; block /= 2)
+        {
+            size_t i = 0;
+            while (i + block <= failing->size())
+            {
+                vector<uint64_t> candidate = *failing;
+                candidate.erase(
+                    candidate.begin() + i, candidate.begin() + i + block);
+
+                /* a size before the block may be the one covering it. */
+                bool sized =
+                    i > 0 && state->failing_sizes[i - 1]
+                 && candidate[i - 1] >= block;
+
+                bool shrunk =
+                    shrink_to(
+                        options, context, func, state, candidate, failing,
+                        &runs);
+
+                if (!shrunk && sized)
+                {
+                    candidate[i - 1] -= block;
+                    shrunk =
+                        shrink_to(
+                            options, context, func, state, candidate, failing,
+                            &runs);
+                }
+
+                if (shrunk)
+                {
+                    progress = true;
+                    ++steps;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < failing->size(); ++i)
+        {
+            uint64_t lowest = 0;
+
+            while (i < failing->size() && lowest < (*failing)[i])
+            {
+                vector<uint64_t> candidate = *failing;
+                candidate[i] = lowest + (candidate[i] - lowest) / 2;
+
+                if (shrink_to(
+                        options, context, func, state, candidate, failing,
+                        &runs))
+                {
+                    progress = true;
+                    ++steps;
+                }
+                else if (runs < PROPERTY_SHRINK_LIMIT)
+                {
+                    lowest = candidate[i] + 1;
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return steps;
+}
+
+/**
+ * \brief Run a share of the examples of a property test, and shrink the first
+ * example which fails to a minimal counterexample.
+ *
+ * Failures are quiet while examples are searched and shrunk.  The minimal
+ * counterexample is then replayed once more to print its failures and its
+ * generated values.
+ *
+ * \param options       The test options.
+ * \param context       The test context.
+ * \param name          The name of the test, which seeds its examples.
+ * \param examples      The number of examples of the test, across its cases.
+ * \param func          The body of the test, run once for each example.
+ */
+void minunit_run_property(
+    const minunit_test_options_t* options, minunit_test_context_t* context,
+    const char* name, unsigned int examples, minunit_test_func_t func)
+{
+    unsigned int first =
+        context->case_index * MINUNIT_PROPERTY_EXAMPLES_PER_CASE;
+    unsigned int last =
+        min(examples, first + MINUNIT_PROPERTY_EXAMPLES_PER_CASE);
+
+    property_state_t state;
+    state.replay = false;
+    state.describe = false;
+    context->property = &state;
+
+    minunit_assert_quiet(true);
+
+    for (unsigned int example = first; example < last; ++example)
+    {
+        state.random = example_seed(options->property_seed, name, example);
+
+        if (run_example(options, context, func, &state))
+            continue;
+
+        /* a crash while shrinking still leaves the seed in the output. */
+        printf("Property %s failed on example %u of %u with "
+               "--property-seed=%" PRIu64 "; shrinking.\n",
+               name, example + 1, examples, options->property_seed);
+        fflush(stdout);
+
+        vector<uint64_t> failing = state.drawn;
+        state.failing_sizes = state.sizes;
+        unsigned int steps =
+            shrink_example(options, context, func, &state, &failing);
+
+        minunit_assert_quiet(false);
+
+        state.replay = true;
+        state.source = failing;
+        state.describe = true;
+
+        if (run_example(options, context, func, &state))
+        {
+            printf("The shrunk counterexample passed when replayed, so the "
+                   "property may depend on more than its generated "
+                   "inputs.\n");
+            minunit_test_set_pass(context, false);
+        }
+
+        printf("Counterexample, shrunk %u time%s:\n",
+               steps, 1 == steps ? "" : "s");
+        for (const string& value : state.values)
+            printf("    %s\n", value.c_str());
+
+        break;
+    }
+
+    minunit_assert_quiet(false);
+    context->property = nullptr;
+}
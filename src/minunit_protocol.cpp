@@ -0,0 +1,161 @@
+/**
+ * \file src/minunit_protocol.cpp
+ *
+ * \brief Message framing for the forked test runner.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "minunit_protocol.h"
+
+using namespace std;
+
+/**
+ * \brief Size of each read from a socket.
+ */
+#define MINUNIT_PROTOCOL_READ_SIZE 65536
+
+/**
+ * \brief Append a frame to an output buffer.
+ *
+ * \param buffer        The buffer to append to.
+ * \param type          The message type.
+ * \param payload       The payload of this message.
+ * \param size          The size of the payload.
+ */
+void minunit_frame_append(
+    vector<uint8_t>* buffer, uint8_t type, const void* payload, size_t size)
+{
+    minunit_frame_header_t header;
+
+    MODEL_ASSERT(size <= MINUNIT_PROTOCOL_MAX_PAYLOAD);
+
+    header.magic = MINUNIT_PROTOCOL_MAGIC;
+    header.version = MINUNIT_PROTOCOL_VERSION;
+    header.type = type;
+    header.length = (uint32_t)size;
+
+    const uint8_t* h = (const uint8_t*)&header;
+    const uint8_t* p = (const uint8_t*)payload;
+
+    buffer->insert(buffer->end(), h, h + sizeof(header));
+    buffer->insert(buffer->end(), p, p + size);
+}
+
+/**
+ * \brief Decode the next frame from an input buffer.
+ *
+ * \param buffer        The buffer to decode from.
+ * \param offset        The offset of the next frame, updated past the frame
+ *                      when it is decoded.
+ * \param header        The decoded header.
+ * \param payload       Set to the start of the payload in the buffer.
+ *
+ * \returns MINUNIT_FRAME_DECODED if a frame was decoded,
+ * MINUNIT_FRAME_INCOMPLETE if more data is needed, or MINUNIT_FRAME_INVALID if
+ * the buffer does not hold a valid frame.
+ */
+int minunit_frame_decode(
+    const vector<uint8_t>& buffer, size_t* offset,
+    minunit_frame_header_t* header, const uint8_t** payload)
+{
+    size_t available = buffer.size() - *offset;
+
+    if (available < sizeof(*header))
+    {
+        return MINUNIT_FRAME_INCOMPLETE;
+    }
+
+    memcpy(header, buffer.data() + *offset, sizeof(*header));
+
+    if (MINUNIT_PROTOCOL_MAGIC != header->magic
+     || MINUNIT_PROTOCOL_VERSION != header->version
+     || header->length > MINUNIT_PROTOCOL_MAX_PAYLOAD)
+    {
+        return MINUNIT_FRAME_INVALID;
+    }
+
+    if (available - sizeof(*header) < header->length)
+    {
+        return MINUNIT_FRAME_INCOMPLETE;
+    }
+
+    *payload = buffer.data() + *offset + sizeof(*header);
+    *offset += sizeof(*header) + header->length;
+
+    return MINUNIT_FRAME_DECODED;
+}
+
+/**
+ * \brief Discard decoded frames from the front of an input buffer.
+ *
+ * \param buffer        The buffer to compact.
+ * \param offset        The offset of the first frame not yet decoded, which is
+ *                      reset to zero.
+ */
+void minunit_frame_compact(vector<uint8_t>* buffer, size_t* offset)
+{
+    buffer->erase(buffer->begin(), buffer->begin() + *offset);
+    *offset = 0;
+}
+
+/**
+ * \brief Read whatever data is available from a socket into a buffer.
+ *
+ * \param s             The socket to read.
+ * \param buffer        The buffer to append to.
+ *
+ * \returns true if data was read, or false on end of file or error.
+ */
+bool minunit_socket_read(int s, vector<uint8_t>* buffer)
+{
+    size_t size = buffer->size();
+    ssize_t bytes;
+
+    buffer->resize(size + MINUNIT_PROTOCOL_READ_SIZE);
+
+    do
+    {
+        bytes = read(s, buffer->data() + size, MINUNIT_PROTOCOL_READ_SIZE);
+    } while (bytes < 0 && EINTR == errno);
+
+    buffer->resize(size + (bytes > 0 ? (size_t)bytes : 0));
+
+    return bytes > 0;
+}
+
+/**
+ * \brief Write a buffer to a socket in full, and clear the buffer.
+ *
+ * \param s             The socket to write.
+ * \param buffer        The buffer to write.
+ *
+ * \returns true on success, and false on error.
+ */
+bool minunit_socket_flush(int s, vector<uint8_t>* buffer)
+{
+    const uint8_t* buf = buffer->data();
+    size_t size = buffer->size();
+
+    while (size > 0)
+    {
+        ssize_t bytes = write(s, buf, size);
+        if (bytes < 0 && EINTR == errno)
+            continue;
+        if (bytes <= 0)
+            return false;
+
+        buf += bytes;
+        size -= (size_t)bytes;
+    }
+
+    buffer->clear();
+
+    return true;
+}
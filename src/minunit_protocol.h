@@ -0,0 +1,307 @@
+/**
+ * \file src/minunit_protocol.h
+ *
+ * \brief Message protocol between the test runner and its forked children.
+ *
+ * Messages are sent as frames over the socket connecting the parent to each
+ * forked test runner.  Each frame begins with a header holding a magic number,
+ * the protocol version, the message type, and the length of the payload which
+ * follows.  Frames are accumulated in buffers, so that several frames can be
+ * sent or received with a single system call.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_PROTOCOL_HEADER_GUARD
+# define MINUNIT_PROTOCOL_HEADER_GUARD
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \brief Magic number at the start of every frame.
+ */
+#define MINUNIT_PROTOCOL_MAGIC 0x4d55
+
+/**
+ * \brief Version of the message protocol.
+ */
+#define MINUNIT_PROTOCOL_VERSION 6
+
+/**
+ * \brief Maximum payload size of a single frame.
+ */
+#define MINUNIT_PROTOCOL_MAX_PAYLOAD (16U * 1024U * 1024U)
+
+/**
+ * \brief Message types.
+ */
+enum minunit_message_type
+{
+    /* parent to child: a batch of test indices to run, in order. */
+    MINUNIT_MESSAGE_RUN                 = 1,
+
+    /* child to parent: the result of a single test. */
+    MINUNIT_MESSAGE_RESULT              = 2,
+
+    /* child to parent: benchmark statistics, sent before the result. */
+    MINUNIT_MESSAGE_BENCHMARK           = 3,
+
+    /* child to parent: a test crashed in a process forked by the zygote. */
+    MINUNIT_MESSAGE_CRASH               = 4,
+
+    /* child to parent: captured output of a test, sent before the result. */
+    MINUNIT_MESSAGE_OUTPUT              = 5,
+
+    /* either direction: wake a peer waiting on the shared memory ring. */
+    MINUNIT_MESSAGE_WAKE                = 6,
+
+    /* child to parent: performance counters, sent before the result. */
+    MINUNIT_MESSAGE_PERF                = 7,
+
+    /* child to parent: a failed assertion, sent before the result. */
+    MINUNIT_MESSAGE_FAILURE             = 8,
+};
+
+/**
+ * \brief Header at the start of every frame.
+ */
+typedef struct minunit_frame_header
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint32_t length;
+} minunit_frame_header_t;
+
+/**
+ * \brief Time and resource usage measured for a single test.
+ *
+ * The peak resident set size is kept by the process, over every test it runs,
+ * so a test is credited with how far it raised that peak rather than with the
+ * peak itself.
+ *
+ * Descriptors left open by the test are only counted under a limit on open
+ * files.
+ */
+typedef struct test_usage
+{
+    uint64_t wall_ns;
+    uint64_t user_ns;
+    uint64_t system_ns;
+    uint64_t rss_growth_kb;
+    uint64_t leaked_files;
+} test_usage_t;
+
+/**
+ * \brief Statistics measured for a benchmark test.
+ */
+typedef struct test_benchmark
+{
+    uint64_t iterations;
+    uint32_t samples;
+    uint32_t reserved;
+    double mean_ns;
+    double median_ns;
+    double stddev_ns;
+} test_benchmark_t;
+
+/**
+ * \brief Timing of a test over repeated runs.
+ *
+ * For a benchmark test, the samples are the benchmark samples and the times are
+ * per operation.  For any other test, each sample is one run of the test.
+ */
+typedef struct test_timing
+{
+    uint32_t samples;
+    uint32_t reserved;
+    double mean_ns;
+    double stddev_ns;
+} test_timing_t;
+
+/**
+ * \brief Heap usage of a test, measured when the heap shim is loaded.
+ *
+ * The peak is the most bytes live at once during the test, beyond those live
+ * when it started.  Blocks allocated by the test and not freed by the time it
+ * returned are counted as leaked.
+ */
+typedef struct test_heap
+{
+    uint32_t tracked;
+    uint32_t reserved;
+    uint64_t allocations;
+    uint64_t bytes;
+    uint64_t peak_bytes;
+    uint64_t leaked_blocks;
+    uint64_t leaked_bytes;
+} test_heap_t;
+
+/**
+ * \brief Performance counters measured for a test.
+ */
+enum minunit_perf_counter
+{
+    MINUNIT_PERF_CYCLES,
+    MINUNIT_PERF_INSTRUCTIONS,
+    MINUNIT_PERF_BRANCH_MISSES,
+    MINUNIT_PERF_L1D_MISSES,
+    MINUNIT_PERF_LLC_MISSES,
+    MINUNIT_PERF_PAGE_FAULTS,
+    MINUNIT_PERF_CONTEXT_SWITCHES,
+    MINUNIT_PERF_COUNTERS
+};
+
+/**
+ * \brief Performance counts of a test, measured when performance counters are
+ * enabled.
+ *
+ * Only the counters with their bit set in the counted mask were counted.
+ */
+typedef struct test_perf
+{
+    uint32_t counted;
+    uint32_t reserved;
+    uint64_t counts[MINUNIT_PERF_COUNTERS];
+} test_perf_t;
+
+/**
+ * \brief Payload of a BENCHMARK message.
+ */
+typedef struct minunit_benchmark_record
+{
+    uint32_t index;
+    uint32_t reserved;
+    test_benchmark_t benchmark;
+} minunit_benchmark_record_t;
+
+/**
+ * \brief Payload of a PERF message.
+ */
+typedef struct minunit_perf_record
+{
+    uint32_t index;
+    uint32_t reserved;
+    test_perf_t perf;
+} minunit_perf_record_t;
+
+/**
+ * \brief Payload of a RESULT message.
+ */
+typedef struct minunit_result_record
+{
+    uint32_t index;
+    uint32_t pass;
+    test_usage_t usage;
+    test_timing_t timing;
+    test_heap_t heap;
+} minunit_result_record_t;
+
+/**
+ * \brief Payload of a CRASH message.
+ */
+typedef struct minunit_crash_record
+{
+    uint32_t index;
+    int32_t status;
+    test_usage_t usage;
+} minunit_crash_record_t;
+
+/**
+ * \brief Header of the payload of an OUTPUT message, which is followed by the
+ * captured output.
+ */
+typedef struct minunit_output_record
+{
+    uint32_t index;
+    uint32_t reserved;
+} minunit_output_record_t;
+
+/**
+ * \brief Header of the payload of a FAILURE message, which is followed by the
+ * file, the expression, and the values compared, each of the given length.
+ */
+typedef struct minunit_failure_record
+{
+    uint32_t index;
+    int32_t line;
+    int32_t thread;
+    uint32_t dropped;
+    uint32_t file_length;
+    uint32_t expression_length;
+    uint32_t lhs_length;
+    uint32_t rhs_length;
+} minunit_failure_record_t;
+
+/**
+ * \brief Status of an attempt to decode a frame.
+ */
+enum minunit_frame_status
+{
+    MINUNIT_FRAME_INCOMPLETE,
+    MINUNIT_FRAME_DECODED,
+    MINUNIT_FRAME_INVALID
+};
+
+/**
+ * \brief Append a frame to an output buffer.
+ *
+ * \param buffer        The buffer to append to.
+ * \param type          The message type.
+ * \param payload       The payload of this message.
+ * \param size          The size of the payload.
+ */
+void minunit_frame_append(
+    std::vector<uint8_t>* buffer, uint8_t type, const void* payload,
+    size_t size);
+
+/**
+ * \brief Decode the next frame from an input buffer.
+ *
+ * \param buffer        The buffer to decode from.
+ * \param offset        The offset of the next frame, updated past the frame
+ *                      when it is decoded.
+ * \param header        The decoded header.
+ * \param payload       Set to the start of the payload in the buffer.
+ *
+ * \returns MINUNIT_FRAME_DECODED if a frame was decoded,
+ * MINUNIT_FRAME_INCOMPLETE if more data is needed, or MINUNIT_FRAME_INVALID if
+ * the buffer does not hold a valid frame.
+ */
+int minunit_frame_decode(
+    const std::vector<uint8_t>& buffer, size_t* offset,
+    minunit_frame_header_t* header, const uint8_t** payload);
+
+/**
+ * \brief Discard decoded frames from the front of an input buffer.
+ *
+ * \param buffer        The buffer to compact.
+ * \param offset        The offset of the first frame not yet decoded, which is
+ *                      reset to zero.
+ */
+void minunit_frame_compact(std::vector<uint8_t>* buffer, size_t* offset);
+
+/**
+ * \brief Read whatever data is available from a socket into a buffer.
+ *
+ * \param s             The socket to read.
+ * \param buffer        The buffer to append to.
+ *
+ * \returns true if data was read, or false on end of file or error.
+ */
+bool minunit_socket_read(int s, std::vector<uint8_t>* buffer);
+
+/**
+ * \brief Write a buffer to a socket in full, and clear the buffer.
+ *
+ * \param s             The socket to write.
+ * \param buffer        The buffer to write.
+ *
+ * \returns true on success, and false on error.
+ */
+bool minunit_socket_flush(int s, std::vector<uint8_t>* buffer);
+
+#endif /*MINUNIT_PROTOCOL_HEADER_GUARD*/
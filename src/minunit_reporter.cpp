@@ -0,0 +1,289 @@
+/**
+ * \file src/minunit_reporter.cpp
+ *
+ * \brief Selection of the reporters for a test run.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef HAS_WAITPID
+# include <sys/wait.h>
+#endif
+
+#include "minunit_reporter.h"
+
+using namespace std;
+
+/**
+ * \brief A reporter which passes each hook to several reporters.
+ */
+typedef struct tee_reporter : minunit_reporter_t
+{
+    vector<minunit_reporter_t*> reporters;
+} tee_reporter_t;
+
+static void tee_run_start(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->run_start(i, run);
+}
+
+static void tee_suite_start(minunit_reporter_t* reporter, const char* suite)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->suite_start(i, suite);
+}
+
+static void tee_suite_end(minunit_reporter_t* reporter, const char* suite)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->suite_end(i, suite);
+}
+
+static void tee_test_start(
+    minunit_reporter_t* reporter, const char* suite, const char* name)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->test_start(i, suite, name);
+}
+
+static void tee_test_end(
+    minunit_reporter_t* reporter, const minunit_test_report_t* test)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->test_end(i, test);
+}
+
+static void tee_run_end(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->run_end(i, run);
+}
+
+static void tee_release(minunit_reporter_t* reporter)
+{
+    tee_reporter_t* tee = static_cast<tee_reporter_t*>(reporter);
+
+    for (minunit_reporter_t* i : tee->reporters)
+        i->vtable->release(i);
+
+    delete tee;
+}
+
+static const minunit_reporter_vtable_t tee_vtable = {
+    &tee_run_start, &tee_suite_start, &tee_suite_end, &tee_test_start,
+    &tee_test_end, &tee_run_end, &tee_release };
+
+/**
+ * \brief Split a reporter specification into its name and file.
+ *
+ * \param spec          The reporter specification.
+ * \param name          Set to the reporter name.
+ * \param file          Set to the file name, or an empty string.
+ */
+static void split_reporter_spec(const char* spec, string* name, string* file)
+{
+    const char* colon = strchr(spec, ':');
+
+    if (NULL == colon)
+    {
+        *name = spec;
+        file->clear();
+    }
+    else
+    {
+        name->assign(spec, colon - spec);
+        *file = colon + 1;
+    }
+}
+
+/**
+ * \brief Check whether a reporter specification is valid.
+ *
+ * \param spec          The reporter specification.
+ *
+ * \returns true if the specification names a known reporter, and false
+ * otherwise.
+ */
+bool minunit_reporter_valid(const char* spec)
+{
+    string name;
+    string file;
+    split_reporter_spec(spec, &name, &file);
+
+    if ("terminal" == name)
+        return NULL == strchr(spec, ':');
+
+    return "junit" == name || "jsonl" == name;
+}
+
+/**
+ * \brief Check whether a reporter writes to standard output.
+ *
+ * \param spec          A valid reporter specification.
+ *
+ * \returns true if the reporter writes to standard output, and false if it
+ * writes to a file.
+ */
+bool minunit_reporter_to_stdout(const char* spec)
+{
+    string name;
+    string file;
+    split_reporter_spec(spec, &name, &file);
+
+    return "" == file;
+}
+
+/**
+ * \brief Check whether a reporter writes a machine-readable report.
+ *
+ * \param spec          A valid reporter specification.
+ *
+ * \returns true for the junit and jsonl reporters, and false otherwise.
+ */
+bool minunit_reporter_machine_readable(const char* spec)
+{
+    string name;
+    string file;
+    split_reporter_spec(spec, &name, &file);
+
+    return "terminal" != name;
+}
+
+/**
+ * \brief Create a single reporter from its specification.
+ *
+ * \param options       The test options.
+ * \param spec          The reporter specification.
+ *
+ * \returns the reporter, or NULL if its report file could not be opened.
+ */
+static minunit_reporter_t* create_reporter(
+    const minunit_test_options_t* options, const char* spec)
+{
+    string name;
+    string file;
+    split_reporter_spec(spec, &name, &file);
+
+    if ("terminal" == name)
+    {
+        return minunit_terminal_reporter_create(options);
+    }
+
+    FILE* out = stdout;
+    if ("" != file)
+    {
+        out = fopen(file.c_str(), "w");
+        if (NULL == out)
+        {
+            fprintf(stderr, "Could not open report %s: %s.\n",
+                    file.c_str(), strerror(errno));
+            return NULL;
+        }
+    }
+
+    if ("junit" == name)
+        return minunit_junit_reporter_create(out);
+
+    return minunit_jsonl_reporter_create(out);
+}
+
+/**
+ * \brief Create the reporter for the test run.
+ *
+ * \param options       The test options, including the reporter
+ *                      specifications.
+ *
+ * \returns the reporter, or NULL if a report file could not be opened, with
+ * an error printed to standard error.
+ */
+minunit_reporter_t* minunit_reporter_create(
+    const minunit_test_options_t* options)
+{
+    if (0 == options->reporter_count)
+    {
+        return minunit_terminal_reporter_create(options);
+    }
+
+    tee_reporter_t* tee = new tee_reporter_t;
+    tee->vtable = &tee_vtable;
+
+    for (unsigned int i = 0; i < options->reporter_count; ++i)
+    {
+        minunit_reporter_t* reporter =
+            create_reporter(options, options->reporters[i]);
+        if (NULL == reporter)
+        {
+            tee_release(tee);
+            return NULL;
+        }
+
+        tee->reporters.push_back(reporter);
+    }
+
+    /* a single reporter needs no tee. */
+    if (1 == tee->reporters.size())
+    {
+        minunit_reporter_t* reporter = tee->reporters.front();
+        delete tee;
+
+        return reporter;
+    }
+
+    return tee;
+}
+
+/**
+ * \brief Describe how a crashed test runner terminated.
+ *
+ * \param status        The wait status of the crashed test runner.
+ *
+ * \returns a description of the crash, or an empty string if the status does
+ * not describe a termination.
+ */
+string minunit_crash_description(int status)
+{
+    char description[96] = "";
+
+#ifdef HAS_WAITPID
+    if (WIFSIGNALED(status))
+    {
+        int sig = WTERMSIG(status);
+        snprintf(
+            description, sizeof(description), "signal %d: %s", sig,
+            strsignal(sig));
+    }
+    else if (WIFEXITED(status))
+    {
+        snprintf(
+            description, sizeof(description), "exited with status %d",
+            WEXITSTATUS(status));
+    }
+#else
+    (void)status;
+#endif
+
+    return description;
+}
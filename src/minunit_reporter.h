@@ -0,0 +1,236 @@
+/**
+ * \file src/minunit_reporter.h
+ *
+ * \brief Reporters, which write the results of a test run as it progresses.
+ *
+ * The test runner reports a run through a reporter, which is a table of hooks
+ * called as the run starts, as each suite starts and ends, as each test starts
+ * and ends, and as the run ends.  Tests are always reported in registration
+ * order.  Each hook writes its part of the report immediately, so that no
+ * reporter holds the whole report in memory.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_REPORTER_HEADER_GUARD
+# define MINUNIT_REPORTER_HEADER_GUARD
+
+#include <minunit/minunit.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "minunit_assert.h"
+#include "minunit_protocol.h"
+
+/**
+ * \brief Outcome of a test.
+ *
+ * A test which exceeded its memory or CPU limit was killed, as was one which
+ * crashed.  A test which left files open under a limit on open files is
+ * reported as leaking them, whether or not its assertions held.
+ */
+enum minunit_test_outcome
+{
+    MINUNIT_TEST_OUTCOME_PASS,
+    MINUNIT_TEST_OUTCOME_FAIL,
+    MINUNIT_TEST_OUTCOME_CRASH,
+    MINUNIT_TEST_OUTCOME_TIMEOUT,
+    MINUNIT_TEST_OUTCOME_OOM,
+    MINUNIT_TEST_OUTCOME_CPU_LIMIT,
+    MINUNIT_TEST_OUTCOME_FD_LEAK
+};
+
+/**
+ * \brief The result of a single test, as passed to a reporter.
+ *
+ * A test repeated over several rounds is reported once, with the details of
+ * its first failed run, or of its last run if every run passed.  The seed is
+ * set only if tests were shuffled and the test failed, and is the seed which
+ * reproduces the order of the round in which it first failed.  The failures
+ * are the failed assertions of the run reported, which reporters render
+ * alongside the output of the test.
+ */
+typedef struct minunit_test_report
+{
+    const char* suite;
+    const char* name;
+    int outcome;
+    int status;
+    const test_usage_t* usage;
+    const test_benchmark_t* benchmark;
+    const test_timing_t* timing;
+    const test_heap_t* heap;
+    const test_perf_t* perf;
+    const char* output;
+    size_t output_size;
+    const minunit_failure_t* failures;
+    size_t failure_count;
+    unsigned int runs;
+    unsigned int failed_runs;
+    unsigned int failed_round;
+    bool seeded;
+    uint64_t seed;
+} minunit_test_report_t;
+
+/**
+ * \brief A change in the timing of a test against the baseline.
+ */
+typedef struct minunit_timing_report
+{
+    std::string name;
+    bool benchmark;
+    int change;
+    double baseline_ns;
+    double current_ns;
+    double percent;
+    double margin;
+} minunit_timing_report_t;
+
+/**
+ * \brief A summary of a test run, as passed to a reporter.
+ *
+ * At the start of the run, only the counts of suites and tests, the shard,
+ * the count of tests left out as unaffected by a change, and the shuffle seed
+ * are set, and the rounds are the number requested, where 0 repeats the tests
+ * until one fails.  At the end, the rounds are the number started.
+ */
+typedef struct minunit_run_report
+{
+    unsigned int suites;
+    unsigned int tests;
+    unsigned int failures;
+    bool display_stats;
+    unsigned int shard_index;
+    unsigned int shard_count;
+    unsigned int unaffected;
+    const char* baseline;
+    const minunit_timing_report_t* changes;
+    size_t change_count;
+    unsigned int rounds;
+    bool until_fail;
+    bool shuffled;
+    uint64_t seed;
+} minunit_run_report_t;
+
+typedef struct minunit_reporter minunit_reporter_t;
+
+/**
+ * \brief The hooks of a reporter.
+ */
+typedef struct minunit_reporter_vtable
+{
+    void (*run_start)(
+        minunit_reporter_t* reporter, const minunit_run_report_t* run);
+    void (*suite_start)(minunit_reporter_t* reporter, const char* suite);
+    void (*suite_end)(minunit_reporter_t* reporter, const char* suite);
+    void (*test_start)(
+        minunit_reporter_t* reporter, const char* suite, const char* name);
+    void (*test_end)(
+        minunit_reporter_t* reporter, const minunit_test_report_t* test);
+    void (*run_end)(
+        minunit_reporter_t* reporter, const minunit_run_report_t* run);
+    void (*release)(minunit_reporter_t* reporter);
+} minunit_reporter_vtable_t;
+
+/**
+ * \brief A reporter.  Each reporter extends this with its own state.
+ */
+struct minunit_reporter
+{
+    const minunit_reporter_vtable_t* vtable;
+};
+
+/**
+ * \brief Check whether a reporter specification is valid.
+ *
+ * A specification is a reporter name, optionally followed by a colon and the
+ * file to write the report to.  The terminal reporter always writes to
+ * standard output, and the junit and jsonl reporters write to standard output
+ * when no file is given.
+ *
+ * \param spec          The reporter specification.
+ *
+ * \returns true if the specification names a known reporter, and false
+ * otherwise.
+ */
+bool minunit_reporter_valid(const char* spec);
+
+/**
+ * \brief Check whether a reporter writes to standard output.
+ *
+ * \param spec          A valid reporter specification.
+ *
+ * \returns true if the reporter writes to standard output, and false if it
+ * writes to a file.
+ */
+bool minunit_reporter_to_stdout(const char* spec);
+
+/**
+ * \brief Check whether a reporter writes a machine-readable report, which is
+ * corrupted by anything else written to the same stream.
+ *
+ * \param spec          A valid reporter specification.
+ *
+ * \returns true for the junit and jsonl reporters, and false otherwise.
+ */
+bool minunit_reporter_machine_readable(const char* spec);
+
+/**
+ * \brief Create the reporter for the test run.
+ *
+ * When more than one reporter is specified, the reporter returned passes each
+ * hook to every one of them in turn.
+ *
+ * \param options       The test options, including the reporter
+ *                      specifications.
+ *
+ * \returns the reporter, or NULL if a report file could not be opened, with
+ * an error printed to standard error.
+ */
+minunit_reporter_t* minunit_reporter_create(
+    const minunit_test_options_t* options);
+
+/**
+ * \brief Create a reporter which prints a human-readable report to standard
+ * output.
+ *
+ * \param options       The test options.
+ *
+ * \returns the reporter.
+ */
+minunit_reporter_t* minunit_terminal_reporter_create(
+    const minunit_test_options_t* options);
+
+/**
+ * \brief Create a reporter which writes a JUnit XML report.
+ *
+ * \param out           The stream to write the report to, which the reporter
+ *                      closes on release unless it is standard output.
+ *
+ * \returns the reporter.
+ */
+minunit_reporter_t* minunit_junit_reporter_create(FILE* out);
+
+/**
+ * \brief Create a reporter which writes a JSON object per line for each hook.
+ *
+ * \param out           The stream to write the report to, which the reporter
+ *                      closes on release unless it is standard output.
+ *
+ * \returns the reporter.
+ */
+minunit_reporter_t* minunit_jsonl_reporter_create(FILE* out);
+
+/**
+ * \brief Describe how a crashed test runner terminated.
+ *
+ * \param status        The wait status of the crashed test runner.
+ *
+ * \returns a description of the crash, or an empty string if the status does
+ * not describe a termination.
+ */
+std::string minunit_crash_description(int status);
+
+#endif /*MINUNIT_REPORTER_HEADER_GUARD*/
@@ -0,0 +1,387 @@
+/**
+ * \file src/minunit_reporter_jsonl.cpp
+ *
+ * \brief Reporter which writes a JSON object per line for each hook.
+ *
+ * Every line is a complete JSON object with an "event" member naming the hook,
+ * so that the report can be read line by line while the run is in progress.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "minunit_perf.h"
+#include "minunit_reporter.h"
+#include "minunit_timings.h"
+
+using namespace std;
+
+/**
+ * \brief The JSON Lines reporter.
+ */
+typedef struct jsonl_reporter : minunit_reporter_t
+{
+    FILE* out;
+} jsonl_reporter_t;
+
+/**
+ * \brief Write a JSON string.
+ *
+ * \param out           The stream to write to.
+ * \param data          The string to write.
+ * \param size          The size of the string.
+ */
+static void write_json_string(FILE* out, const char* data, size_t size)
+{
+    fputc('"', out);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        unsigned char ch = (unsigned char)data[i];
+
+        switch (ch)
+        {
+            case '"':
+                fputs("\\\"", out);
+                break;
+
+            case '\\':
+                fputs("\\\\", out);
+                break;
+
+            case '\n':
+                fputs("\\n", out);
+                break;
+
+            case '\r':
+                fputs("\\r", out);
+                break;
+
+            case '\t':
+                fputs("\\t", out);
+                break;
+
+            default:
+                if (ch < 0x20)
+                    fprintf(out, "\\u%04x", ch);
+                else
+                    fputc(ch, out);
+                break;
+        }
+    }
+
+    fputc('"', out);
+}
+
+/**
+ * \brief Write a named JSON string member, preceded by a comma.
+ *
+ * \param out           The stream to write to.
+ * \param name          The name of the member.
+ * \param value         The string value of the member.
+ */
+static void write_json_member(FILE* out, const char* name, const char* value)
+{
+    fprintf(out, ",\"%s\":", name);
+    write_json_string(out, value, strlen(value));
+}
+
+/**
+ * \brief Write a failed assertion as a JSON object.
+ *
+ * \param out           The stream to write to.
+ * \param failure       The failure.
+ * \param separate      true to precede the object with a comma.
+ */
+static void write_json_failure(
+    FILE* out, const minunit_failure_t* failure, bool separate)
+{
+    if (separate)
+        fputc(',', out);
+
+    fputs("{\"file\":", out);
+    write_json_string(out, failure->file.data(), failure->file.size());
+    fprintf(out, ",\"line\":%d", failure->line);
+    write_json_member(out, "expression", failure->expression.c_str());
+
+    if ("" != failure->lhs || "" != failure->rhs)
+    {
+        write_json_member(out, "lhs", failure->lhs.c_str());
+        write_json_member(out, "rhs", failure->rhs.c_str());
+    }
+
+    if (failure->thread >= 0)
+        fprintf(out, ",\"thread\":%d", failure->thread);
+    else if (MINUNIT_FAILURE_OTHER_THREAD == failure->thread)
+        fputs(",\"thread\":null", out);
+
+    if (failure->dropped > 0)
+        fprintf(out, ",\"dropped\":%u", failure->dropped);
+
+    fputc('}', out);
+}
+
+/**
+ * \brief Get the name of an outcome.
+ *
+ * \param outcome       The outcome of a test.
+ *
+ * \returns the name of the outcome.
+ */
+static const char* outcome_name(int outcome)
+{
+    switch (outcome)
+    {
+        case MINUNIT_TEST_OUTCOME_PASS:
+            return "pass";
+
+        case MINUNIT_TEST_OUTCOME_CRASH:
+            return "crash";
+
+        case MINUNIT_TEST_OUTCOME_TIMEOUT:
+            return "timeout";
+
+        case MINUNIT_TEST_OUTCOME_OOM:
+            return "oom";
+
+        case MINUNIT_TEST_OUTCOME_CPU_LIMIT:
+            return "cpu_limit";
+
+        case MINUNIT_TEST_OUTCOME_FD_LEAK:
+            return "fd_leak";
+
+        default:
+            return "fail";
+    }
+}
+
+static void jsonl_run_start(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    FILE* out = static_cast<jsonl_reporter_t*>(reporter)->out;
+
+    fprintf(out,
+            "{\"event\":\"run_start\",\"suites\":%u,\"tests\":%u,"
+            "\"shard_index\":%u,\"shard_count\":%u,\"unaffected\":%u,"
+            "\"rounds\":%u,\"until_fail\":%s",
+            run->suites, run->tests, run->shard_index, run->shard_count,
+            run->unaffected, run->rounds, run->until_fail ? "true" : "false");
+
+    if (run->shuffled)
+        fprintf(out, ",\"seed\":%llu", (unsigned long long)run->seed);
+
+    fputs("}\n", out);
+}
+
+static void jsonl_suite_start(minunit_reporter_t* reporter, const char* suite)
+{
+    FILE* out = static_cast<jsonl_reporter_t*>(reporter)->out;
+
+    fputs("{\"event\":\"suite_start\"", out);
+    write_json_member(out, "suite", suite);
+    fputs("}\n", out);
+}
+
+static void jsonl_suite_end(minunit_reporter_t* reporter, const char* suite)
+{
+    FILE* out = static_cast<jsonl_reporter_t*>(reporter)->out;
+
+    fputs("{\"event\":\"suite_end\"", out);
+    write_json_member(out, "suite", suite);
+    fputs("}\n", out);
+}
+
+static void jsonl_test_start(
+    minunit_reporter_t* reporter, const char* suite, const char* name)
+{
+    FILE* out = static_cast<jsonl_reporter_t*>(reporter)->out;
+
+    fputs("{\"event\":\"test_start\"", out);
+    write_json_member(out, "suite", suite);
+    write_json_member(out, "test", name);
+    fputs("}\n", out);
+}
+
+static void jsonl_test_end(
+    minunit_reporter_t* reporter, const minunit_test_report_t* test)
+{
+    FILE* out = static_cast<jsonl_reporter_t*>(reporter)->out;
+
+    fputs("{\"event\":\"test_end\"", out);
+    write_json_member(out, "suite", test->suite);
+    write_json_member(out, "test", test->name);
+    write_json_member(out, "outcome", outcome_name(test->outcome));
+
+    if (MINUNIT_TEST_OUTCOME_CRASH == test->outcome)
+    {
+        write_json_member(
+            out, "crash", minunit_crash_description(test->status).c_str());
+    }
+
+    fprintf(out,
+            ",\"wall_ns\":%llu,\"user_ns\":%llu,\"system_ns\":%llu,"
+            "\"rss_growth_kb\":%llu",
+            (unsigned long long)test->usage->wall_ns,
+            (unsigned long long)test->usage->user_ns,
+            (unsigned long long)test->usage->system_ns,
+            (unsigned long long)test->usage->rss_growth_kb);
+
+    if (test->usage->leaked_files > 0)
+    {
+        fprintf(out, ",\"leaked_files\":%llu",
+                (unsigned long long)test->usage->leaked_files);
+    }
+
+    if (NULL != test->benchmark)
+    {
+        fprintf(out,
+                ",\"benchmark\":{\"iterations\":%llu,\"samples\":%u,"
+                "\"mean_ns\":%.3f,\"median_ns\":%.3f,\"stddev_ns\":%.3f}",
+                (unsigned long long)test->benchmark->iterations,
+                (unsigned int)test->benchmark->samples,
+                test->benchmark->mean_ns, test->benchmark->median_ns,
+                test->benchmark->stddev_ns);
+    }
+
+    if (NULL != test->heap)
+    {
+        fprintf(out,
+                ",\"heap\":{\"allocations\":%llu,\"bytes\":%llu,"
+                "\"peak_bytes\":%llu,\"leaked_blocks\":%llu,"
+                "\"leaked_bytes\":%llu}",
+                (unsigned long long)test->heap->allocations,
+                (unsigned long long)test->heap->bytes,
+                (unsigned long long)test->heap->peak_bytes,
+                (unsigned long long)test->heap->leaked_blocks,
+                (unsigned long long)test->heap->leaked_bytes);
+    }
+
+    if (NULL != test->perf)
+    {
+        const char* separator = ",\"perf\":{";
+
+        for (int counter = 0; counter < MINUNIT_PERF_COUNTERS; ++counter)
+        {
+            if (!(test->perf->counted & (1U << counter)))
+                continue;
+
+            fprintf(out, "%s\"%s\":%llu",
+                    separator, minunit_perf_counter_name(counter),
+                    (unsigned long long)test->perf->counts[counter]);
+            separator = ",";
+        }
+
+        fputc('}', out);
+    }
+
+    if (test->timing->samples > 1)
+    {
+        fprintf(out,
+                ",\"timing\":{\"samples\":%u,\"mean_ns\":%.3f,"
+                "\"stddev_ns\":%.3f}",
+                (unsigned int)test->timing->samples, test->timing->mean_ns,
+                test->timing->stddev_ns);
+    }
+
+    if (test->runs > 1)
+    {
+        fprintf(out, ",\"runs\":%u,\"failed_runs\":%u",
+                test->runs, test->failed_runs);
+
+        if (test->failed_runs > 0)
+            fprintf(out, ",\"failed_round\":%u", test->failed_round + 1);
+    }
+
+    if (test->seeded)
+    {
+        fprintf(out, ",\"seed\":%llu", (unsigned long long)test->seed);
+    }
+
+    if (test->failure_count > 0)
+    {
+        fputs(",\"failures\":[", out);
+
+        for (size_t i = 0; i < test->failure_count; ++i)
+        {
+            write_json_failure(out, &test->failures[i], i > 0);
+        }
+
+        fputc(']', out);
+    }
+
+    if (test->output_size > 0)
+    {
+        fputs(",\"output\":", out);
+        write_json_string(out, test->output, test->output_size);
+    }
+
+    fputs("}\n", out);
+}
+
+static void jsonl_run_end(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    FILE* out = static_cast<jsonl_reporter_t*>(reporter)->out;
+
+    fprintf(out,
+            "{\"event\":\"run_end\",\"tests\":%u,\"failures\":%u,"
+            "\"rounds\":%u,\"timing_changes\":[",
+            run->tests, run->failures, run->rounds);
+
+    for (size_t i = 0; i < run->change_count; ++i)
+    {
+        const minunit_timing_report_t* change = &run->changes[i];
+
+        fputs(i > 0 ? ",{\"test\":" : "{\"test\":", out);
+        write_json_string(out, change->name.data(), change->name.size());
+        write_json_member(
+            out, "change",
+            MINUNIT_TIMING_REGRESSED == change->change
+                ? "regressed" : "improved");
+        fprintf(out,
+                ",\"baseline_ns\":%.3f,\"mean_ns\":%.3f,\"percent\":%.3f,"
+                "\"margin\":%.3f}",
+                change->baseline_ns, change->current_ns, change->percent,
+                change->margin);
+    }
+
+    fputs("]}\n", out);
+    fflush(out);
+}
+
+static void jsonl_release(minunit_reporter_t* reporter)
+{
+    jsonl_reporter_t* jsonl = static_cast<jsonl_reporter_t*>(reporter);
+
+    if (stdout != jsonl->out)
+    {
+        fclose(jsonl->out);
+    }
+
+    delete jsonl;
+}
+
+static const minunit_reporter_vtable_t jsonl_vtable = {
+    &jsonl_run_start, &jsonl_suite_start, &jsonl_suite_end,
+    &jsonl_test_start, &jsonl_test_end, &jsonl_run_end, &jsonl_release };
+
+/**
+ * \brief Create a reporter which writes a JSON object per line for each hook.
+ *
+ * \param out           The stream to write the report to, which the reporter
+ *                      closes on release unless it is standard output.
+ *
+ * \returns the reporter.
+ */
+minunit_reporter_t* minunit_jsonl_reporter_create(FILE* out)
+{
+    jsonl_reporter_t* jsonl = new jsonl_reporter_t;
+    jsonl->vtable = &jsonl_vtable;
+    jsonl->out = out;
+
+    return jsonl;
+}
@@ -0,0 +1,328 @@
+/**
+ * \file src/minunit_reporter_junit.cpp
+ *
+ * \brief Reporter which writes a JUnit XML report.
+ *
+ * Each suite becomes a testsuite element, and each test a testcase element,
+ * written as soon as the test is reported.  Since the report is streamed, the
+ * testsuite elements do not carry counts of their tests or failures, which
+ * JUnit consumers compute from the testcase elements.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "minunit_reporter.h"
+
+using namespace std;
+
+/**
+ * \brief The JUnit reporter.
+ */
+typedef struct junit_reporter : minunit_reporter_t
+{
+    FILE* out;
+    bool suite_open;
+} junit_reporter_t;
+
+/**
+ * \brief Write a string as XML character data, escaping markup.
+ *
+ * Control characters are not allowed in XML, so they are replaced.
+ *
+ * \param out           The stream to write to.
+ * \param value         The string to write.
+ */
+static void write_xml_text(FILE* out, const char* value)
+{
+    for (const char* i = value; '\0' != *i; ++i)
+    {
+        switch (*i)
+        {
+            case '&':
+                fputs("&amp;", out);
+                break;
+
+            case '<':
+                fputs("&lt;", out);
+                break;
+
+            case '>':
+                fputs("&gt;", out);
+                break;
+
+            case '"':
+                fputs("&quot;", out);
+                break;
+
+            default:
+                if ((unsigned char)*i < 0x20 && '\t' != *i && '\n' != *i)
+                    fputc('?', out);
+                else
+                    fputc(*i, out);
+                break;
+        }
+    }
+}
+
+/**
+ * \brief Write captured output as a CDATA section.
+ *
+ * A "]]>" in the output would end the section, so the section is split around
+ * it.
+ *
+ * \param out           The stream to write to.
+ * \param data          The output to write.
+ * \param size          The size of the output.
+ */
+static void write_xml_cdata(FILE* out, const char* data, size_t size)
+{
+    fputs("<![CDATA[", out);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        unsigned char ch = (unsigned char)data[i];
+
+        if (']' == ch && i + 2 < size && ']' == data[i + 1]
+         && '>' == data[i + 2])
+        {
+            fputs("]]]]><![CDATA[>", out);
+            i += 2;
+        }
+        else if (ch < 0x20 && '\t' != ch && '\n' != ch && '\r' != ch)
+        {
+            fputc('?', out);
+        }
+        else
+        {
+            fputc(ch, out);
+        }
+    }
+
+    fputs("]]>", out);
+}
+
+/**
+ * \brief Open a testsuite element.
+ *
+ * \param junit         The JUnit reporter.
+ * \param suite         The name of the suite.
+ */
+static void open_suite(junit_reporter_t* junit, const char* suite)
+{
+    fputs("  <testsuite name=\"", junit->out);
+    write_xml_text(junit->out, suite);
+    fputs("\">\n", junit->out);
+
+    junit->suite_open = true;
+}
+
+static void junit_run_start(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    junit_reporter_t* junit = static_cast<junit_reporter_t*>(reporter);
+
+    (void)run;
+
+    fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n", junit->out);
+    fputs("<testsuites>\n", junit->out);
+}
+
+static void junit_suite_end(minunit_reporter_t* reporter, const char* suite)
+{
+    junit_reporter_t* junit = static_cast<junit_reporter_t*>(reporter);
+
+    (void)suite;
+
+    fputs("  </testsuite>\n", junit->out);
+    junit->suite_open = false;
+}
+
+static void junit_suite_start(minunit_reporter_t* reporter, const char* suite)
+{
+    junit_reporter_t* junit = static_cast<junit_reporter_t*>(reporter);
+
+    /* close the testsuite opened for tests declared before any suite. */
+    if (junit->suite_open)
+    {
+        junit_suite_end(junit, "");
+    }
+
+    open_suite(junit, suite);
+}
+
+static void junit_test_start(
+    minunit_reporter_t* reporter, const char* suite, const char* name)
+{
+    (void)reporter;
+    (void)suite;
+    (void)name;
+}
+
+/**
+ * \brief Write the failure element of a failed test, with the first failed
+ * assertion as its message and all of them as its text.
+ *
+ * \param out           The stream to write to.
+ * \param test          The report of the test.
+ */
+static void write_failure(FILE* out, const minunit_test_report_t* test)
+{
+    if (0 == test->failure_count)
+    {
+        fputs("      <failure type=\"FAIL\" message=\"test failed\"/>\n", out);
+        return;
+    }
+
+    const minunit_failure_t* first = &test->failures[0];
+    string message = minunit_failure_describe(first);
+
+    fputs("      <failure type=\"FAIL\" message=\"", out);
+    write_xml_text(out, message.substr(0, message.find('\n')).c_str());
+    fputs("\">", out);
+
+    string text;
+    for (size_t i = 0; i < test->failure_count; ++i)
+    {
+        text += minunit_failure_describe(&test->failures[i]);
+    }
+
+    write_xml_text(out, text.c_str());
+    fputs("</failure>\n", out);
+}
+
+static void junit_test_end(
+    minunit_reporter_t* reporter, const minunit_test_report_t* test)
+{
+    junit_reporter_t* junit = static_cast<junit_reporter_t*>(reporter);
+    FILE* out = junit->out;
+
+    /* tests declared before any suite still need a testsuite element. */
+    if (!junit->suite_open)
+    {
+        open_suite(junit, test->suite);
+    }
+
+    fputs("    <testcase classname=\"", out);
+    write_xml_text(out, test->suite);
+    fputs("\" name=\"", out);
+    write_xml_text(out, test->name);
+    fprintf(out, "\" time=\"%.6f\"", test->usage->wall_ns / 1e9);
+
+    if (MINUNIT_TEST_OUTCOME_PASS == test->outcome && 0 == test->output_size)
+    {
+        fputs("/>\n", out);
+        return;
+    }
+
+    fputs(">\n", out);
+
+    switch (test->outcome)
+    {
+        case MINUNIT_TEST_OUTCOME_FAIL:
+            write_failure(out, test);
+            break;
+
+        case MINUNIT_TEST_OUTCOME_CRASH:
+            fputs("      <error type=\"CRASH\" message=\"", out);
+            write_xml_text(
+                out, minunit_crash_description(test->status).c_str());
+            fputs("\"/>\n", out);
+            break;
+
+        case MINUNIT_TEST_OUTCOME_TIMEOUT:
+            fprintf(out,
+                    "      <error type=\"TIMEOUT\" "
+                    "message=\"timed out after %.3f s\"/>\n",
+                    test->usage->wall_ns / 1e9);
+            break;
+
+        case MINUNIT_TEST_OUTCOME_OOM:
+            fprintf(out,
+                    "      <error type=\"OOM\" "
+                    "message=\"out of memory after %.3f s\"/>\n",
+                    test->usage->wall_ns / 1e9);
+            break;
+
+        case MINUNIT_TEST_OUTCOME_CPU_LIMIT:
+            fprintf(out,
+                    "      <error type=\"CPU-LIMIT\" "
+                    "message=\"CPU time limit exceeded after %.3f s\"/>\n",
+                    test->usage->wall_ns / 1e9);
+            break;
+
+        case MINUNIT_TEST_OUTCOME_FD_LEAK:
+            fprintf(out,
+                    "      <failure type=\"FD-LEAK\" "
+                    "message=\"left %llu file%s open\"/>\n",
+                    (unsigned long long)test->usage->leaked_files,
+                    1 == test->usage->leaked_files ? "" : "s");
+            break;
+
+        default:
+            break;
+    }
+
+    if (test->output_size > 0)
+    {
+        fputs("      <system-out>", out);
+        write_xml_cdata(out, test->output, test->output_size);
+        fputs("</system-out>\n", out);
+    }
+
+    fputs("    </testcase>\n", out);
+}
+
+static void junit_run_end(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    junit_reporter_t* junit = static_cast<junit_reporter_t*>(reporter);
+
+    (void)run;
+
+    if (junit->suite_open)
+    {
+        junit_suite_end(junit, "");
+    }
+
+    fputs("</testsuites>\n", junit->out);
+    fflush(junit->out);
+}
+
+static void junit_release(minunit_reporter_t* reporter)
+{
+    junit_reporter_t* junit = static_cast<junit_reporter_t*>(reporter);
+
+    if (stdout != junit->out)
+    {
+        fclose(junit->out);
+    }
+
+    delete junit;
+}
+
+static const minunit_reporter_vtable_t junit_vtable = {
+    &junit_run_start, &junit_suite_start, &junit_suite_end,
+    &junit_test_start, &junit_test_end, &junit_run_end, &junit_release };
+
+/**
+ * \brief Create a reporter which writes a JUnit XML report.
+ *
+ * \param out           The stream to write the report to, which the reporter
+ *                      closes on release unless it is standard output.
+ *
+ * \returns the reporter.
+ */
+minunit_reporter_t* minunit_junit_reporter_create(FILE* out)
+{
+    junit_reporter_t* junit = new junit_reporter_t;
+    junit->vtable = &junit_vtable;
+    junit->out = out;
+    junit->suite_open = false;
+
+    return junit;
+}
@@ -0,0 +1,773 @@
+/**
+ * \file src/minunit_reporter_terminal.cpp
+ *
+ * \brief Reporter which prints a human-readable report to standard output.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "minunit_reporter.h"
+#include "minunit_timings.h"
+
+using namespace std;
+
+/**
+ * \brief A test listed in the summary, with the wall time or outcome used to
+ * list it.
+ */
+typedef pair<uint64_t, string> summary_test_t;
+
+/**
+ * \brief The terminal reporter.
+ */
+typedef struct terminal_reporter : minunit_reporter_t
+{
+    const minunit_test_options_t* options;
+    vector<summary_test_t> failures;
+    vector<summary_test_t> slowest;
+} terminal_reporter_t;
+
+/**
+ * \brief Get the name of a test, qualified by its suite.
+ *
+ * \param suite         The suite of the test.
+ * \param name          The name of the test.
+ *
+ * \returns the qualified name.
+ */
+static string qualified_name(const char* suite, const char* name)
+{
+    return string(suite) + (strcmp(suite, "") ? "::" : "") + name;
+}
+
+/**
+ * \brief Format a duration for display.
+ *
+ * \param ns            The duration in nanoseconds.
+ *
+ * \returns the formatted duration.
+ */
+static string format_duration(uint64_t ns)
+{
+    char buffer[32];
+
+    if (ns < 1000ULL)
+        snprintf(buffer, sizeof(buffer), "%u ns", (unsigned int)ns);
+    else if (ns < 1000000ULL)
+        snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1000.0);
+    else if (ns < 1000000000ULL)
+        snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1000000.0);
+    else
+        snprintf(buffer, sizeof(buffer), "%.2f s", ns / 1000000000.0);
+
+    return buffer;
+}
+
+/**
+ * \brief Format a size in bytes for display.
+ *
+ * \param bytes         The size in bytes.
+ *
+ * \returns the formatted size.
+ */
+static string format_bytes(uint64_t bytes)
+{
+    char buffer[32];
+
+    if (bytes < 1024ULL)
+        snprintf(buffer, sizeof(buffer), "%u B", (unsigned int)bytes);
+    else if (bytes < 1024ULL * 1024ULL)
+        snprintf(buffer, sizeof(buffer), "%.1f KiB", bytes / 1024.0);
+    else
+        snprintf(
+            buffer, sizeof(buffer), "%.1f MiB", bytes / (1024.0 * 1024.0));
+
+    return buffer;
+}
+
+/**
+ * \brief Describe the heap usage of a test.
+ *
+ * \param heap          The heap usage to describe.
+ *
+ * \returns a description of the heap usage, suitable for appending to the
+ * usage detail.
+ */
+static string heap_detail(const test_heap_t* heap)
+{
+    char allocations[32];
+    snprintf(
+        allocations, sizeof(allocations), "%llu alloc%s",
+        (unsigned long long)heap->allocations,
+        1 == heap->allocations ? "" : "s");
+
+    string detail =
+        string(", heap ") + allocations + " / " + format_bytes(heap->bytes)
+      + ", peak heap " + format_bytes(heap->peak_bytes);
+
+    if (heap->leaked_blocks > 0)
+    {
+        char blocks[32];
+        snprintf(
+            blocks, sizeof(blocks), " in %llu block%s",
+            (unsigned long long)heap->leaked_blocks,
+            1 == heap->leaked_blocks ? "" : "s");
+
+        detail += ", leaked " + format_bytes(heap->leaked_bytes) + blocks;
+    }
+
+    return detail;
+}
+
+/**
+ * \brief Describe the time and resource usage of a test.
+ *
+ * \param usage         The usage to describe.
+ * \param heap          The heap usage to describe, or NULL if the heap usage
+ *                      was not measured.
+ *
+ * \returns a description of the usage, suitable for appending to a status
+ * line.
+ */
+static string usage_detail(const test_usage_t* usage, const test_heap_t* heap)
+{
+    string detail = " (" + format_duration(usage->wall_ns);
+
+#ifdef HAS_GETRUSAGE
+    char rss[32];
+    snprintf(rss, sizeof(rss), "%.1f MiB", usage->rss_growth_kb / 1024.0);
+
+    detail += ", user " + format_duration(usage->user_ns);
+    detail += ", sys " + format_duration(usage->system_ns);
+    detail += ", RSS growth ";
+    detail += rss;
+#endif
+
+    if (NULL != heap)
+        detail += heap_detail(heap);
+
+    return detail + ")";
+}
+
+/**
+ * \brief Format a quantity for display, with an SI prefix.
+ *
+ * \param value         The quantity.
+ * \param unit          The unit of the quantity.
+ *
+ * \returns the formatted quantity.
+ */
+static string format_si(double value, const char* unit)
+{
+    static const char* prefixes[] = { "", "k", "M", "G", "T" };
+    char buffer[64];
+    size_t prefix = 0;
+
+    while (value >= 1000.0 && prefix + 1 < sizeof(prefixes) / sizeof(char*))
+    {
+        value /= 1000.0;
+        ++prefix;
+    }
+
+    snprintf(
+        buffer, sizeof(buffer), "%.2f %s%s", value, prefixes[prefix], unit);
+
+    return buffer;
+}
+
+/**
+ * \brief Format a rate for display, with an SI prefix.
+ *
+ * \param rate          The rate per second.
+ *
+ * \returns the formatted rate.
+ */
+static string format_rate(double rate)
+{
+    return format_si(rate, "ops/s");
+}
+
+/**
+ * \brief Format a count of events for display, with an SI prefix if it is
+ * large.
+ *
+ * \param count         The number of events.
+ * \param event         The name of the events.
+ *
+ * \returns the formatted count.
+ */
+static string format_count(uint64_t count, const char* event)
+{
+    char buffer[64];
+
+    if (count >= 1000ULL)
+        return format_si((double)count, "") + " " + event;
+
+    snprintf(buffer, sizeof(buffer), "%u %s", (unsigned int)count, event);
+
+    return buffer;
+}
+
+/**
+ * \brief Describe the performance counts of a test.
+ *
+ * \param perf          The performance counts to describe.
+ *
+ * \returns a description of the counters that were counted.
+ */
+static string perf_detail(const test_perf_t* perf)
+{
+    static const char* events[MINUNIT_PERF_COUNTERS] = {
+        "cycles", "instructions", "branch misses", "L1d misses",
+        "LLC misses", "page faults", "context switches" };
+    const uint32_t ipc =
+        (1U << MINUNIT_PERF_CYCLES) | (1U << MINUNIT_PERF_INSTRUCTIONS);
+    string detail;
+
+    for (int counter = 0; counter < MINUNIT_PERF_COUNTERS; ++counter)
+    {
+        if (!(perf->counted & (1U << counter)))
+            continue;
+
+        if ("" != detail)
+            detail += ", ";
+
+        detail += format_count(perf->counts[counter], events[counter]);
+
+        /* instructions per cycle follow the instructions. */
+        if (MINUNIT_PERF_INSTRUCTIONS == counter
+         && ipc == (perf->counted & ipc)
+         && perf->counts[MINUNIT_PERF_CYCLES] > 0)
+        {
+            char buffer[32];
+            snprintf(
+                buffer, sizeof(buffer), " (%.2f IPC)",
+                (double)perf->counts[MINUNIT_PERF_INSTRUCTIONS]
+                    / perf->counts[MINUNIT_PERF_CYCLES]);
+            detail += buffer;
+        }
+    }
+
+    return detail;
+}
+
+/**
+ * \brief Format a time per operation for display.
+ *
+ * \param ns            The time per operation in nanoseconds.
+ *
+ * \returns the formatted time per operation.
+ */
+static string format_per_op(double ns)
+{
+    char buffer[32];
+
+    if (ns < 1000.0)
+    {
+        snprintf(buffer, sizeof(buffer), "%.2f ns/op", ns);
+        return buffer;
+    }
+
+    return format_duration((uint64_t)ns) + "/op";
+}
+
+/**
+ * \brief Describe the statistics measured for a benchmark test.
+ *
+ * \param benchmark     The statistics to describe.
+ *
+ * \returns a description of the statistics, suitable for appending to a
+ * status line.
+ */
+static string benchmark_detail(const test_benchmark_t* benchmark)
+{
+    char samples[64];
+    snprintf(
+        samples, sizeof(samples), "%u x %llu iterations",
+        (unsigned int)benchmark->samples,
+        (unsigned long long)benchmark->iterations);
+
+    return
+        " (mean " + format_per_op(benchmark->mean_ns)
+      + ", median " + format_per_op(benchmark->median_ns)
+      + ", stddev " + format_per_op(benchmark->stddev_ns)
+      + ", " + format_rate(
+            benchmark->mean_ns > 0.0 ? 1e9 / benchmark->mean_ns : 0.0)
+      + ", " + samples + ")";
+}
+
+/**
+ * \brief Describe the result of a completed test.
+ *
+ * \param test          The result of the test.
+ *
+ * \returns a description of the outcome, suitable for appending to a status
+ * line.
+ */
+static string result_detail(const minunit_test_report_t* test)
+{
+    switch (test->outcome)
+    {
+        case MINUNIT_TEST_OUTCOME_TIMEOUT:
+            return " (after " + format_duration(test->usage->wall_ns) + ")";
+
+        case MINUNIT_TEST_OUTCOME_OOM:
+            return
+                " (out of memory, after "
+              + format_duration(test->usage->wall_ns) + ")";
+
+        case MINUNIT_TEST_OUTCOME_CPU_LIMIT:
+            return
+                " (CPU time limit exceeded, after "
+              + format_duration(test->usage->wall_ns) + ")";
+
+        case MINUNIT_TEST_OUTCOME_FD_LEAK:
+            return
+                " (left " + to_string(test->usage->leaked_files) + " file"
+              + (1 == test->usage->leaked_files ? "" : "s") + " open)";
+
+        case MINUNIT_TEST_OUTCOME_CRASH:
+        {
+            string description = minunit_crash_description(test->status);
+            if ("" == description)
+                return "";
+
+            return
+                " (" + description + ", after "
+              + format_duration(test->usage->wall_ns) + ")";
+        }
+
+        default:
+            if (NULL != test->benchmark)
+                return benchmark_detail(test->benchmark);
+
+            return usage_detail(test->usage, test->heap);
+    }
+}
+
+/**
+ * \brief Describe the runs of a test repeated over several rounds.
+ *
+ * \param test          The result of the test.
+ *
+ * \returns a description of how often the test failed, and of how to
+ * reproduce its first failure.
+ */
+static string repeat_detail(const minunit_test_report_t* test)
+{
+    char buffer[128];
+
+    if (0 == test->failed_runs)
+    {
+        snprintf(
+            buffer, sizeof(buffer), "passed %u of %u runs", test->runs,
+            test->runs);
+
+        return buffer;
+    }
+
+    snprintf(
+        buffer, sizeof(buffer),
+        "failed %u of %u runs (%.2f%%), first in round %u", test->failed_runs,
+        test->runs, 100.0 * test->failed_runs / test->runs,
+        test->failed_round + 1);
+
+    string detail = buffer;
+
+    if (test->seeded)
+    {
+        snprintf(
+            buffer, sizeof(buffer), ", reproduce with --shuffle=%llu",
+            (unsigned long long)test->seed);
+        detail += buffer;
+    }
+
+    return detail;
+}
+
+/**
+ * \brief Get the status tag printed for an outcome.
+ *
+ * \param outcome       The outcome of a test.
+ *
+ * \returns the status tag.
+ */
+static const char* outcome_tag(int outcome)
+{
+    switch (outcome)
+    {
+        case MINUNIT_TEST_OUTCOME_PASS:
+            return "       OK ";
+
+        case MINUNIT_TEST_OUTCOME_CRASH:
+            return "  CRASH   ";
+
+        case MINUNIT_TEST_OUTCOME_TIMEOUT:
+            return " TIMEOUT  ";
+
+        case MINUNIT_TEST_OUTCOME_OOM:
+            return "   OOM    ";
+
+        case MINUNIT_TEST_OUTCOME_CPU_LIMIT:
+            return "CPU-LIMIT ";
+
+        case MINUNIT_TEST_OUTCOME_FD_LEAK:
+            return " FD-LEAK  ";
+
+        default:
+            return "   FAIL   ";
+    }
+}
+
+/**
+ * \brief Print a status line for a test.
+ *
+ * \param terminal      The terminal reporter.
+ * \param color         The color of the status tag.
+ * \param status        The status tag to print.
+ * \param name          The qualified name of the test.
+ * \param detail        Detail to append to the line, or an empty string.
+ */
+static void print_test_line(
+    terminal_reporter_t* terminal, int color, const char* status,
+    const string& name, const string& detail)
+{
+    terminal->options->terminal_set_color(color);
+    printf("[%s]",
+           status);
+    terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    printf(" Test %s%s\n",
+           name.c_str(), detail.c_str());
+}
+
+static void terminal_run_start(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    terminal_reporter_t* terminal = static_cast<terminal_reporter_t*>(reporter);
+
+    terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    if (run->shard_count > 1)
+    {
+        printf("[%s] Running shard %u/%u.\n",
+               "==========", run->shard_index, run->shard_count);
+    }
+
+    if (run->display_stats)
+    {
+        printf("[%s] Executing %u suite%s with %s%u test%s.\n",
+               "==========",
+               run->suites, run->suites == 0 || run->suites > 1 ? "s" : "",
+               run->tests == 0 || run->tests > 1 ? "a total " : "",
+               run->tests, run->tests == 0 || run->tests > 1 ? "s" : "");
+    }
+
+    if (run->unaffected > 0)
+    {
+        printf("[%s] Skipping %u test%s unaffected by the change.\n",
+               "==========", run->unaffected, run->unaffected > 1 ? "s" : "");
+    }
+
+    if (run->shuffled)
+    {
+        printf("[%s] Shuffling tests with seed %llu.\n",
+               "==========", (unsigned long long)run->seed);
+    }
+
+    if (0 == run->rounds)
+    {
+        printf("[%s] Repeating tests until one fails.\n", "==========");
+    }
+    else if (run->rounds > 1)
+    {
+        printf("[%s] Repeating tests %u times%s.\n",
+               "==========", run->rounds,
+               run->until_fail ? ", or until one fails" : "");
+    }
+}
+
+static void terminal_suite_start(
+    minunit_reporter_t* reporter, const char* suite)
+{
+    terminal_reporter_t* terminal = static_cast<terminal_reporter_t*>(reporter);
+
+    terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    printf("[%s]\n",
+           "----------");
+    printf("[%s] %s\n",
+           " SUITE    ", suite);
+}
+
+static void terminal_suite_end(minunit_reporter_t* reporter, const char* suite)
+{
+    terminal_reporter_t* terminal = static_cast<terminal_reporter_t*>(reporter);
+
+    (void)suite;
+
+    terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    printf("[%s]\n",
+           "----------");
+    printf("\n");
+}
+
+static void terminal_test_start(
+    minunit_reporter_t* reporter, const char* suite, const char* name)
+{
+    print_test_line(
+        static_cast<terminal_reporter_t*>(reporter),
+        MINUNIT_TERMINAL_COLOR_GREEN, " RUN      ",
+        qualified_name(suite, name), "");
+}
+
+static void terminal_test_end(
+    minunit_reporter_t* reporter, const minunit_test_report_t* test)
+{
+    terminal_reporter_t* terminal = static_cast<terminal_reporter_t*>(reporter);
+    string name = qualified_name(test->suite, test->name);
+
+    if (test->output_size > 0)
+    {
+        fwrite(test->output, 1, test->output_size, stdout);
+
+        if ('\n' != test->output[test->output_size - 1])
+            fputc('\n', stdout);
+    }
+
+    for (size_t i = 0; i < test->failure_count; ++i)
+    {
+        minunit_failure_print(terminal->options, &test->failures[i]);
+    }
+
+    print_test_line(
+        terminal,
+        MINUNIT_TEST_OUTCOME_PASS == test->outcome
+            ? MINUNIT_TERMINAL_COLOR_GREEN : MINUNIT_TERMINAL_COLOR_RED,
+        outcome_tag(test->outcome), name, result_detail(test));
+
+    if (NULL != test->perf)
+    {
+        printf("[%s] %s\n",
+               " COUNTERS ", perf_detail(test->perf).c_str());
+    }
+
+    if (test->runs > 1)
+    {
+        print_test_line(
+            terminal,
+            0 == test->failed_runs
+                ? MINUNIT_TERMINAL_COLOR_GREEN : MINUNIT_TERMINAL_COLOR_RED,
+            " REPEATED ", name, " (" + repeat_detail(test) + ")");
+    }
+
+    if (MINUNIT_TEST_OUTCOME_PASS != test->outcome)
+    {
+        terminal->failures.push_back(
+            summary_test_t(
+                (uint64_t)test->outcome,
+                test->runs > 1
+                    ? name + " (" + repeat_detail(test) + ")" : name));
+    }
+
+    /* keep a min-heap of the slowest tests seen so far. */
+    size_t count = terminal->options->slowest;
+    if (0 == count)
+    {
+        return;
+    }
+
+    auto slower = greater<summary_test_t>();
+    summary_test_t entry(test->usage->wall_ns, name);
+
+    if (terminal->slowest.size() < count)
+    {
+        terminal->slowest.push_back(entry);
+        push_heap(terminal->slowest.begin(), terminal->slowest.end(), slower);
+    }
+    else if (entry.first > terminal->slowest.front().first)
+    {
+        pop_heap(terminal->slowest.begin(), terminal->slowest.end(), slower);
+        terminal->slowest.back() = entry;
+        push_heap(terminal->slowest.begin(), terminal->slowest.end(), slower);
+    }
+}
+
+/**
+ * \brief Format a timing for display.
+ *
+ * \param change        The timing change.
+ * \param ns            The time in nanoseconds.
+ *
+ * \returns the time per operation for a benchmark test, or the duration for
+ * any other test.
+ */
+static string format_timing(const minunit_timing_report_t* change, double ns)
+{
+    if (change->benchmark)
+        return format_per_op(ns);
+
+    return format_duration((uint64_t)ns);
+}
+
+/**
+ * \brief Print the tests which regressed or improved against the baseline.
+ *
+ * \param terminal      The terminal reporter.
+ * \param run           The summary of the run.
+ */
+static void print_timing_changes(
+    terminal_reporter_t* terminal, const minunit_run_report_t* run)
+{
+    if (0 == run->change_count)
+    {
+        return;
+    }
+
+    terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    printf("[%s] Timing changes against baseline %s:\n",
+           "----------", run->baseline);
+
+    for (size_t i = 0; i < run->change_count; ++i)
+    {
+        const minunit_timing_report_t* change = &run->changes[i];
+        bool regressed = MINUNIT_TIMING_REGRESSED == change->change;
+
+        terminal->options->terminal_set_color(
+            regressed
+                ? MINUNIT_TERMINAL_COLOR_RED : MINUNIT_TERMINAL_COLOR_GREEN);
+        printf("[%s]",
+               regressed ? " REGRESSED" : " IMPROVED ");
+        terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+        printf(" %s (%s -> %s, %+.1f%% +/- %.1f%%)\n",
+               change->name.c_str(),
+               format_timing(change, change->baseline_ns).c_str(),
+               format_timing(change, change->current_ns).c_str(),
+               change->percent, change->margin);
+    }
+}
+
+/**
+ * \brief Print the slowest tests by wall time.
+ *
+ * \param terminal      The terminal reporter.
+ */
+static void print_slowest_tests(terminal_reporter_t* terminal)
+{
+    vector<summary_test_t>& slowest = terminal->slowest;
+    size_t count = slowest.size();
+
+    if (0 == count)
+    {
+        return;
+    }
+
+    sort_heap(slowest.begin(), slowest.end(), greater<summary_test_t>());
+
+    terminal->options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+    printf("[%s] Slowest %zu test%s:\n",
+           "----------", count, count > 1 ? "s" : "");
+
+    for (const summary_test_t& test : slowest)
+    {
+        printf("[%10s] %s\n",
+               format_duration(test.first).c_str(), test.second.c_str());
+    }
+}
+
+static void terminal_run_end(
+    minunit_reporter_t* reporter, const minunit_run_report_t* run)
+{
+    terminal_reporter_t* terminal = static_cast<terminal_reporter_t*>(reporter);
+    const minunit_test_options_t* options = terminal->options;
+
+    if (run->rounds > 1 || run->until_fail)
+    {
+        options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+        printf("[%s] Ran %u round%s.\n",
+               "==========", run->rounds, 1 == run->rounds ? "" : "s");
+    }
+
+    if (run->failures > 0)
+    {
+        options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+        printf("[%s] Test Summary \n", "==========");
+
+        options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+        printf("[%s] Encountered %u failure%s:\n",
+               "----------", run->failures, run->failures > 1 ? "s" : "");
+
+        for (const summary_test_t& test : terminal->failures)
+        {
+            options->terminal_set_color(MINUNIT_TERMINAL_COLOR_RED);
+            printf("[%s]",
+                   outcome_tag((int)test.first));
+            options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+            printf(" %s\n",
+                   test.second.c_str());
+        }
+
+        print_timing_changes(terminal, run);
+        print_slowest_tests(terminal);
+    }
+    else
+    {
+        if (run->display_stats || run->change_count > 0)
+        {
+            options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+            printf("[%s] Test Summary \n", "==========");
+        }
+
+        if (run->display_stats)
+        {
+            options->terminal_set_color(MINUNIT_TERMINAL_COLOR_GREEN);
+            printf("[%s] All tests passed (%u / %u).\n",
+                   "       OK ", run->tests, run->tests);
+            options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
+        }
+
+        print_timing_changes(terminal, run);
+
+        if (run->display_stats)
+        {
+            print_slowest_tests(terminal);
+        }
+    }
+
+    fflush(stdout);
+}
+
+static void terminal_release(minunit_reporter_t* reporter)
+{
+    delete static_cast<terminal_reporter_t*>(reporter);
+}
+
+static const minunit_reporter_vtable_t terminal_vtable = {
+    &terminal_run_start, &terminal_suite_start, &terminal_suite_end,
+    &terminal_test_start, &terminal_test_end, &terminal_run_end,
+    &terminal_release };
+
+/**
+ * \brief Create a reporter which prints a human-readable report to standard
+ * output.
+ *
+ * \param options       The test options.
+ *
+ * \returns the reporter.
+ */
+minunit_reporter_t* minunit_terminal_reporter_create(
+    const minunit_test_options_t* options)
+{
+    terminal_reporter_t* terminal = new terminal_reporter_t;
+    terminal->vtable = &terminal_vtable;
+    terminal->options = options;
+
+    return terminal;
+}
@@ -0,0 +1,297 @@
+/**
+ * \file src/minunit_ring.cpp
+ *
+ * \brief Shared memory ring carrying messages from a forked test runner to
+ * the parent.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+#ifdef SHARED_MEMORY_TRANSPORT
+# include <sys/mman.h>
+#endif
+
+#include "minunit_ring.h"
+
+using namespace std;
+
+#ifdef SHARED_MEMORY_TRANSPORT
+
+/**
+ * \brief A slot in the ring.
+ */
+typedef struct minunit_ring_slot
+{
+    uint32_t length;
+    uint8_t data[MINUNIT_RING_SLOT_SIZE - sizeof(uint32_t)];
+} minunit_ring_slot_t;
+
+/**
+ * \brief The ring, laid out so that the producer and consumer indices do not
+ * share a cache line.
+ */
+struct minunit_ring
+{
+    /* next slot to be written by the producer. */
+    alignas(64) atomic<uint64_t> head;
+
+    /* next slot to be read by the consumer. */
+    alignas(64) atomic<uint64_t> tail;
+
+    /* set while a side is blocked waiting for the other. */
+    alignas(64) atomic<uint32_t> consumer_waiting;
+    atomic<uint32_t> producer_waiting;
+
+    alignas(64) minunit_ring_slot_t slots[MINUNIT_RING_SLOTS];
+};
+
+/**
+ * \brief Create a ring in anonymous shared memory, which is shared with any
+ * process forked afterward.
+ *
+ * \returns the ring, or NULL on failure.
+ */
+minunit_ring_t* minunit_ring_create()
+{
+    void* mem =
+        mmap(NULL, sizeof(minunit_ring_t), PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == mem)
+    {
+        return NULL;
+    }
+
+    minunit_ring_t* ring = new (mem) minunit_ring_t;
+    ring->head.store(0);
+    ring->tail.store(0);
+    ring->consumer_waiting.store(0);
+    ring->producer_waiting.store(0);
+
+    return ring;
+}
+
+/**
+ * \brief Release a ring.
+ *
+ * \param ring          The ring to release.
+ */
+void minunit_ring_release(minunit_ring_t* ring)
+{
+    if (NULL != ring)
+    {
+        ring->~minunit_ring_t();
+        munmap(ring, sizeof(minunit_ring_t));
+    }
+}
+
+/**
+ * \brief Write data to the ring, as the producer.
+ *
+ * Each slot is published as soon as it is filled, so that a frame split
+ * across slots is never visible in part to the consumer out of order.
+ *
+ * \param ring          The ring to write.
+ * \param data          The data to write.
+ * \param size          The size of the data.
+ *
+ * \returns the number of bytes written, which is less than the size if the
+ * ring is full.
+ */
+size_t minunit_ring_write(
+    minunit_ring_t* ring, const uint8_t* data, size_t size)
+{
+    uint64_t head = ring->head.load(memory_order_relaxed);
+    uint64_t tail = ring->tail.load(memory_order_acquire);
+    size_t written = 0;
+
+    while (written < size && head - tail < MINUNIT_RING_SLOTS)
+    {
+        minunit_ring_slot_t* slot = &ring->slots[head % MINUNIT_RING_SLOTS];
+        size_t length = size - written;
+        if (length > sizeof(slot->data))
+            length = sizeof(slot->data);
+
+        memcpy(slot->data, data + written, length);
+        slot->length = (uint32_t)length;
+        written += length;
+
+        /* publishing the slot must be ordered before the waiting check. */
+        ring->head.store(++head, memory_order_seq_cst);
+    }
+
+    return written;
+}
+
+/**
+ * \brief Read all available data from the ring, as the consumer.
+ *
+ * \param ring          The ring to read.
+ * \param buffer        The buffer to append the data to.
+ *
+ * \returns true if any data was read, and false otherwise.
+ */
+bool minunit_ring_read(minunit_ring_t* ring, vector<uint8_t>* buffer)
+{
+    uint64_t tail = ring->tail.load(memory_order_relaxed);
+    uint64_t head = ring->head.load(memory_order_acquire);
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    for (; tail != head; ++tail)
+    {
+        const minunit_ring_slot_t* slot =
+            &ring->slots[tail % MINUNIT_RING_SLOTS];
+        uint32_t length = slot->length;
+
+        if (length > sizeof(slot->data))
+            length = sizeof(slot->data);
+
+        buffer->insert(buffer->end(), slot->data, slot->data + length);
+    }
+
+    /* freeing the slots must be ordered before the waiting check. */
+    ring->tail.store(tail, memory_order_seq_cst);
+
+    return true;
+}
+
+/**
+ * \brief Prepare the consumer to block until the producer wakes it.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the ring is empty, so the consumer may block, and false if
+ * there is data to read.
+ */
+bool minunit_ring_consumer_wait(minunit_ring_t* ring)
+{
+    ring->consumer_waiting.store(1, memory_order_seq_cst);
+
+    if (ring->head.load(memory_order_seq_cst)
+            != ring->tail.load(memory_order_relaxed))
+    {
+        ring->consumer_waiting.store(0, memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Prepare the producer to block until the consumer wakes it.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the ring is full, so the producer may block, and false if
+ * there is room to write.
+ */
+bool minunit_ring_producer_wait(minunit_ring_t* ring)
+{
+    ring->producer_waiting.store(1, memory_order_seq_cst);
+
+    if (ring->head.load(memory_order_relaxed)
+            - ring->tail.load(memory_order_seq_cst) < MINUNIT_RING_SLOTS)
+    {
+        ring->producer_waiting.store(0, memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Check whether the consumer is waiting, clearing its waiting flag.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the producer must wake the consumer.
+ */
+bool minunit_ring_consumer_waiting(minunit_ring_t* ring)
+{
+    return
+        0 != ring->consumer_waiting.load(memory_order_seq_cst)
+     && 0 != ring->consumer_waiting.exchange(0, memory_order_seq_cst);
+}
+
+/**
+ * \brief Check whether the producer is waiting, clearing its waiting flag.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the consumer must wake the producer.
+ */
+bool minunit_ring_producer_waiting(minunit_ring_t* ring)
+{
+    return
+        0 != ring->producer_waiting.load(memory_order_seq_cst)
+     && 0 != ring->producer_waiting.exchange(0, memory_order_seq_cst);
+}
+
+#else
+
+minunit_ring_t* minunit_ring_create()
+{
+    return NULL;
+}
+
+void minunit_ring_release(minunit_ring_t* ring)
+{
+    (void)ring;
+}
+
+size_t minunit_ring_write(
+    minunit_ring_t* ring, const uint8_t* data, size_t size)
+{
+    (void)ring;
+    (void)data;
+    (void)size;
+
+    return 0;
+}
+
+bool minunit_ring_read(minunit_ring_t* ring, vector<uint8_t>* buffer)
+{
+    (void)ring;
+    (void)buffer;
+
+    return false;
+}
+
+bool minunit_ring_consumer_wait(minunit_ring_t* ring)
+{
+    (void)ring;
+
+    return true;
+}
+
+bool minunit_ring_producer_wait(minunit_ring_t* ring)
+{
+    (void)ring;
+
+    return true;
+}
+
+bool minunit_ring_consumer_waiting(minunit_ring_t* ring)
+{
+    (void)ring;
+
+    return false;
+}
+
+bool minunit_ring_producer_waiting(minunit_ring_t* ring)
+{
+    (void)ring;
+
+    return false;
+}
+
+#endif
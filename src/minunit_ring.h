@@ -0,0 +1,120 @@
+/**
+ * \file src/minunit_ring.h
+ *
+ * \brief Shared memory ring carrying messages from a forked test runner to
+ * the parent.
+ *
+ * The ring is a single-producer, single-consumer queue of fixed-size slots in
+ * memory shared between the parent and a forked test runner.  The forked test
+ * runner writes the same frames that it would otherwise write to its socket,
+ * split across as many slots as needed, and the parent reads them back into
+ * its input buffer.  Neither side makes a system call to pass a message.
+ *
+ * When one side has to wait for the other, it raises a waiting flag and
+ * blocks on the socket.  The other side clears the flag and sends a WAKE
+ * message over the socket, so that a system call is only made when a side is
+ * actually blocked.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_RING_HEADER_GUARD
+# define MINUNIT_RING_HEADER_GUARD
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \brief Number of slots in a ring.
+ */
+#define MINUNIT_RING_SLOTS 256
+
+/**
+ * \brief Size of a single slot in a ring, including its length.
+ */
+#define MINUNIT_RING_SLOT_SIZE 512
+
+/**
+ * \brief Opaque shared memory ring.
+ */
+typedef struct minunit_ring minunit_ring_t;
+
+/**
+ * \brief Create a ring in anonymous shared memory, which is shared with any
+ * process forked afterward.
+ *
+ * \returns the ring, or NULL on failure.
+ */
+minunit_ring_t* minunit_ring_create();
+
+/**
+ * \brief Release a ring.
+ *
+ * \param ring          The ring to release.
+ */
+void minunit_ring_release(minunit_ring_t* ring);
+
+/**
+ * \brief Write data to the ring, as the producer.
+ *
+ * \param ring          The ring to write.
+ * \param data          The data to write.
+ * \param size          The size of the data.
+ *
+ * \returns the number of bytes written, which is less than the size if the
+ * ring is full.
+ */
+size_t minunit_ring_write(
+    minunit_ring_t* ring, const uint8_t* data, size_t size);
+
+/**
+ * \brief Read all available data from the ring, as the consumer.
+ *
+ * \param ring          The ring to read.
+ * \param buffer        The buffer to append the data to.
+ *
+ * \returns true if any data was read, and false otherwise.
+ */
+bool minunit_ring_read(minunit_ring_t* ring, std::vector<uint8_t>* buffer);
+
+/**
+ * \brief Prepare the consumer to block until the producer wakes it.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the ring is empty, so the consumer may block, and false if
+ * there is data to read.
+ */
+bool minunit_ring_consumer_wait(minunit_ring_t* ring);
+
+/**
+ * \brief Prepare the producer to block until the consumer wakes it.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the ring is full, so the producer may block, and false if
+ * there is room to write.
+ */
+bool minunit_ring_producer_wait(minunit_ring_t* ring);
+
+/**
+ * \brief Check whether the consumer is waiting, clearing its waiting flag.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the producer must wake the consumer.
+ */
+bool minunit_ring_consumer_waiting(minunit_ring_t* ring);
+
+/**
+ * \brief Check whether the producer is waiting, clearing its waiting flag.
+ *
+ * \param ring          The ring.
+ *
+ * \returns true if the consumer must wake the producer.
+ */
+bool minunit_ring_producer_waiting(minunit_ring_t* ring);
+
+#endif /*MINUNIT_RING_HEADER_GUARD*/
@@ -8,464 +8,3260 @@
  */
 
 #include <config.h>
+#include <errno.h>
+#include <math.h>
 #include <minunit/minunit.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <string>
+#include <vector>
+
+#ifdef HAS_GETRUSAGE
+# include <sys/resource.h>
+#endif
 
 #ifdef FORKED_TEST_RUNNER
-# include <signal.h>
+# include <poll.h>
 # include <sys/socket.h>
 # include <sys/wait.h>
 #endif
 
-using namespace std;
-
-#ifdef FORKED_TEST_RUNNER
-static bool child_process_died = false;
-static pid_t child;
-
-static void set_child_process_died(int)
-{
-    child_process_died = true;
+#include "minunit_assert.h"
+#include "minunit_benchmark.h"
+#include "minunit_coverage.h"
+#include "minunit_fuzz.h"
+#include "minunit_guard.h"
+#include "minunit_heap.h"
+#include "minunit_limits.h"
+#include "minunit_perf.h"
+#include "minunit_protocol.h"
+#include "minunit_reporter.h"
+#include "minunit_ring.h"
+#include "minunit_timings.h"
 
-    int status;
-    waitpid(child, &status, 0);
-}
-#endif
+using namespace std;
 
+#if defined(MINUNIT_SECTION_REGISTRATION)
+/*
+ * Bounds of the linker section holding pointers to every test case descriptor.
+ */
+# if defined(__APPLE__)
+extern minunit_test_case_t* minunit_test_cases_begin[]
+    __asm("section$start$__DATA$minunit_tests");
+extern minunit_test_case_t* minunit_test_cases_end[]
+    __asm("section$end$__DATA$minunit_tests");
+# else
+extern "C" minunit_test_case_t* __start_minunit_test_cases[]
+    __attribute__((weak));
+extern "C" minunit_test_case_t* __stop_minunit_test_cases[]
+    __attribute__((weak));
+#  define minunit_test_cases_begin __start_minunit_test_cases
+#  define minunit_test_cases_end __stop_minunit_test_cases
+# endif
+#else
 /**
  * \brief Global linked list of test cases and suites.
  */
 static minunit_test_case_t* minunit_test_cases = nullptr;
 
 /**
- * \brief Internal method to register a minunit test suite.
+ * \brief Internal method to register a minunit test case descriptor, for
+ * toolchains without linker section support.
  *
- * \param name          The name of this test suite.
+ * \param test_case     The statically allocated descriptor to register.
  *
  * \returns 0 on success and non-zero on failure.
  */
-int minunit_register_suite(const char* name)
+int minunit_register_test_case(minunit_test_case_t* test_case)
 {
-    /* create the test suite entry. */
-    minunit_test_case_t* newtest =
-        (minunit_test_case_t*)malloc(sizeof(minunit_test_case_t));
-    memset(newtest, 0, sizeof(minunit_test_case_t));
-
-    /* initialize the entry. */
-    newtest->next = minunit_test_cases;
-    newtest->type = MINUNIT_TEST_TYPE_SUITE;
-    newtest->name = name;
-    newtest->flags = MINUNIT_TEST_FLAG_ENABLED;
-
     /* add the entry to the linked list. */
-    minunit_test_cases = newtest;
+    test_case->next = minunit_test_cases;
+    minunit_test_cases = test_case;
 
     return 0;
 }
+#endif
 
-int minunit_register_test(minunit_test_func_t test_func, const char* name)
+/**
+ * \brief Get the array of registered test cases, in declaration order.
+ *
+ * Test cases are ordered by the file in which they were declared, and then by
+ * their order within that file, so that each suite is followed by its tests.
+ *
+ * \param begin         Set to the start of the array.
+ * \param end           Set to the end of the array.
+ */
+static void get_test_cases(
+    minunit_test_case_t*** begin, minunit_test_case_t*** end)
 {
-    /* create unit test entry. */
-    minunit_test_case_t* newtest =
-        (minunit_test_case_t*)malloc(sizeof(minunit_test_case_t));
-    memset(newtest, 0, sizeof(minunit_test_case_t));
+#if defined(MINUNIT_SECTION_REGISTRATION)
+    *begin = minunit_test_cases_begin;
+    *end = minunit_test_cases_end;
+
+    if (nullptr == *begin || nullptr == *end)
+    {
+        *begin = *end = nullptr;
+        return;
+    }
+#else
+    static vector<minunit_test_case_t*> test_cases;
 
-    /* initialize unit test entry. */
-    newtest->next = minunit_test_cases;
-    newtest->type = MINUNIT_TEST_TYPE_UNIT;
-    newtest->name = name;
-    newtest->method = test_func;
-    newtest->flags = MINUNIT_TEST_FLAG_ENABLED;
+    /* the list is built in reverse order of registration. */
+    minunit_list_reverse(&minunit_test_cases);
 
-    /* add the entry to the linked list. */
-    minunit_test_cases = newtest;
+    for (minunit_test_case_t* test = minunit_test_cases; nullptr != test;
+         test = test->next)
+    {
+        test_cases.push_back(test);
+    }
 
-    return 0;
+    *begin = test_cases.data();
+    *end = test_cases.data() + test_cases.size();
+#endif
+
+    /* the toolchain may emit descriptors in any order within a file. */
+    auto declared_before =
+        [](const minunit_test_case_t* lhs, const minunit_test_case_t* rhs) {
+            int cmp = strcmp(lhs->file, rhs->file);
+
+            return cmp < 0 || (0 == cmp && lhs->ordinal < rhs->ordinal); };
+
+    if (!is_sorted(*begin, *end, declared_before))
+    {
+        sort(*begin, *end, declared_before);
+    }
 }
 
 /**
- * \brief Setup action function.
+ * \brief Size of the buffer for the test report on standard output.
  */
-typedef void (*setup_action_func_t)(void*);
+#define TEST_REPORT_BUFFER_SIZE 65536
 
-#ifndef FORKED_TEST_RUNNER
 /**
- * No-op setup action.
+ * \brief An entry in the test plan.
+ *
+ * The test plan holds every suite and unit test selected to run, in
+ * registration order, with a separate entry for each case of a test with
+ * several cases, and for each corpus input of a fuzz test.  Results are
+ * recorded here as they arrive, so that they can be reported in registration
+ * order regardless of the order in which tests complete.  A test repeated over
+ * several rounds keeps the results of its first failed run, or of its latest
+ * run until one fails, and counts its runs and failures.
  */
-static void no_op_setup_action(void*)
+typedef struct test_plan_entry
 {
-}
-#endif
+    minunit_test_case_t* test;
+    const char* suite;
+    string name;
+    unsigned int case_index;
+    string input;
+    bool run_reported;
+    bool complete;
+    bool pass;
+    bool crashed;
+    bool timed_out;
+    int status;
+    test_usage_t usage;
+    test_benchmark_t benchmark;
+    test_timing_t timing;
+    test_heap_t heap;
+    test_perf_t perf;
+    string output;
+    vector<minunit_failure_t> failures;
+    unsigned int runs;
+    unsigned int failed_runs;
+    unsigned int failed_round;
+} test_plan_entry_t;
 
-#ifdef FORKED_TEST_RUNNER
-pid_t fork_test_runner(int parentfd, int childfd)
+/**
+ * \brief State for running the test plan in rounds, and reporting it in
+ * registration order.
+ *
+ * Each round runs every unit test in the plan once.  A test is complete once
+ * it has run in every round started, and no further round will start.
+ */
+typedef struct test_report_state
 {
-    child = fork();
+    const minunit_test_options_t* options;
+    minunit_reporter_t* reporter;
+    vector<test_plan_entry_t>* plan;
+    const vector<size_t>* order;
+    unsigned int rounds;
+    bool last_round;
+    size_t cursor;
+    const char* suite;
+    unsigned int fail_count;
+    bool captured;
+} test_report_state_t;
 
-    /* parent */
-    if (child != 0)
-    {
-        close(childfd);
-    }
-    /* child */
-    else
+/**
+ * \brief Build the test plan from the registered tests, applying the suite and
+ * test filters.
+ *
+ * A test with several cases is named for the test and the index of the case,
+ * such as "name/2", and a fuzz test is named for the test and each input in
+ * its corpus, such as "name/seed".  The test filter selects every case of a
+ * test by the name of the test, or a single case by its own name.
+ *
+ * \param options       The test options holding the filters.
+ * \param begin         The start of the registered test cases.
+ * \param end           The end of the registered test cases.
+ * \param plan          The plan to populate.
+ */
+static void build_test_plan(
+    const minunit_test_options_t* options, minunit_test_case_t** begin,
+    minunit_test_case_t** end, vector<test_plan_entry_t>* plan)
+{
+    const char* suite = "";
+    bool skip_suite = false;
+
+    plan->reserve(end - begin);
+
+    for (minunit_test_case_t** i = begin; i != end; ++i)
     {
-        close(parentfd);
-    }
+        minunit_test_case_t* test = *i;
 
-    return child;
-}
+        /* warm-up hooks are run by the test runners, not scheduled. */
+        if (MINUNIT_TEST_TYPE_WARM_UP == test->type)
+        {
+            continue;
+        }
 
-static void parent_setup_action(void* ctx)
-{
-    int* s = (int*)ctx;
+        /* is this a suite? */
+        if (MINUNIT_TEST_TYPE_SUITE == test->type)
+        {
+            /* should we skip this suite? */
+            skip_suite =
+                NULL != options->test_suite
+                    && strcmp(test->name, options->test_suite);
 
-    char ch = 0;
+            if (skip_suite)
+            {
+                continue;
+            }
 
-    if (write(*s, &ch, sizeof(ch)) < 0)
-        return;
-}
+            suite = test->name;
 
-static void child_setup_action(void* ctx)
-{
-    int* s = (int*)ctx;
+            test_plan_entry_t entry = test_plan_entry_t();
+            entry.test = test;
+            entry.suite = suite;
+            entry.name = test->name;
+            entry.pass = true;
+            plan->push_back(entry);
+            continue;
+        }
 
-    char ch;
+        /* don't run the test if this suite is to be skipped. */
+        if (skip_suite)
+        {
+            continue;
+        }
 
-    if (read(*s, &ch, sizeof(ch)) < 0)
-        return;
-}
+        unsigned int cases = max(test->cases, 1U);
+        bool whole =
+            NULL == options->test || !strcmp(test->name, options->test);
 
-static void write_test_result(void* ctx, bool result)
-{
-    int* s = (int*)ctx;
+        /* a fuzz test replays each input in its corpus. */
+        string corpus;
+        vector<string> inputs;
+        if (test->flags & MINUNIT_TEST_FLAG_FUZZ)
+        {
+            corpus = minunit_fuzz_corpus_dir(options, test);
+            minunit_fuzz_corpus_inputs(corpus, &inputs);
+            cases = max((unsigned int)inputs.size(), 1U);
+        }
+
+        for (unsigned int index = 0; index < cases; ++index)
+        {
+            string name = test->name;
+            if (!inputs.empty())
+                name += "/" + inputs[index];
+            else if (cases > 1)
+                name += "/" + to_string(index);
 
-    uint32_t val = result ? 1 : 0;
+            /* should we skip this test? */
+            if (!whole && name != options->test)
+            {
+                continue;
+            }
 
-    if (write(*s, &val, sizeof(val)) < 0)
-        return;
+            test_plan_entry_t entry = test_plan_entry_t();
+            entry.test = test;
+            entry.suite = suite;
+            entry.name = name;
+            entry.case_index = index;
+            if (!inputs.empty())
+                entry.input = corpus + "/" + inputs[index];
+            entry.pass = true;
+            plan->push_back(entry);
+        }
+    }
 }
 
-static bool read_test_result(void* ctx)
+/**
+ * \brief Get the name under which the timing of a test is saved.
+ *
+ * \param entry         The plan entry for this test.
+ *
+ * \returns the name of the test, qualified by its suite.
+ */
+static string test_timing_name(const test_plan_entry_t* entry)
 {
-    int* s = (int*)ctx;
+    return
+        string(entry->suite) + (strcmp(entry->suite, "") ? "::" : "")
+      + entry->name;
+}
 
-    uint32_t val;
-    ssize_t valsize = (ssize_t)sizeof(val);
+/**
+ * \brief Compute a stable hash of a test name.
+ *
+ * \param name          The name to hash.
+ *
+ * \returns the 64-bit FNV-1a hash of the name.
+ */
+static uint64_t test_name_hash(const string& name)
+{
+    uint64_t hash = 14695981039346656037ULL;
 
-    if (read(*s, &val, sizeof(val)) < valsize)
+    for (unsigned char ch : name)
     {
-        set_child_process_died(0);
-        return false;
+        hash ^= ch;
+        hash *= 1099511628211ULL;
     }
 
-    if (val)
-        return true;
-    else
-        return false;
+    return hash;
 }
-#endif
 
 /**
- * \brief Run the unit tests.
+ * \brief Restrict the test plan to the tests to keep, and the suites that hold
+ * them.
+ *
+ * \param plan          The test plan to restrict.
+ * \param keep          Whether to keep each test in the plan.
  */
-static int test_runner(const minunit_test_options_t* minunit_reserved_options)
+static void restrict_test_plan(
+    vector<test_plan_entry_t>* plan, const vector<bool>& keep)
 {
-    int ret = 0;
+    vector<test_plan_entry_t> restricted;
+    size_t suite = plan->size();
 
-    setup_action_func_t setup_action = nullptr;
-    void* forked_context = nullptr;
+    for (size_t index = 0; index < plan->size(); ++index)
+    {
+        const test_plan_entry_t& entry = (*plan)[index];
 
-#ifdef FORKED_TEST_RUNNER
-    int pair[2];
+        if (MINUNIT_TEST_TYPE_SUITE == entry.test->type)
+        {
+            suite = index;
+            continue;
+        }
 
-    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
-        perror("socketpair");
+        if (!keep[index])
+            continue;
 
-    pid_t child = fork_test_runner(pair[0], pair[1]);
+        if (suite < plan->size())
+        {
+            restricted.push_back((*plan)[suite]);
+            suite = plan->size();
+        }
 
-    if (child != 0)
-    {
-        setup_action = parent_setup_action;
-        forked_context = pair;
-    }
-    else
-    {
-        setup_action = child_setup_action;
-        forked_context = pair + 1;
+        restricted.push_back(entry);
     }
-#else
-    setup_action = no_op_setup_action;
-    forked_context = nullptr;
-#endif
 
-    /* first, reverse the list of registered tests. */
-    minunit_list_reverse(&minunit_test_cases);
+    plan->swap(restricted);
+}
 
-    /* count suites and tests. */
-    unsigned int suites = 0;
-    unsigned int tests = 0;
-    unsigned int fail_count = 0;
-    bool display_stats = true;
-    minunit_list_count(minunit_test_cases, &suites, &tests);
+/**
+ * \brief Restrict the test plan to the tests affected by a change.
+ *
+ * A test is affected if it covered any of the changed lines when the coverage
+ * index was saved.  A test missing from the index is always kept, since
+ * nothing is known of what it covers.  Suites left without any tests are
+ * dropped from the plan.
+ *
+ * \param plan          The test plan to restrict.
+ * \param index         The coverage index.
+ * \param changes       The changed files and lines.
+ *
+ * \returns the number of tests left out of the plan.
+ */
+static unsigned int select_affected_tests(
+    vector<test_plan_entry_t>* plan, const minunit_coverage_index_t& index,
+    const vector<minunit_change_t>& changes)
+{
+    vector<bool> keep(plan->size(), true);
+    unsigned int unaffected = 0;
 
-    if (NULL != minunit_reserved_options->test_suite)
+    for (size_t i = 0; i < plan->size(); ++i)
     {
-        display_stats = false;
-    }
+        const test_plan_entry_t* entry = &(*plan)[i];
+        if (MINUNIT_TEST_TYPE_UNIT != entry->test->type)
+            continue;
 
-    minunit_reserved_options->terminal_set_color(MINUNIT_TERMINAL_COLOR_NORMAL);
-#ifdef FORKED_TEST_RUNNER
-    if (child != 0)
-    {
-#endif
-        if (display_stats)
+        auto coverage = index.find(test_timing_name(entry));
+        if (index.end() != coverage
+         && !minunit_coverage_affected(coverage->second, changes))
         {
-            printf("[%s] Executing %u suite%s with %s%u test%s.\n",
-                   "==========",
-                   suites, suites == 0 || suites > 1 ? "s" : "",
-                   tests == 0 || tests > 1 ? "a total " : "",
-                   tests, tests == 0 || tests > 1 ? "s" : "");
+            keep[i] = false;
+            ++unaffected;
         }
-#ifdef FORKED_TEST_RUNNER
     }
-#endif
 
-    const char* suite = "";
-    const char* suite_tag = "";
-    bool skip_suite = false;
+    restrict_test_plan(plan, keep);
 
-    /* run the tests. */
-    minunit_test_case_t* test = minunit_test_cases;
-    for (; NULL != test; test = test->next)
-    {
-        /* is this a suite? */
-        if (MINUNIT_TEST_TYPE_SUITE == test->type)
-        {
-            skip_suite = false;
+    return unaffected;
+}
 
-            /* should we skip this suite? */
-            if (NULL != minunit_reserved_options->test_suite
-                && strcmp(test->name, minunit_reserved_options->test_suite))
-            {
-                skip_suite = true;
-            }
+/**
+ * \brief Restrict the test plan to the tests in this shard.
+ *
+ * Every shard computes the same partition of the plan, so the shards must be
+ * run with the same filters and the same durations.  Tests with a known
+ * duration are assigned longest first to the shard with the least total
+ * duration so far, which balances the time taken by each shard.  Any other
+ * test is assigned by a stable hash of its name.  Suites left without any
+ * tests are dropped from the plan.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan to restrict.
+ * \param durations     The durations used to balance the shards.
+ */
+static void shard_test_plan(
+    const minunit_test_options_t* options, vector<test_plan_entry_t>* plan,
+    const minunit_timings_t& durations)
+{
+    vector<unsigned int> shard(plan->size(), 0);
+    vector<pair<double, size_t>> known;
 
-            if (skip_suite)
-            {
-                continue;
-            }
+    for (size_t index = 0; index < plan->size(); ++index)
+    {
+        const test_plan_entry_t* entry = &(*plan)[index];
+        if (MINUNIT_TEST_TYPE_UNIT != entry->test->type)
+            continue;
+
+        string name = test_timing_name(entry);
+        auto i = durations.find(name);
+        if (durations.end() != i)
+            known.push_back(make_pair(i->second.mean_ns, index));
+        else
+            shard[index] = test_name_hash(name) % options->shard_count;
+    }
 
-#ifdef FORKED_TEST_RUNNER
-            if (child != 0)
-            {
-#endif
-                if (strcmp(suite,""))
-                {
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_NORMAL);
-                    printf("[%s]\n",
-                           "----------");
-                    printf("\n");
-                }
+    /* longest first, with ties broken by registration order. */
+    stable_sort(
+        known.begin(), known.end(),
+        [](const pair<double, size_t>& lhs, const pair<double, size_t>& rhs) {
+            return lhs.first > rhs.first; });
 
-                suite = test->name;
-                suite_tag = "::";
+    vector<double> load(options->shard_count, 0.0);
+    for (const auto& test : known)
+    {
+        size_t lightest =
+            min_element(load.begin(), load.end()) - load.begin();
 
-                minunit_reserved_options->terminal_set_color(
-                    MINUNIT_TERMINAL_COLOR_NORMAL);
-                printf("[%s]\n",
-                       "----------");
-                printf("[%s] %s\n",
-                       " SUITE    ", suite);
+        shard[test.second] = (unsigned int)lightest;
+        load[lightest] += test.first;
+    }
 
-#ifdef FORKED_TEST_RUNNER
-            }
-#endif
-        }
-        else
-        {
-            /* don't run the test if this suite is to be skipped. */
-            if (skip_suite)
-            {
-                continue;
-            }
+    vector<bool> keep(plan->size());
+    for (size_t index = 0; index < plan->size(); ++index)
+        keep[index] = shard[index] == options->shard_index;
 
-            /* should we skip this test? */
-            if (NULL != minunit_reserved_options->test
-                && strcmp(test->name, minunit_reserved_options->test))
-            {
-                continue;
-            }
+    restrict_test_plan(plan, keep);
+}
 
-#ifdef FORKED_TEST_RUNNER
-            if (child != 0)
-            {
-#endif
-                minunit_reserved_options->terminal_set_color(
-                    MINUNIT_TERMINAL_COLOR_GREEN);
-                printf("[%s]", 
-                       " RUN      ");
-                minunit_reserved_options->terminal_set_color(
-                    MINUNIT_TERMINAL_COLOR_NORMAL);
-                printf(" Test %s%s%s\n",
-                       suite, suite_tag, test->name);
-#ifdef FORKED_TEST_RUNNER
-            }
+#ifdef HAS_GETRUSAGE
+static uint64_t timeval_ns(const struct timeval& tv)
+{
+    return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000ULL;
+}
 #endif
 
-            minunit_test_context_t result = { true };
-
-            /* run the setup action before executing this test. */
-            setup_action(forked_context);
-
-#ifdef FORKED_TEST_RUNNER
-            if (child == 0)
-            {
+/**
+ * \brief Run a single unit test, measuring its time and resource usage.
+ *
+ * \param options       The test options.
+ * \param entry         The plan entry for this test.
+ * \param context       The test context which receives the result.
+ * \param usage         The usage measured for this test.
+ * \param benchmark     The statistics measured if this is a benchmark test.
+ * \param heap          The heap usage measured for this test.
+ * \param perf          The performance counts measured for this test.
+ */
+static void run_test_case(
+    const minunit_test_options_t* options, const test_plan_entry_t* entry,
+    minunit_test_context_t* context, test_usage_t* usage,
+    test_benchmark_t* benchmark, test_heap_t* heap, test_perf_t* perf)
+{
+#ifdef HAS_GETRUSAGE
+    struct rusage before;
+    getrusage(RUSAGE_SELF, &before);
 #endif
-                test->method(minunit_reserved_options, &result);
-#ifdef FORKED_TEST_RUNNER
 
-                write_test_result(forked_context, result.pass);
-            }
+    /* the failure record of this thread is set up on first use, which must
+     * not be counted against the test. */
+    minunit_assert_begin();
 
-            if (child != 0)
-            {
-                result.pass = read_test_result(forked_context);
+    minunit_heap_counters_t heap_start;
+    minunit_heap_begin(&heap_start);
 
-                if (child_process_died)
-                {
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_RED);
-                    printf("[%s]",
-                           "  CRASH   ");
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_NORMAL);
-                    printf(" Test %s%s%s\n",
-                           suite, suite_tag, test->name);
-
-                    return 1;
-                }
-            }
-#endif
+    /* only the test itself is counted, not the runner around it. */
+    if (options->perf_counters)
+        minunit_perf_begin();
 
-#ifdef FORKED_TEST_RUNNER
-            if (child != 0)
-            {
-#endif
-                if (!result.pass)
-                {
-                    test->failed = true;
-                    ++fail_count;
-                    ret = 1;
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_RED);
-                    printf("[%s]",
-                           "   FAIL   ");
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_NORMAL);
-                    printf(" Test %s%s%s\n",
-                           suite, suite_tag, test->name);
-                }
-                else
-                {
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_GREEN);
-                    printf("[%s]",
-                           "       OK ");
-                    minunit_reserved_options->terminal_set_color(
-                        MINUNIT_TERMINAL_COLOR_NORMAL);
-                    printf(" Test %s%s%s\n",
-                           suite, suite_tag, test->name);
-                }
-#ifdef FORKED_TEST_RUNNER
-            }
-#endif
-        }
-    }
+    auto start = chrono::steady_clock::now();
 
-#ifdef FORKED_TEST_RUNNER
-    if (child == 0)
+    memset(benchmark, 0, sizeof(*benchmark));
+    context->iterations = 1;
+    context->case_index = entry->case_index;
+    context->input = "" != entry->input ? entry->input.c_str() : NULL;
+
+    if (entry->test->flags & MINUNIT_TEST_FLAG_BENCHMARK)
     {
-        return 0;
+        minunit_benchmark_run(options, entry->test, context, benchmark);
     }
     else
     {
-        int status;
-        waitpid(child, &status, 0);
+        entry->test->method(options, context);
     }
-#endif
 
-    if (strcmp(suite,""))
-    {
-        minunit_reserved_options->terminal_set_color(
-            MINUNIT_TERMINAL_COLOR_NORMAL);
-        printf("[%s]\n",
-               "----------");
-        printf("\n");
-    }
+    auto end = chrono::steady_clock::now();
 
-    if (fail_count > 0)
-    {
-        minunit_reserved_options->terminal_set_color(
-            MINUNIT_TERMINAL_COLOR_NORMAL);
-        printf("[%s] Test Summary \n", "==========");
+    if (options->perf_counters)
+        minunit_perf_end(perf);
+    else
+        memset(perf, 0, sizeof(*perf));
+
+    minunit_heap_end(options, context, &heap_start, heap);
+
+    memset(usage, 0, sizeof(*usage));
+    usage->wall_ns =
+        chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+#ifdef HAS_GETRUSAGE
+    struct rusage after;
+    getrusage(RUSAGE_SELF, &after);
+
+    usage->user_ns = timeval_ns(after.ru_utime) - timeval_ns(before.ru_utime);
+    usage->system_ns =
+        timeval_ns(after.ru_stime) - timeval_ns(before.ru_stime);
+    /* the peak is that of the whole process, so only its growth over the
+     * test belongs to the test. */
+    uint64_t growth =
+        after.ru_maxrss > before.ru_maxrss
+            ? (uint64_t)(after.ru_maxrss - before.ru_maxrss) : 0;
+# ifdef __APPLE__
+    usage->rss_growth_kb = growth / 1024;
+# else
+    usage->rss_growth_kb = growth;
+# endif
+#endif
+}
 
-        minunit_reserved_options->terminal_set_color(
-            MINUNIT_TERMINAL_COLOR_NORMAL);
-        printf("[%s] Encountered %u failure%s:\n",
-               "----------", fail_count, fail_count > 1 ? "s" : "");
+/**
+ * \brief Run a single unit test, repeating it to sample its wall time.
+ *
+ * The usage, heap usage, performance counts, and any benchmark statistics are
+ * measured by the first run.  A benchmark test is not repeated, since its own
+ * samples make up its timing.  Any other test is run again until the
+ * requested number of repetitions is reached or a run fails.
+ *
+ * \param options       The test options.
+ * \param entry         The plan entry for this test.
+ * \param context       The test context which receives the result.
+ * \param usage         The usage measured for this test.
+ * \param benchmark     The statistics measured if this is a benchmark test.
+ * \param timing        The timing measured for this test.
+ * \param heap          The heap usage measured for this test.
+ * \param perf          The performance counts measured for this test.
+ */
+static void measure_test_case(
+    const minunit_test_options_t* options, const test_plan_entry_t* entry,
+    minunit_test_context_t* context, test_usage_t* usage,
+    test_benchmark_t* benchmark, test_timing_t* timing, test_heap_t* heap,
+    test_perf_t* perf)
+{
+    run_test_case(options, entry, context, usage, benchmark, heap, perf);
 
-        test = minunit_test_cases;
-        suite = "";
-        suite_tag = "";
+    if (benchmark->samples > 0)
+    {
+        memset(timing, 0, sizeof(*timing));
+        timing->samples = benchmark->samples;
+        timing->mean_ns = benchmark->mean_ns;
+        timing->stddev_ns = benchmark->stddev_ns;
+        return;
+    }
 
-        while (nullptr != test)
-        {
-            if (MINUNIT_TEST_TYPE_SUITE == test->type)
-            {
-                suite = test->name;
-                suite_tag = "::";
-            }
-            else if (test->failed)
-            {
-                minunit_reserved_options->terminal_set_color(
-                    MINUNIT_TERMINAL_COLOR_RED);
-                printf("[%s]",
-                       "   FAIL   ");
-                minunit_reserved_options->terminal_set_color(
-                    MINUNIT_TERMINAL_COLOR_NORMAL);
-                printf(" %s%s%s\n", suite, suite_tag, test->name);
-            }
+    vector<uint64_t> samples;
+    samples.push_back(usage->wall_ns);
 
-            minunit_test_case_t* next = test->next;
-            memset(test, 0, sizeof(minunit_test_case_t));
-            free(test);
-            test = next;
-        }
-    }
-    else
+    while (context->pass && samples.size() < options->repetitions)
     {
-        if (display_stats)
-        {
-            minunit_reserved_options->terminal_set_color(
-                MINUNIT_TERMINAL_COLOR_NORMAL);
-            printf("[%s] Test Summary \n", "==========");
+        auto start = chrono::steady_clock::now();
+        entry->test->method(options, context);
+        auto end = chrono::steady_clock::now();
 
-            minunit_reserved_options->terminal_set_color(
-                MINUNIT_TERMINAL_COLOR_GREEN);
-            printf("[%s] All tests passed (%u / %u).\n",
-                   "       OK ", tests, tests);
-            minunit_reserved_options->terminal_set_color(
-                MINUNIT_TERMINAL_COLOR_NORMAL);
-        }
+        samples.push_back(
+            chrono::duration_cast<chrono::nanoseconds>(end - start).count());
     }
 
-    return ret;
+    minunit_timing_from_samples(samples, timing);
+}
+
+/**
+ * \brief Get the next number from a splitmix64 sequence.
+ *
+ * The shuffle is computed here rather than with the standard library, whose
+ * distributions differ between implementations, so that a seed reproduces the
+ * same order wherever the tests are built.
+ *
+ * \param state         The state of the sequence, which is advanced.
+ *
+ * \returns the next number in the sequence.
+ */
+static uint64_t next_random(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+/**
+ * \brief Get the seed which shuffles a round of the test plan.
+ *
+ * The first round is shuffled with the seed given on the command line, so
+ * that passing the seed of any round back with --shuffle runs that round's
+ * order first.
+ *
+ * \param seed          The shuffle seed of the run.
+ * \param round         The zero-based round.
+ *
+ * \returns the seed of the round.
+ */
+static uint64_t test_round_seed(uint64_t seed, unsigned int round)
+{
+    if (0 == round)
+    {
+        return seed;
+    }
+
+    uint64_t state = seed ^ round;
+
+    return next_random(&state);
+}
+
+/**
+ * \brief Shuffle the order in which tests are run.
+ *
+ * \param seed          The seed of the shuffle.
+ * \param order         The plan indices of the unit tests to shuffle.
+ */
+static void shuffle_test_order(uint64_t seed, vector<size_t>* order)
+{
+    uint64_t state = seed;
+
+    for (size_t i = order->size(); i > 1; --i)
+    {
+        swap((*order)[i - 1], (*order)[next_random(&state) % i]);
+    }
+}
+
+/**
+ * \brief Close the currently open suite in the report, if any.
+ *
+ * \param state         The report state.
+ */
+static void report_suite_end(test_report_state_t* state)
+{
+    if (strcmp(state->suite, ""))
+    {
+        state->reporter->vtable->suite_end(state->reporter, state->suite);
+    }
+}
+
+/**
+ * \brief Report the start of a suite.
+ *
+ * \param state         The report state.
+ * \param entry         The plan entry for this suite.
+ */
+static void report_suite_start(
+    test_report_state_t* state, const test_plan_entry_t* entry)
+{
+    report_suite_end(state);
+
+    state->suite = entry->test->name;
+    state->reporter->vtable->suite_start(state->reporter, state->suite);
+}
+
+/**
+ * \brief Report the result of a completed test.
+ *
+ * The captured output and failures of the test are released once they have
+ * been reported.
+ *
+ * \param state         The report state.
+ * \param entry         The plan entry for this test.
+ */
+static void report_test_end(
+    test_report_state_t* state, test_plan_entry_t* entry)
+{
+    minunit_test_report_t report;
+    report.suite = entry->suite;
+    report.name = entry->name.c_str();
+    report.status = entry->status;
+    report.usage = &entry->usage;
+    report.benchmark =
+        entry->benchmark.samples > 0 ? &entry->benchmark : NULL;
+    report.timing = &entry->timing;
+    report.heap = entry->heap.tracked ? &entry->heap : NULL;
+    report.perf = entry->perf.counted ? &entry->perf : NULL;
+    report.runs = entry->runs;
+    report.failed_runs = entry->failed_runs;
+    report.failed_round = entry->failed_round;
+    report.seeded =
+        MINUNIT_TEST_ORDER_SHUFFLE == state->options->order
+     && entry->failed_runs > 0;
+    report.seed =
+        test_round_seed(state->options->shuffle_seed, entry->failed_round);
+
+    int exceeded =
+        entry->crashed
+            ? minunit_limits_exceeded(entry->status) : MINUNIT_LIMIT_NONE;
+
+    if (entry->timed_out)
+        report.outcome = MINUNIT_TEST_OUTCOME_TIMEOUT;
+    else if (MINUNIT_LIMIT_MEMORY == exceeded)
+        report.outcome = MINUNIT_TEST_OUTCOME_OOM;
+    else if (MINUNIT_LIMIT_CPU == exceeded)
+        report.outcome = MINUNIT_TEST_OUTCOME_CPU_LIMIT;
+    else if (entry->crashed)
+        report.outcome = MINUNIT_TEST_OUTCOME_CRASH;
+    else if (entry->usage.leaked_files > 0)
+        report.outcome = MINUNIT_TEST_OUTCOME_FD_LEAK;
+    else if (!entry->pass)
+        report.outcome = MINUNIT_TEST_OUTCOME_FAIL;
+    else
+        report.outcome = MINUNIT_TEST_OUTCOME_PASS;
+
+    if (MINUNIT_TEST_OUTCOME_PASS != report.outcome)
+    {
+        entry->test->failed = true;
+        ++state->fail_count;
+    }
+
+    if (MINUNIT_TEST_OUTCOME_PASS == report.outcome
+     && state->options->quiet_pass)
+    {
+        report.output = NULL;
+        report.output_size = 0;
+    }
+    else
+    {
+        report.output = entry->output.data();
+        report.output_size = entry->output.size();
+    }
+
+    report.failures = entry->failures.data();
+    report.failure_count = entry->failures.size();
+
+    state->reporter->vtable->test_end(state->reporter, &report);
+
+    string().swap(entry->output);
+    vector<minunit_failure_t>().swap(entry->failures);
+}
+
+/**
+ * \brief Report as much of the test plan as possible, in registration order.
+ *
+ * Reporting stops at the first test that has not yet completed.  When test
+ * output goes straight to the console, the start of that test is reported, so
+ * that its output follows the RUN line.  When test output is captured, the
+ * start, the captured output, and the result of each test are reported
+ * together once the test completes.
+ *
+ * \param state         The report state.
+ */
+static void report_test_plan(test_report_state_t* state)
+{
+    while (state->cursor < state->plan->size())
+    {
+        test_plan_entry_t* entry = &(*state->plan)[state->cursor];
+
+        if (MINUNIT_TEST_TYPE_SUITE == entry->test->type)
+        {
+            report_suite_start(state, entry);
+            ++state->cursor;
+            continue;
+        }
+
+        if (!entry->run_reported && (entry->complete || !state->captured))
+        {
+            state->reporter->vtable->test_start(
+                state->reporter, entry->suite, entry->name.c_str());
+            entry->run_reported = true;
+        }
+
+        if (!entry->complete)
+        {
+            break;
+        }
+
+        report_test_end(state, entry);
+        ++state->cursor;
+    }
+
+    fflush(stdout);
+}
+
+/**
+ * \brief Determine the order in which the unit tests in the plan are run.
+ *
+ * In duration order, tests are run longest first according to the duration
+ * cache, so that a long test does not start near the end of the run and
+ * stretch it out.  Tests without a cached duration might be long too, so they
+ * are run before the others, in registration order.  In shuffled order, tests
+ * are scheduled in registration order, and each round shuffles them afresh.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ * \param durations     The cached test durations.
+ * \param order         The plan indices of the unit tests, in the order to run
+ *                      them.
+ */
+static void schedule_test_plan(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan, const minunit_timings_t& durations,
+    vector<size_t>* order)
+{
+    for (size_t index = 0; index < plan.size(); ++index)
+    {
+        if (MINUNIT_TEST_TYPE_UNIT == plan[index].test->type)
+            order->push_back(index);
+    }
+
+    if (MINUNIT_TEST_ORDER_DURATION != options->order)
+    {
+        return;
+    }
+
+    vector<double> expected(plan.size(), HUGE_VAL);
+    for (size_t index : *order)
+    {
+        auto i = durations.find(test_timing_name(&plan[index]));
+        if (durations.end() != i)
+            expected[index] = i->second.mean_ns;
+    }
+
+    stable_sort(
+        order->begin(), order->end(),
+        [&expected](size_t lhs, size_t rhs) {
+            return expected[lhs] > expected[rhs]; });
+}
+
+/**
+ * \brief Queue the next round of the test plan, if another round is due.
+ *
+ * \param state         The report state.
+ * \param pending       The queue of tests not yet run, to append the round
+ *                      to.
+ *
+ * \returns true if a round was queued, and false if the run is over.
+ */
+static bool next_test_round(
+    test_report_state_t* state, deque<size_t>* pending)
+{
+    const minunit_test_options_t* options = state->options;
+
+    if (state->last_round || state->order->empty())
+    {
+        return false;
+    }
+
+    vector<size_t> round(*state->order);
+    if (MINUNIT_TEST_ORDER_SHUFFLE == options->order)
+    {
+        shuffle_test_order(
+            test_round_seed(options->shuffle_seed, state->rounds), &round);
+    }
+
+    pending->insert(pending->end(), round.begin(), round.end());
+
+    ++state->rounds;
+    if (options->repeat > 0 && state->rounds >= options->repeat)
+        state->last_round = true;
+
+    return true;
+}
+
+/**
+ * \brief Start no further rounds, completing every test which has already run
+ * in each round started.
+ *
+ * \param state         The report state.
+ */
+static void end_test_rounds(test_report_state_t* state)
+{
+    state->last_round = true;
+
+    for (test_plan_entry_t& entry : *state->plan)
+    {
+        if (MINUNIT_TEST_TYPE_UNIT == entry.test->type
+         && entry.runs == state->rounds)
+        {
+            entry.complete = true;
+        }
+    }
+}
+
+/**
+ * \brief Record the outcome of one run of a test.
+ *
+ * Once a run of the test fails, that run's outcome is kept for the report,
+ * and later runs are only counted.  With several workers, runs of the same
+ * test from different rounds can finish out of order, so the round of the
+ * first failure is the number of runs which finished before it.
+ *
+ * \param state         The report state.
+ * \param entry         The plan entry for this test.
+ * \param pass          true if the run passed.
+ * \param crashed       true if the run crashed.
+ * \param timed_out     true if the run exceeded its timeout.
+ * \param status        The status of the crashed or timed out run.
+ */
+static void record_test_run(
+    test_report_state_t* state, test_plan_entry_t* entry, bool pass,
+    bool crashed, bool timed_out, int status)
+{
+    if (0 == entry->failed_runs)
+    {
+        entry->pass = pass;
+        entry->crashed = crashed;
+        entry->timed_out = timed_out;
+        entry->status = status;
+    }
+
+    if (!pass)
+    {
+        if (0 == entry->failed_runs)
+            entry->failed_round = entry->runs;
+
+        ++entry->failed_runs;
+    }
+
+    ++entry->runs;
+
+    if (!pass && state->options->until_fail && !state->last_round)
+    {
+        end_test_rounds(state);
+    }
+
+    entry->complete = state->last_round && entry->runs == state->rounds;
+}
+
+/**
+ * \brief The exit status of a forked test runner whose warm-up hook failed.
+ */
+#define WARM_UP_FAILED_STATUS 86
+
+/**
+ * \brief Run the registered warm-up hooks, in registration order.
+ *
+ * The first hook to fail stops the rest, and is named on standard error.
+ *
+ * \param options       The test options.
+ *
+ * \returns true if every warm-up hook succeeded, and false otherwise.
+ */
+static bool run_warm_up_hooks(const minunit_test_options_t* options)
+{
+    minunit_test_case_t** begin;
+    minunit_test_case_t** end;
+    get_test_cases(&begin, &end);
+
+    const char* suite = "";
+    for (minunit_test_case_t** i = begin; i != end; ++i)
+    {
+        if (MINUNIT_TEST_TYPE_SUITE == (*i)->type)
+            suite = (*i)->name;
+
+        if (MINUNIT_TEST_TYPE_WARM_UP != (*i)->type)
+            continue;
+
+        minunit_test_context_t context = {};
+        context.pass = true;
+        context.iterations = 1;
+        vector<minunit_failure_t> failures;
+        minunit_assert_begin();
+        (*i)->method(options, &context);
+        minunit_assert_end(&failures);
+
+        for (const minunit_failure_t& failure : failures)
+        {
+            minunit_failure_print(options, &failure);
+        }
+
+        fflush(stdout);
+
+        if (!context.pass)
+        {
+            fprintf(stderr, "Warm-up hook %s.%s failed.\n", suite, (*i)->name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Get the timeout for a test.
+ *
+ * \param options       The test options.
+ * \param entry         The plan entry for the test.
+ *
+ * \returns the timeout in milliseconds, or 0 if the test has no timeout.
+ */
+static unsigned int test_timeout(
+    const minunit_test_options_t* options, const test_plan_entry_t* entry)
+{
+    if (entry->test->flags & MINUNIT_TEST_FLAG_TIMEOUT)
+        return entry->test->timeout;
+
+    return options->timeout;
+}
+
+#ifdef FORKED_TEST_RUNNER
+/**
+ * \brief Get the resource limits for a test.
+ *
+ * \param options       The test options.
+ * \param entry         The plan entry for the test.
+ * \param limits        Set to the limits of the test runner, overridden by
+ *                      each limit the test sets itself.
+ */
+static void test_limits(
+    const minunit_test_options_t* options, const test_plan_entry_t* entry,
+    minunit_test_limits_t* limits)
+{
+    const minunit_test_limits_t* own = entry->test->limits;
+
+    *limits = options->limits;
+    if (NULL == own)
+        return;
+
+    if (0 != own->memory)
+        limits->memory = own->memory;
+    if (0 != own->cpu)
+        limits->cpu = own->cpu;
+    if (0 != own->files)
+        limits->files = own->files;
+    if (0 != own->output)
+        limits->output = own->output;
+}
+
+/**
+ * \brief Maximum number of tests handed to a worker in a single batch.
+ */
+#define TEST_WORKER_MAX_BATCH 64
+
+/**
+ * \brief A forked test runner process, which runs tests on request from the
+ * parent.
+ *
+ * A worker retires once a test leaves files open in it, and exits without
+ * running the rest of its batch.
+ */
+typedef struct test_worker
+{
+    pid_t pid;
+    int fd;
+    FILE* capture;
+    minunit_ring_t* ring;
+    bool retiring;
+    deque<size_t> outstanding;
+    vector<uint8_t> input;
+    size_t input_offset;
+    string output;
+    vector<minunit_failure_t> failures;
+    chrono::steady_clock::time_point started;
+} test_worker_t;
+
+pid_t fork_test_runner(int parentfd, int childfd)
+{
+    pid_t child = fork();
+
+    /* parent */
+    if (child != 0)
+    {
+        close(childfd);
+    }
+    /* child */
+    else
+    {
+        close(parentfd);
+    }
+
+    return child;
+}
+
+/**
+ * \brief Send a batch of test indices to a worker.
+ *
+ * \param s             The parent end of the socket.
+ * \param indices       The plan indices of the tests to run.
+ *
+ * \returns true on success, and false on failure.
+ */
+static bool write_test_batch(int s, const vector<uint32_t>& indices)
+{
+    vector<uint8_t> output;
+
+    minunit_frame_append(
+        &output, MINUNIT_MESSAGE_RUN, indices.data(),
+        indices.size() * sizeof(uint32_t));
+
+    return minunit_socket_flush(s, &output);
+}
+
+/**
+ * \brief Append the result of a test to the child's output buffer.
+ *
+ * \param output        The output buffer.
+ * \param index         The plan index of the test.
+ * \param result        The result of the test.
+ * \param usage         The usage measured for the test.
+ * \param timing        The timing measured for the test.
+ * \param heap          The heap usage measured for the test.
+ */
+static void write_test_result(
+    vector<uint8_t>* output, uint32_t index, bool result,
+    const test_usage_t* usage, const test_timing_t* timing,
+    const test_heap_t* heap)
+{
+    minunit_result_record_t val;
+
+    memset(&val, 0, sizeof(val));
+    val.index = index;
+    val.pass = result ? 1 : 0;
+    val.usage = *usage;
+    val.timing = *timing;
+    val.heap = *heap;
+
+    minunit_frame_append(output, MINUNIT_MESSAGE_RESULT, &val, sizeof(val));
+}
+
+/**
+ * \brief Append benchmark statistics to the child's output buffer.
+ *
+ * \param output        The output buffer.
+ * \param index         The plan index of the benchmark test.
+ * \param benchmark     The statistics measured for the benchmark.
+ */
+static void write_test_benchmark(
+    vector<uint8_t>* output, uint32_t index, const test_benchmark_t* benchmark)
+{
+    minunit_benchmark_record_t val;
+
+    memset(&val, 0, sizeof(val));
+    val.index = index;
+    val.benchmark = *benchmark;
+
+    minunit_frame_append(
+        output, MINUNIT_MESSAGE_BENCHMARK, &val, sizeof(val));
+}
+
+/**
+ * \brief Append performance counts to the child's output buffer.
+ *
+ * \param output        The output buffer.
+ * \param index         The plan index of the test.
+ * \param perf          The performance counts measured for the test.
+ */
+static void write_test_perf(
+    vector<uint8_t>* output, uint32_t index, const test_perf_t* perf)
+{
+    minunit_perf_record_t val;
+
+    memset(&val, 0, sizeof(val));
+    val.index = index;
+    val.perf = *perf;
+
+    minunit_frame_append(output, MINUNIT_MESSAGE_PERF, &val, sizeof(val));
+}
+
+/**
+ * \brief Append a failed assertion to the child's output buffer.
+ *
+ * \param output        The output buffer.
+ * \param index         The index of the test.
+ * \param failure       The failure.
+ */
+static void write_test_failure(
+    vector<uint8_t>* output, uint32_t index, const minunit_failure_t* failure)
+{
+    minunit_failure_record_t val;
+    val.index = index;
+    val.line = failure->line;
+    val.thread = failure->thread;
+    val.dropped = failure->dropped;
+    val.file_length = (uint32_t)failure->file.size();
+    val.expression_length = (uint32_t)failure->expression.size();
+    val.lhs_length = (uint32_t)failure->lhs.size();
+    val.rhs_length = (uint32_t)failure->rhs.size();
+
+    string payload((const char*)&val, sizeof(val));
+    payload += failure->file;
+    payload += failure->expression;
+    payload += failure->lhs;
+    payload += failure->rhs;
+
+    minunit_frame_append(
+        output, MINUNIT_MESSAGE_FAILURE, payload.data(), payload.size());
+}
+
+/**
+ * \brief Decode a failed assertion sent by a child.
+ *
+ * \param payload       The payload of the FAILURE message.
+ * \param length        The length of the payload.
+ * \param index         Set to the index of the test.
+ * \param failure       The failure to populate.
+ *
+ * \returns true on success, and false if the payload is malformed.
+ */
+static bool read_test_failure(
+    const uint8_t* payload, size_t length, uint32_t* index,
+    minunit_failure_t* failure)
+{
+    minunit_failure_record_t val;
+    if (length < sizeof(val))
+        return false;
+
+    memcpy(&val, payload, sizeof(val));
+
+    uint64_t total =
+        (uint64_t)sizeof(val) + val.file_length + val.expression_length
+      + val.lhs_length + val.rhs_length;
+    if (total != length)
+        return false;
+
+    const char* text = (const char*)payload + sizeof(val);
+
+    *index = val.index;
+    failure->line = val.line;
+    failure->thread = val.thread;
+    failure->dropped = val.dropped;
+    failure->file.assign(text, val.file_length);
+    text += val.file_length;
+    failure->expression.assign(text, val.expression_length);
+    text += val.expression_length;
+    failure->lhs.assign(text, val.lhs_length);
+    text += val.lhs_length;
+    failure->rhs.assign(text, val.rhs_length);
+
+    return true;
+}
+
+/**
+ * \brief Append a crash report for a test to the output buffer.
+ *
+ * \param output        The output buffer.
+ * \param index         The plan index of the test.
+ * \param status        The wait status of the process which ran the test.
+ * \param wall_ns       The time elapsed before the crash.
+ */
+static void write_test_crash(
+    vector<uint8_t>* output, uint32_t index, int status, uint64_t wall_ns)
+{
+    minunit_crash_record_t val;
+
+    memset(&val, 0, sizeof(val));
+    val.index = index;
+    val.status = status;
+    val.usage.wall_ns = wall_ns;
+
+    minunit_frame_append(output, MINUNIT_MESSAGE_CRASH, &val, sizeof(val));
+}
+
+/**
+ * \brief Redirect standard output and standard error to the capture file.
+ *
+ * \param capture       The descriptor of the capture file.
+ */
+static void redirect_test_output(int capture)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    dup2(capture, STDOUT_FILENO);
+    dup2(capture, STDERR_FILENO);
+
+    /* keep standard output in step with unbuffered standard error.  The
+     * buffer is static, so that the first test to print does not appear to
+     * leak it. */
+    static char buffer[BUFSIZ];
+    setvbuf(stdout, buffer, _IOLBF, sizeof(buffer));
+}
+
+/**
+ * \brief Read the contents of a capture file.
+ *
+ * \param capture       The descriptor of the capture file.
+ * \param limit         The maximum number of bytes to read.
+ * \param data          The buffer to append the contents to.
+ */
+static void read_test_capture(int capture, size_t limit, vector<uint8_t>* data)
+{
+    off_t size = lseek(capture, 0, SEEK_END);
+    if (size <= 0)
+    {
+        return;
+    }
+
+    size_t start = data->size();
+    size_t length = min((size_t)size, limit);
+    size_t total = 0;
+
+    data->resize(start + length);
+    while (total < length)
+    {
+        ssize_t bytes =
+            pread(capture, data->data() + start + total, length - total,
+                  (off_t)total);
+        if (bytes < 0 && EINTR == errno)
+            continue;
+        if (bytes <= 0)
+            break;
+
+        total += (size_t)bytes;
+    }
+
+    data->resize(start + total);
+}
+
+/**
+ * \brief Room kept for the note which ends output cut short at its limit.
+ */
+#define TRUNCATION_NOTE_SIZE 96
+
+/**
+ * \brief Read the output of a test from a capture file, cutting it short at
+ * the test's limit on output.
+ *
+ * \param capture       The descriptor of the capture file.
+ * \param limit         The limit on output, or 0 if there is none.
+ * \param max           The maximum number of bytes to read.
+ * \param data          The buffer to append the output to.
+ */
+static void read_test_output(
+    int capture, uint64_t limit, size_t max, vector<uint8_t>* data)
+{
+    /* past the most that is read, output is already dropped silently. */
+    if (0 == limit || limit + TRUNCATION_NOTE_SIZE > max)
+    {
+        read_test_capture(capture, max, data);
+        return;
+    }
+
+    off_t size = lseek(capture, 0, SEEK_END);
+    read_test_capture(capture, (size_t)limit, data);
+
+    if (size > (off_t)limit)
+    {
+        char note[TRUNCATION_NOTE_SIZE];
+        int length =
+            snprintf(
+                note, sizeof(note),
+                "\n... output truncated at its limit of %llu bytes.\n",
+                (unsigned long long)limit);
+        data->insert(data->end(), note, note + length);
+    }
+}
+
+/**
+ * \brief Collect the output captured for a test, and append it to the output
+ * buffer.
+ *
+ * The capture file is emptied for the next test, so that when a test crashes,
+ * the capture file holds only the output of that test.
+ *
+ * \param capture       The descriptor of the capture file.
+ * \param index         The plan index of the test.
+ * \param limit         The limit on the output of the test, or 0 if there is
+ *                      none.
+ * \param output        The output buffer.
+ */
+static void collect_test_capture(
+    int capture, uint32_t index, uint64_t limit, vector<uint8_t>* output)
+{
+    minunit_output_record_t val;
+    vector<uint8_t> payload(sizeof(val));
+
+    fflush(stdout);
+    fflush(stderr);
+
+    read_test_output(
+        capture, limit, MINUNIT_PROTOCOL_MAX_PAYLOAD - sizeof(val), &payload);
+    if (payload.size() == sizeof(val))
+    {
+        return;
+    }
+
+    if (0 != ftruncate(capture, 0))
+    {
+        /* a failed truncation only leaves stale output behind. */
+    }
+
+    lseek(capture, 0, SEEK_SET);
+
+    memset(&val, 0, sizeof(val));
+    val.index = index;
+    memcpy(payload.data(), &val, sizeof(val));
+
+    minunit_frame_append(
+        output, MINUNIT_MESSAGE_OUTPUT, payload.data(), payload.size());
+}
+
+/**
+ * \brief Copy the contents of a capture file to a stream, and empty it.
+ *
+ * \param capture       The descriptor of the capture file.
+ * \param stream        The stream to write to.
+ */
+static void flush_test_capture(int capture, FILE* stream)
+{
+    vector<uint8_t> data;
+    read_test_capture(capture, MINUNIT_PROTOCOL_MAX_PAYLOAD, &data);
+    fwrite(data.data(), 1, data.size(), stream);
+    fflush(stream);
+
+    if (0 != ftruncate(capture, 0))
+    {
+        /* a failed truncation only leaves stale output behind. */
+    }
+
+    lseek(capture, 0, SEEK_SET);
+}
+
+/**
+ * \brief Run the warm-up hooks in a forked test runner.
+ *
+ * Their output is held in the capture file while they run.  If they succeed,
+ * it is written to standard error, where it can't corrupt a report written to
+ * standard output.  If one fails, it is left for the parent, which reports the
+ * failure once rather than once for each test runner.
+ *
+ * \param options       The test options.
+ * \param capture       The descriptor of the capture file, or -1 if test
+ *                      output is not captured.
+ *
+ * \returns true if every warm-up hook succeeded, and false otherwise.
+ */
+static bool warm_up_test_runner(
+    const minunit_test_options_t* options, int capture)
+{
+    if (capture < 0)
+    {
+        return run_warm_up_hooks(options);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    int saved_stdout = dup(STDOUT_FILENO);
+    int saved_stderr = dup(STDERR_FILENO);
+    dup2(capture, STDOUT_FILENO);
+    dup2(capture, STDERR_FILENO);
+
+    bool warmed = run_warm_up_hooks(options);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_stdout, STDOUT_FILENO);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stdout);
+    close(saved_stderr);
+
+    if (warmed)
+    {
+        flush_test_capture(capture, stderr);
+    }
+
+    return warmed;
+}
+
+/**
+ * \brief Wake a peer waiting on the shared memory ring.
+ *
+ * \param s             The socket to the peer.
+ *
+ * \returns true on success, and false on failure.
+ */
+static bool write_ring_wake(int s)
+{
+    vector<uint8_t> output;
+
+    minunit_frame_append(&output, MINUNIT_MESSAGE_WAKE, NULL, 0);
+
+    return minunit_socket_flush(s, &output);
+}
+
+/**
+ * \brief Send the child's output buffer to the parent, and clear the buffer.
+ *
+ * Without a ring, the output is written to the socket.  With a ring, the
+ * output is written to the ring, and the socket is only used to wake the
+ * parent if it is waiting, or to wait for the parent if the ring is full.
+ * Any batches received from the parent while waiting are kept for later.
+ *
+ * \param s             The child end of the socket.
+ * \param ring          The ring to write, or NULL to write to the socket.
+ * \param output        The output buffer.
+ * \param input         The input buffer for batches from the parent.
+ *
+ * \returns true on success, and false if the parent has gone away.
+ */
+static bool flush_test_output(
+    int s, minunit_ring_t* ring, vector<uint8_t>* output,
+    vector<uint8_t>* input)
+{
+    if (NULL == ring)
+    {
+        return minunit_socket_flush(s, output);
+    }
+
+    size_t offset = 0;
+    while (offset < output->size())
+    {
+        size_t written =
+            minunit_ring_write(
+                ring, output->data() + offset, output->size() - offset);
+        offset += written;
+
+        if (0 != written)
+            continue;
+
+        /* the ring is full, so the parent must drain it. */
+        if (minunit_ring_consumer_waiting(ring) && !write_ring_wake(s))
+            return false;
+
+        if (minunit_ring_producer_wait(ring) && !minunit_socket_read(s, input))
+            return false;
+    }
+
+    output->clear();
+
+    if (minunit_ring_consumer_waiting(ring))
+    {
+        return write_ring_wake(s);
+    }
+
+    return true;
+}
+
+/**
+ * \brief Where a test runner sends the failures of a test as they are
+ * recorded, so that they reach the parent even if the test then crashes.
+ */
+typedef struct failure_channel
+{
+    int s;
+    minunit_ring_t* ring;
+    vector<uint8_t>* input;
+    uint32_t index;
+} failure_channel_t;
+
+/**
+ * \brief Send a failure of a test to the parent as soon as it is recorded.
+ *
+ * \param failure       The failure.
+ * \param arg           The failure channel.
+ */
+static void send_test_failure(const minunit_failure_t* failure, void* arg)
+{
+    failure_channel_t* channel = (failure_channel_t*)arg;
+    vector<uint8_t> output;
+
+    write_test_failure(&output, channel->index, failure);
+
+    /* a parent which has gone away is noticed after the test. */
+    flush_test_output(channel->s, channel->ring, &output, channel->input);
+}
+
+/**
+ * \brief Run a test in this process and append its results to the output
+ * buffer.
+ *
+ * The test runs under its resource limits, which are lifted once it returns.
+ * Each failure on the thread running the test is sent as soon as it is
+ * recorded, rather than with the result, so that a test which fails and then
+ * crashes still reports its failures.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ * \param index         The plan index of the test.
+ * \param s             The socket or pipe to send failures on.
+ * \param ring          The ring to send failures on, or NULL to send them on
+ *                      the socket.
+ * \param input         The input buffer for batches from the parent, or NULL
+ *                      if there is no ring.
+ * \param output        The output buffer.
+ *
+ * \returns true if this process can go on to run other tests, and false if
+ * the test left descriptors open in it.
+ */
+static bool run_test_in_child(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan, uint32_t index, int s,
+    minunit_ring_t* ring, vector<uint8_t>* input, vector<uint8_t>* output)
+{
+    minunit_test_context_t result = {};
+    result.pass = true;
+    result.iterations = 1;
+    test_usage_t usage;
+    test_benchmark_t benchmark;
+    test_timing_t timing;
+    test_heap_t heap;
+    test_perf_t perf;
+    minunit_test_limits_t limits;
+    minunit_limits_state_t limit_state;
+    uint64_t leaked_files;
+
+    /* counters are opened before the open files are counted, so that they
+     * are not mistaken for files leaked by the test.  They only start counting
+     * once the test itself runs. */
+    if (options->perf_counters)
+        minunit_perf_open();
+
+    failure_channel_t channel = { s, ring, input, index };
+    minunit_assert_set_sink(&send_test_failure, &channel);
+
+    test_limits(options, &plan[index], &limits);
+    minunit_limits_begin(&limits, &limit_state);
+
+    minunit_coverage_test_begin();
+    measure_test_case(
+        options, &plan[index], &result, &usage, &benchmark, &timing, &heap,
+        &perf);
+    minunit_coverage_test_end(index);
+    fflush(stdout);
+
+    minunit_assert_set_sink(NULL, NULL);
+
+    minunit_limits_end(&limit_state, &leaked_files);
+    usage.leaked_files = leaked_files;
+
+    vector<minunit_failure_t> failures;
+    minunit_assert_end(&failures);
+
+    for (const minunit_failure_t& failure : failures)
+    {
+        write_test_failure(output, index, &failure);
+    }
+
+    if (benchmark.samples > 0)
+    {
+        write_test_benchmark(output, index, &benchmark);
+    }
+
+    if (0 != perf.counted)
+    {
+        write_test_perf(output, index, &perf);
+    }
+
+    write_test_result(output, index, result.pass, &usage, &timing, &heap);
+
+    return 0 == leaked_files;
+}
+
+/**
+ * \brief Determine whether a buffer of frames ends with a test result.
+ *
+ * \param frames        The frames written by a process forked for a test.
+ *
+ * \returns true if the last frame is a well formed result, and false
+ * otherwise.
+ */
+static bool test_result_received(const vector<uint8_t>& frames)
+{
+    size_t offset = 0;
+    minunit_frame_header_t header;
+    const uint8_t* payload;
+    bool result = false;
+    int status;
+
+    while (MINUNIT_FRAME_DECODED ==
+            (status = minunit_frame_decode(
+                frames, &offset, &header, &payload)))
+    {
+        result = MINUNIT_MESSAGE_RESULT == header.type;
+    }
+
+    return result && MINUNIT_FRAME_INCOMPLETE == status
+        && offset == frames.size();
+}
+
+/**
+ * \brief Append the failures sent by a process forked for a test which did
+ * not deliver a result to the output buffer, ahead of its crash.
+ *
+ * \param frames        The frames written by the process.
+ * \param output        The output buffer.
+ */
+static void forward_test_failures(
+    const vector<uint8_t>& frames, vector<uint8_t>* output)
+{
+    size_t offset = 0;
+    minunit_frame_header_t header;
+    const uint8_t* payload;
+
+    while (MINUNIT_FRAME_DECODED ==
+            minunit_frame_decode(frames, &offset, &header, &payload))
+    {
+        if (MINUNIT_MESSAGE_FAILURE == header.type)
+        {
+            minunit_frame_append(
+                output, MINUNIT_MESSAGE_FAILURE, payload, header.length);
+        }
+    }
+}
+
+/**
+ * \brief Run a test in a process forked from this zygote, and append its
+ * results to the output buffer.
+ *
+ * The forked process starts from the state of the zygote, which has already
+ * run every warm-up hook, and exits after the test, so that no state leaks
+ * from one test to the next.  Its results are collected over a pipe.  If it
+ * exits without delivering a result, the failures it sent are passed on with a
+ * crash reported for the test instead, and the zygote carries on with the next
+ * test.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ * \param index         The plan index of the test.
+ * \param s             The socket to the parent, closed in the forked
+ *                      process.
+ * \param output        The output buffer.
+ *
+ * \returns true on success, and false if the test process could not be
+ * started.
+ */
+static bool fork_test_case(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan, uint32_t index, int s,
+    vector<uint8_t>* output)
+{
+    int pipefd[2];
+
+    if (pipe(pipefd) < 0)
+    {
+        perror("pipe");
+        return false;
+    }
+
+    fflush(stdout);
+
+    auto start = chrono::steady_clock::now();
+
+    pid_t child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return false;
+    }
+    else if (0 == child)
+    {
+        vector<uint8_t> frames;
+
+        close(s);
+        close(pipefd[0]);
+
+        run_test_in_child(
+            options, plan, index, pipefd[1], NULL, NULL, &frames);
+        minunit_socket_flush(pipefd[1], &frames);
+        close(pipefd[1]);
+
+        exit(0);
+    }
+
+    close(pipefd[1]);
+
+    vector<uint8_t> frames;
+    while (minunit_socket_read(pipefd[0], &frames))
+        ;
+    close(pipefd[0]);
+
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0 && EINTR == errno)
+        ;
+
+    if (WIFEXITED(status) && 0 == WEXITSTATUS(status)
+     && test_result_received(frames))
+    {
+        output->insert(output->end(), frames.begin(), frames.end());
+    }
+    else
+    {
+        forward_test_failures(frames, output);
+        write_test_crash(
+            output, index, status,
+            chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - start).count());
+    }
+
+    return true;
+}
+
+/**
+ * \brief Run tests in the child on request from the parent, until the parent
+ * closes its end of the socket.
+ *
+ * Batches of test indices are read from the parent in bulk.  The result of
+ * each test is written as soon as the test completes, so that the parent can
+ * attribute a crash to the test that caused it without waiting for the rest of
+ * the batch.  If a test leaves files open, the child stops after its result,
+ * and the parent hands the rest of the batch to a fresh child.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ * \param s             The child end of the socket.
+ * \param capture       The descriptor of the file capturing test output, or -1
+ *                      if test output is not captured.
+ * \param ring          The ring carrying results to the parent, or NULL if
+ *                      results are written to the socket.
+ */
+static void child_test_loop(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan, int s, int capture,
+    minunit_ring_t* ring)
+{
+    vector<uint8_t> input;
+    vector<uint8_t> output;
+    size_t offset = 0;
+    deque<uint32_t> queue;
+
+    for (;;)
+    {
+        /* decode any batches already received. */
+        minunit_frame_header_t header;
+        const uint8_t* payload;
+        int status;
+
+        while (MINUNIT_FRAME_DECODED ==
+                (status = minunit_frame_decode(
+                    input, &offset, &header, &payload)))
+        {
+            if (MINUNIT_MESSAGE_RUN != header.type)
+                continue;
+
+            for (size_t i = 0; i + sizeof(uint32_t) <= header.length;
+                 i += sizeof(uint32_t))
+            {
+                uint32_t index;
+                memcpy(&index, payload + i, sizeof(index));
+                queue.push_back(index);
+            }
+        }
+
+        if (MINUNIT_FRAME_INVALID == status)
+        {
+            return;
+        }
+
+        minunit_frame_compact(&input, &offset);
+
+        /* wait for more work from the parent. */
+        if (queue.empty())
+        {
+            if (!minunit_socket_read(s, &input))
+                return;
+
+            continue;
+        }
+
+        uint32_t index = queue.front();
+        queue.pop_front();
+
+        if (index >= plan.size())
+        {
+            return;
+        }
+
+        vector<uint8_t> results;
+        bool clean = true;
+
+        if (!options->zygote)
+        {
+            clean =
+                run_test_in_child(
+                    options, plan, index, s, ring, &input, &results);
+        }
+        else if (!fork_test_case(options, plan, index, s, &results))
+        {
+            return;
+        }
+
+        /* captured output precedes the result it belongs to. */
+        if (capture >= 0)
+        {
+            minunit_test_limits_t limits;
+            test_limits(options, &plan[index], &limits);
+            collect_test_capture(capture, index, limits.output, &output);
+        }
+
+        output.insert(output.end(), results.begin(), results.end());
+
+        if (!flush_test_output(s, ring, &output, &input))
+        {
+            return;
+        }
+
+        /* a test which leaked files leaves the rest to a fresh runner. */
+        if (!clean)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * \brief Start a forked test runner.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ * \param workers       The workers started so far, whose sockets are closed in
+ *                      the child.
+ * \param worker        The worker to start.
+ *
+ * \returns true in the parent on success, and false on failure.  The child
+ * does not return.
+ */
+static bool start_test_worker(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan,
+    const vector<test_worker_t>& workers, test_worker_t* worker)
+{
+    int pair[2];
+
+    worker->pid = -1;
+    worker->fd = -1;
+    worker->retiring = false;
+    worker->outstanding.clear();
+    worker->input.clear();
+    worker->input_offset = 0;
+
+    /* test output is captured in a file shared with the parent, so that the
+     * parent can recover the output of a test that crashed. */
+    if (NULL == worker->capture)
+    {
+        worker->capture = tmpfile();
+    }
+
+    /* without shared memory, results are carried by the socket. */
+    if (MINUNIT_TEST_TRANSPORT_RING == options->transport)
+    {
+        worker->ring = minunit_ring_create();
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+    {
+        perror("socketpair");
+        return false;
+    }
+
+    /* flush every stream, including report files, so that the child does not
+     * write the parent's buffered report again when it exits. */
+    fflush(NULL);
+
+    pid_t child = fork_test_runner(pair[0], pair[1]);
+    if (child < 0)
+    {
+        perror("fork");
+        close(pair[0]);
+        return false;
+    }
+    else if (0 == child)
+    {
+        for (const test_worker_t& other : workers)
+        {
+            if (other.fd >= 0)
+                close(other.fd);
+            if (NULL != other.capture && other.capture != worker->capture)
+                fclose(other.capture);
+            if (NULL != other.ring && other.ring != worker->ring)
+                minunit_ring_release(other.ring);
+        }
+
+        /* a zygote leads a process group holding the tests it forks. */
+        if (options->zygote)
+        {
+            setpgid(0, 0);
+        }
+
+        int capture = -1;
+        if (NULL != worker->capture)
+        {
+            capture = fileno(worker->capture);
+        }
+
+        if (!warm_up_test_runner(options, capture))
+        {
+            exit(WARM_UP_FAILED_STATUS);
+        }
+
+        if (capture >= 0)
+        {
+            redirect_test_output(capture);
+        }
+
+        child_test_loop(options, plan, pair[1], capture, worker->ring);
+        close(pair[1]);
+
+        exit(0);
+    }
+
+    if (options->zygote)
+    {
+        setpgid(child, child);
+    }
+
+    worker->pid = child;
+    worker->fd = pair[0];
+
+    return true;
+}
+
+/**
+ * \brief Stop a forked test runner and reap it.
+ *
+ * \param worker        The worker to stop.
+ *
+ * \returns the wait status of the test runner.
+ */
+static int stop_test_worker(test_worker_t* worker)
+{
+    int status = 0;
+
+    if (worker->fd >= 0)
+    {
+        close(worker->fd);
+        worker->fd = -1;
+    }
+
+    if (worker->pid > 0)
+    {
+        while (waitpid(worker->pid, &status, 0) < 0 && EINTR == errno)
+            ;
+        worker->pid = -1;
+    }
+
+    /* the ring can only be released once the worker is gone. */
+    minunit_ring_release(worker->ring);
+    worker->ring = NULL;
+
+    return status;
+}
+
+/**
+ * \brief Top up a worker's batch of outstanding tests from the pending queue.
+ *
+ * The batch size shrinks as the pending queue drains, so that the tail of the
+ * run stays balanced across workers.  A worker is topped up once it has worked
+ * through half of its batch, so that it never waits on the parent for work.
+ *
+ * \param worker        The worker to top up.
+ * \param pending       The queue of tests not yet handed to a worker.
+ * \param live          The number of live workers.
+ */
+static void dispatch_test_batch(
+    test_worker_t* worker, deque<size_t>* pending, size_t live)
+{
+    size_t window = pending->size() / (2 * live);
+    window = max((size_t)1, min(window, (size_t)TEST_WORKER_MAX_BATCH));
+
+    if (pending->empty() || worker->outstanding.size() * 2 > window)
+    {
+        return;
+    }
+
+    vector<uint32_t> indices;
+    while (!pending->empty() && worker->outstanding.size() < window)
+    {
+        indices.push_back((uint32_t)pending->front());
+        worker->outstanding.push_back(pending->front());
+        pending->pop_front();
+    }
+
+    if (worker->outstanding.size() == indices.size())
+    {
+        worker->started = chrono::steady_clock::now();
+    }
+
+    if (!write_test_batch(worker->fd, indices))
+    {
+        /* the result read below detects the dead worker. */
+    }
+}
+
+/**
+ * \brief Record the results received from a worker.
+ *
+ * Results are read from the worker's ring, if it has one, and otherwise from
+ * its socket.  With a ring, the socket only carries wake-ups, or the end of
+ * file when the worker exits.  Captured output is held by the worker until
+ * the result it precedes arrives, since another worker may be running the
+ * same test in another round.
+ *
+ * \param state         The report state.
+ * \param worker        The worker to read from.
+ * \param readable      true if the worker's socket is ready to read.
+ *
+ * \returns true if the worker is still alive and following the protocol, and
+ * false otherwise.
+ */
+static bool receive_test_results(
+    test_report_state_t* state, test_worker_t* worker, bool readable)
+{
+    vector<test_plan_entry_t>& plan = *state->plan;
+    bool alive = true;
+
+    if (NULL == worker->ring)
+    {
+        alive = minunit_socket_read(worker->fd, &worker->input);
+    }
+    else
+    {
+        /* anything written before the worker exited is in the ring. */
+        if (readable)
+        {
+            vector<uint8_t> wakes;
+            alive = minunit_socket_read(worker->fd, &wakes);
+        }
+
+        minunit_ring_read(worker->ring, &worker->input);
+
+        /* a worker blocked on a full ring can continue now. */
+        if (minunit_ring_producer_waiting(worker->ring))
+            write_ring_wake(worker->fd);
+    }
+
+    minunit_frame_header_t header;
+    const uint8_t* payload;
+    int status;
+
+    while (MINUNIT_FRAME_DECODED ==
+            (status = minunit_frame_decode(
+                worker->input, &worker->input_offset, &header, &payload)))
+    {
+        /* benchmark statistics precede the result of the benchmark. */
+        if (MINUNIT_MESSAGE_BENCHMARK == header.type)
+        {
+            minunit_benchmark_record_t benchmark;
+            if (header.length != sizeof(benchmark))
+                return false;
+
+            memcpy(&benchmark, payload, sizeof(benchmark));
+
+            if (worker->outstanding.empty()
+             || worker->outstanding.front() != benchmark.index)
+            {
+                return false;
+            }
+
+            if (0 == plan[benchmark.index].failed_runs)
+                plan[benchmark.index].benchmark = benchmark.benchmark;
+            continue;
+        }
+
+        /* so do performance counts. */
+        if (MINUNIT_MESSAGE_PERF == header.type)
+        {
+            minunit_perf_record_t perf;
+            if (header.length != sizeof(perf))
+                return false;
+
+            memcpy(&perf, payload, sizeof(perf));
+
+            if (worker->outstanding.empty()
+             || worker->outstanding.front() != perf.index)
+            {
+                return false;
+            }
+
+            if (0 == plan[perf.index].failed_runs)
+                plan[perf.index].perf = perf.perf;
+            continue;
+        }
+
+        /* captured output also precedes the result of its test. */
+        if (MINUNIT_MESSAGE_OUTPUT == header.type)
+        {
+            minunit_output_record_t record;
+            if (header.length < sizeof(record))
+                return false;
+
+            memcpy(&record, payload, sizeof(record));
+
+            if (worker->outstanding.empty()
+             || worker->outstanding.front() != record.index)
+            {
+                return false;
+            }
+
+            worker->output.assign(
+                (const char*)payload + sizeof(record),
+                header.length - sizeof(record));
+            continue;
+        }
+
+        /* so does each failed assertion. */
+        if (MINUNIT_MESSAGE_FAILURE == header.type)
+        {
+            uint32_t index;
+            minunit_failure_t failure;
+            if (!read_test_failure(payload, header.length, &index, &failure))
+                return false;
+
+            if (worker->outstanding.empty()
+             || worker->outstanding.front() != index)
+            {
+                return false;
+            }
+
+            worker->failures.push_back(failure);
+            continue;
+        }
+
+        /* a test forked by a zygote crashed, but the zygote lives on. */
+        if (MINUNIT_MESSAGE_CRASH == header.type)
+        {
+            minunit_crash_record_t crash;
+            if (header.length != sizeof(crash))
+                return false;
+
+            memcpy(&crash, payload, sizeof(crash));
+
+            if (worker->outstanding.empty()
+             || worker->outstanding.front() != crash.index)
+            {
+                return false;
+            }
+
+            test_plan_entry_t* entry = &plan[crash.index];
+            if (0 == entry->failed_runs)
+            {
+                entry->usage = crash.usage;
+                entry->output.swap(worker->output);
+                entry->failures.swap(worker->failures);
+            }
+
+            record_test_run(state, entry, false, true, false, crash.status);
+            worker->output.clear();
+            worker->failures.clear();
+
+            worker->outstanding.pop_front();
+            worker->started = chrono::steady_clock::now();
+            continue;
+        }
+
+        if (MINUNIT_MESSAGE_RESULT != header.type)
+            continue;
+
+        minunit_result_record_t record;
+        if (header.length != sizeof(record))
+            return false;
+
+        memcpy(&record, payload, sizeof(record));
+
+        /* results must arrive in the order that tests were handed out. */
+        if (worker->outstanding.empty()
+         || worker->outstanding.front() != record.index)
+        {
+            return false;
+        }
+
+        test_plan_entry_t* entry = &plan[record.index];
+        if (0 == entry->failed_runs)
+        {
+            entry->usage = record.usage;
+            entry->timing = record.timing;
+            entry->heap = record.heap;
+            entry->output.swap(worker->output);
+            entry->failures.swap(worker->failures);
+        }
+
+        /* a worker which ran the test itself exits once it leaks files. */
+        if (record.usage.leaked_files > 0 && !state->options->zygote)
+            worker->retiring = true;
+
+        record_test_run(
+            state, entry, record.pass && 0 == record.usage.leaked_files,
+            false, false, 0);
+        worker->output.clear();
+        worker->failures.clear();
+
+        worker->outstanding.pop_front();
+        worker->started = chrono::steady_clock::now();
+    }
+
+    minunit_frame_compact(&worker->input, &worker->input_offset);
+
+    return alive && MINUNIT_FRAME_INVALID != status;
+}
+
+/**
+ * \brief Replace a worker which has died or which was killed.
+ *
+ * The test at the front of the worker's batch is charged with the failure,
+ * and the rest of the batch is returned to the front of the pending queue.
+ * A worker which retired ran nothing more, so its whole batch is returned.
+ * A worker whose warm-up hook failed ran nothing at all, and is not replaced,
+ * since its replacement would fail the same way.
+ *
+ * \param options       The test options.
+ * \param state         The report state.
+ * \param workers       The workers.
+ * \param worker        The worker to replace.
+ * \param pending       The queue of tests not yet handed to a worker.
+ * \param timed_out     true if the worker was killed for exceeding its
+ *                      timeout.
+ * \param warm_up_failed Set to true if the worker's warm-up hook failed.
+ *
+ * \returns true if a replacement worker was started, and false otherwise.
+ */
+static bool replace_test_worker(
+    const minunit_test_options_t* options, test_report_state_t* state,
+    vector<test_worker_t>& workers, test_worker_t* worker,
+    deque<size_t>* pending, bool timed_out, bool* warm_up_failed)
+{
+    vector<test_plan_entry_t>& plan = *state->plan;
+    test_plan_entry_t* entry = nullptr;
+    uint64_t wall_ns =
+        chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - worker->started).count();
+
+    if (timed_out)
+    {
+        /* a zygote's process group includes the test it forked. */
+        if (!options->zygote || kill(-worker->pid, SIGKILL) < 0)
+            kill(worker->pid, SIGKILL);
+    }
+
+    int status = stop_test_worker(worker);
+
+    *warm_up_failed =
+        !timed_out && WIFEXITED(status)
+     && WARM_UP_FAILED_STATUS == WEXITSTATUS(status);
+    if (*warm_up_failed)
+    {
+        /* the capture file holds the output of the hook that failed. */
+        if (NULL != worker->capture)
+        {
+            flush_test_capture(fileno(worker->capture), stderr);
+        }
+
+        pending->insert(
+            pending->begin(), worker->outstanding.begin(),
+            worker->outstanding.end());
+        worker->outstanding.clear();
+
+        return false;
+    }
+
+    if (!worker->outstanding.empty() && !worker->retiring)
+    {
+        entry = &plan[worker->outstanding.front()];
+        worker->outstanding.pop_front();
+    }
+
+    if (!worker->outstanding.empty())
+    {
+        /* return the rest of the batch to the front of the queue. */
+        pending->insert(
+            pending->begin(), worker->outstanding.begin(),
+            worker->outstanding.end());
+    }
+
+    if (nullptr != entry && 0 == entry->failed_runs)
+    {
+        entry->usage.wall_ns = wall_ns;
+
+        /* failures are sent as they are recorded, so any before the crash
+         * have arrived. */
+        entry->failures.swap(worker->failures);
+
+        /* the capture file holds whatever the test printed before it died. */
+        if (NULL != worker->capture)
+        {
+            minunit_test_limits_t limits;
+            test_limits(options, entry, &limits);
+
+            vector<uint8_t> output;
+            read_test_output(
+                fileno(worker->capture), limits.output,
+                MINUNIT_PROTOCOL_MAX_PAYLOAD, &output);
+            entry->output.assign(output.begin(), output.end());
+        }
+    }
+
+    if (nullptr != entry)
+    {
+        record_test_run(state, entry, false, !timed_out, timed_out, status);
+    }
+
+    worker->output.clear();
+    worker->failures.clear();
+
+    /* the next test runner starts with an empty capture file. */
+    if (NULL != worker->capture)
+    {
+        if (0 != ftruncate(fileno(worker->capture), 0))
+        {
+            /* a failed truncation only leaves stale output behind. */
+        }
+
+        lseek(fileno(worker->capture), 0, SEEK_SET);
+    }
+
+    return start_test_worker(options, plan, workers, worker);
+}
+
+/**
+ * \brief Run the test plan on a pool of forked test runners.
+ *
+ * Each worker is handed batches of tests from a shared queue, and streams
+ * back a result for each test.  Results are reported in registration order as
+ * they become available.  If a test crashes its worker, or runs past its
+ * timeout and is killed, the failure is recorded against that test, the rest
+ * of the worker's batch is returned to the queue, and a fresh worker is started
+ * in its place to run the remaining tests.  Each round of a repeated run is
+ * queued as the previous one drains, so that the same workers run every round.
+ *
+ * \param options       The test options.
+ * \param state         The report state.
+ *
+ * \returns true if the test runners could not be started, and false
+ * otherwise.
+ */
+static bool run_test_plan_forked(
+    const minunit_test_options_t* options, test_report_state_t* state)
+{
+    vector<test_plan_entry_t>& plan = *state->plan;
+    vector<test_worker_t> workers;
+    deque<size_t> pending;
+    size_t live = 0;
+    bool error = false;
+
+    next_test_round(state, &pending);
+
+    /* a crashed worker must not take the parent down with it. */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* start no more workers than there are tests to run. */
+    size_t worker_count = options->jobs > 0 ? options->jobs : 1;
+    if (worker_count > pending.size())
+        worker_count = pending.size();
+
+    /* test output is captured, and printed along with each result. */
+    state->captured = true;
+
+    workers.resize(worker_count);
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        if (start_test_worker(options, plan, workers, &workers[i]))
+            ++live;
+    }
+
+    for (;;)
+    {
+        /* report whatever has completed before waiting for more. */
+        report_test_plan(state);
+
+        /* without any live workers, the remaining tests can't be run. */
+        if (0 == live)
+        {
+            if (!pending.empty())
+            {
+                fprintf(stderr, "Could not start a forked test runner.\n");
+                error = true;
+            }
+
+            break;
+        }
+
+        /* hand out tests to workers running low on work. */
+        if (pending.empty())
+            next_test_round(state, &pending);
+
+        for (test_worker_t& worker : workers)
+        {
+            if (worker.fd >= 0 && !worker.retiring)
+                dispatch_test_batch(&worker, &pending, live);
+        }
+
+        /* wait for results from the busy workers, up to the next deadline. */
+        vector<struct pollfd> fds;
+        vector<test_worker_t*> polled;
+        auto now = chrono::steady_clock::now();
+        int wait_ms = -1;
+        for (test_worker_t& worker : workers)
+        {
+            /* a retiring worker is waited on until it exits. */
+            if (worker.outstanding.empty() && !worker.retiring)
+                continue;
+
+            struct pollfd fd = { worker.fd, POLLIN, 0 };
+            fds.push_back(fd);
+            polled.push_back(&worker);
+
+            /* don't block if results are already waiting in the ring. */
+            if (NULL != worker.ring && !minunit_ring_consumer_wait(worker.ring))
+                wait_ms = 0;
+
+            if (worker.outstanding.empty())
+                continue;
+
+            unsigned int timeout =
+                test_timeout(options, &plan[worker.outstanding.front()]);
+            if (timeout > 0)
+            {
+                auto remaining =
+                    chrono::duration_cast<chrono::milliseconds>(
+                        worker.started + chrono::milliseconds(timeout) - now)
+                        .count();
+                int remaining_ms = (int)max((decltype(remaining))0, remaining);
+
+                if (wait_ms < 0 || remaining_ms < wait_ms)
+                    wait_ms = remaining_ms;
+            }
+        }
+
+        if (fds.empty())
+        {
+            break;
+        }
+
+        if (poll(fds.data(), fds.size(), wait_ms) < 0)
+        {
+            if (EINTR == errno)
+                continue;
+
+            perror("poll");
+            error = true;
+            break;
+        }
+
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            test_worker_t* worker = polled[i];
+            bool readable = 0 != fds[i].revents;
+            bool alive = true;
+
+            if (readable || NULL != worker->ring)
+                alive = receive_test_results(state, worker, readable);
+
+            /* a worker that is still running may have exceeded its timeout. */
+            bool timed_out = false;
+            if (alive)
+            {
+                if (worker->outstanding.empty())
+                    continue;
+
+                unsigned int timeout =
+                    test_timeout(options, &plan[worker->outstanding.front()]);
+                if (0 == timeout
+                 || chrono::steady_clock::now()
+                        < worker->started + chrono::milliseconds(timeout))
+                {
+                    continue;
+                }
+
+                timed_out = true;
+            }
+
+            /* the test at the front of the batch took the worker down. */
+            bool warm_up_failed;
+            --live;
+            if (replace_test_worker(
+                    options, state, workers, worker, &pending, timed_out,
+                    &warm_up_failed))
+            {
+                ++live;
+            }
+            else if (warm_up_failed)
+            {
+                /* no test can run without the state its hooks set up. */
+                error = true;
+                break;
+            }
+        }
+
+        if (error)
+            break;
+    }
+
+    for (test_worker_t& worker : workers)
+    {
+        stop_test_worker(&worker);
+
+        if (NULL != worker.capture)
+            fclose(worker.capture);
+    }
+
+    report_test_plan(state);
+
+    return error;
+}
+#endif
+
+/**
+ * \brief A test run under the crash guard, and the measurements of the run.
+ */
+typedef struct guarded_test
+{
+    const minunit_test_options_t* options;
+    test_plan_entry_t* entry;
+    uint32_t index;
+    minunit_test_context_t* context;
+    test_usage_t usage;
+    test_benchmark_t benchmark;
+    test_timing_t timing;
+    test_heap_t heap;
+    test_perf_t perf;
+} guarded_test_t;
+
+/**
+ * \brief Run a test under the crash guard.
+ *
+ * \param arg           The guarded test.
+ */
+static void run_guarded_test(void* arg)
+{
+    guarded_test_t* guarded = (guarded_test_t*)arg;
+
+    minunit_coverage_test_begin();
+    measure_test_case(
+        guarded->options, guarded->entry, guarded->context, &guarded->usage,
+        &guarded->benchmark, &guarded->timing, &guarded->heap,
+        &guarded->perf);
+    minunit_coverage_test_end(guarded->index);
+}
+
+/**
+ * \brief Run the test plan in this process.
+ *
+ * Tests are run one at a time, without forking.  Where the platform allows it,
+ * a test which crashes or runs past its timeout is recovered with siglongjmp,
+ * and recorded as having crashed or timed out, and the run continues with the
+ * next test.
+ *
+ * \param options       The test options.
+ * \param state         The report state.
+ *
+ * \returns true if a warm-up hook failed, and false otherwise.
+ */
+static bool run_test_plan_in_process(
+    const minunit_test_options_t* options, test_report_state_t* state)
+{
+    vector<test_plan_entry_t>& plan = *state->plan;
+    deque<size_t> pending;
+
+    if (!run_warm_up_hooks(options))
+    {
+        return true;
+    }
+
+    bool contained = minunit_guard_install();
+
+    while (!pending.empty() || next_test_round(state, &pending))
+    {
+        report_test_plan(state);
+
+        uint32_t index = (uint32_t)pending.front();
+        test_plan_entry_t* entry = &plan[index];
+        pending.pop_front();
+
+        minunit_test_context_t result = {};
+        result.pass = true;
+        result.iterations = 1;
+        guarded_test_t guarded = guarded_test_t();
+        guarded.options = options;
+        guarded.entry = entry;
+        guarded.index = index;
+        guarded.context = &result;
+
+        auto start = chrono::steady_clock::now();
+        int sig =
+            minunit_guard_call(
+                contained ? test_timeout(options, entry) : 0,
+                &run_guarded_test, &guarded);
+
+        if (0 != sig)
+        {
+            memset(&guarded.usage, 0, sizeof(guarded.usage));
+            guarded.usage.wall_ns =
+                chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - start).count();
+
+            /* the status is that of a process killed by this signal. */
+            result.pass = false;
+            fflush(stdout);
+        }
+
+        vector<minunit_failure_t> failures;
+        minunit_assert_end(&failures);
+
+        if (0 == entry->failed_runs)
+        {
+            entry->failures.swap(failures);
+            entry->usage = guarded.usage;
+            entry->benchmark = guarded.benchmark;
+            entry->timing = guarded.timing;
+            entry->heap = guarded.heap;
+            entry->perf = guarded.perf;
+        }
+
+        record_test_run(
+            state, entry, result.pass, 0 != sig && SIGALRM != sig,
+            SIGALRM == sig, sig);
+    }
+
+    minunit_guard_remove();
+
+    report_test_plan(state);
+
+    return false;
+}
+
+/**
+ * \brief Run the test plan, on forked test runners unless the tests are to be
+ * run in this process.
+ *
+ * \param options       The test options.
+ * \param state         The report state.
+ *
+ * \returns true if the tests could not be run, and false otherwise.
+ */
+static bool run_test_plan(
+    const minunit_test_options_t* options, test_report_state_t* state)
+{
+#ifdef FORKED_TEST_RUNNER
+    if (!options->in_process)
+    {
+        return run_test_plan_forked(options, state);
+    }
+#endif
+
+    return run_test_plan_in_process(options, state);
+}
+
+/**
+ * \brief Determine whether the timing of a test is usable.
+ *
+ * \param entry         The plan entry for this test.
+ *
+ * \returns true if the test completed and passed, and false otherwise.
+ */
+static bool test_timing_valid(const test_plan_entry_t* entry)
+{
+    return
+        MINUNIT_TEST_TYPE_UNIT == entry->test->type && entry->complete
+     && entry->pass && !entry->crashed && !entry->timed_out
+     && entry->timing.samples > 0;
+}
+
+/**
+ * \brief Compare the timings of the tests in the plan against the baseline.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ * \param baseline      The baseline timings.
+ * \param changes       The tests which regressed or improved.
+ */
+static void compare_test_timings(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan, const minunit_timings_t& baseline,
+    vector<minunit_timing_report_t>* changes)
+{
+    for (const test_plan_entry_t& entry : plan)
+    {
+        if (!test_timing_valid(&entry))
+            continue;
+
+        auto i = baseline.find(test_timing_name(&entry));
+        if (baseline.end() == i)
+            continue;
+
+        minunit_timing_report_t change;
+        change.name = i->first;
+        change.benchmark =
+            0 != (entry.test->flags & MINUNIT_TEST_FLAG_BENCHMARK);
+        change.baseline_ns = i->second.mean_ns;
+        change.current_ns = entry.timing.mean_ns;
+        change.change =
+            minunit_timing_compare(
+                &i->second, &entry.timing, options->regression_threshold,
+                &change.percent, &change.margin);
+
+        if (MINUNIT_TIMING_UNCHANGED != change.change)
+            changes->push_back(change);
+    }
+}
+
+/**
+ * \brief Save the timings of the tests in the plan.
+ *
+ * Timings already saved in the file for tests which did not run are kept, so
+ * that filtered runs can update a shared file.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ *
+ * \returns true on success, and false on failure.
+ */
+static bool save_test_timings(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan)
+{
+    minunit_timings_t timings;
+
+    /* a missing or malformed file is replaced. */
+    if (!minunit_timings_load(options->save_timings, &timings))
+    {
+        timings.clear();
+    }
+
+    for (const test_plan_entry_t& entry : plan)
+    {
+        if (test_timing_valid(&entry))
+            timings[test_timing_name(&entry)] = entry.timing;
+    }
+
+    if (!minunit_timings_save(options->save_timings, timings))
+    {
+        fprintf(stderr, "Could not save timings to %s: %s.\n",
+                options->save_timings, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Update the duration cache with the wall time of each test run.
+ *
+ * The cached duration of a test is a moving average, so that a single slow
+ * run does not reorder the next run too drastically.  The cache is only an
+ * optimization, so a cache that can't be written is silently ignored.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ */
+static void update_duration_cache(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan)
+{
+    minunit_timings_t durations;
+
+    /* reload the cache, in case another run updated it. */
+    if (!minunit_timings_load(options->duration_cache, &durations))
+    {
+        durations.clear();
+    }
+
+    for (const test_plan_entry_t& entry : plan)
+    {
+        if (MINUNIT_TEST_TYPE_UNIT != entry.test->type || !entry.complete)
+            continue;
+
+        test_timing_t* duration = &durations[test_timing_name(&entry)];
+        double wall_ns = (double)entry.usage.wall_ns;
+
+        if (duration->samples > 0)
+            duration->mean_ns = (duration->mean_ns + wall_ns) / 2.0;
+        else
+            duration->mean_ns = wall_ns;
+
+        duration->samples = min(duration->samples + 1, (uint32_t)UINT16_MAX);
+        duration->stddev_ns = 0.0;
+    }
+
+    minunit_timings_save(options->duration_cache, durations);
+}
+
+/**
+ * \brief Save the coverage captured for the tests in the plan to the coverage
+ * index.
+ *
+ * The coverage already saved in the index for tests which did not run, or
+ * which crashed before their coverage was dumped, is kept, so that filtered
+ * runs can update a shared index.
+ *
+ * \param options       The test options.
+ * \param plan          The test plan.
+ *
+ * \returns true on success, and false on failure.
+ */
+static bool save_test_coverage(
+    const minunit_test_options_t* options,
+    const vector<test_plan_entry_t>& plan)
+{
+    minunit_coverage_index_t index;
+
+    /* a missing or malformed index is replaced. */
+    if (!minunit_coverage_load(options->save_coverage, &index))
+    {
+        index.clear();
+    }
+
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        const test_plan_entry_t* entry = &plan[i];
+        minunit_test_coverage_t coverage;
+
+        if (MINUNIT_TEST_TYPE_UNIT == entry->test->type && entry->complete
+         && minunit_coverage_collect((uint32_t)i, &coverage))
+        {
+            index[test_timing_name(entry)].swap(coverage);
+        }
+    }
+
+    if (!minunit_coverage_save(options->save_coverage, index))
+    {
+        fprintf(stderr, "Could not save coverage to %s: %s.\n",
+                options->save_coverage, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Fuzz the test named by the fuzz option, as "name" or "suite.name".
+ *
+ * \param options       The test options.
+ *
+ * \returns 0 if no failing input was found, and 1 otherwise.
+ */
+static int fuzz_test(const minunit_test_options_t* options)
+{
+#ifdef FUZZ_RUNNER
+    string name = options->fuzz;
+    string suite_name;
+    size_t splitpos = name.find(".");
+    if (string::npos != splitpos)
+    {
+        suite_name = name.substr(0, splitpos);
+        name = name.substr(splitpos + 1);
+    }
+
+    minunit_test_case_t** begin;
+    minunit_test_case_t** end;
+    get_test_cases(&begin, &end);
+
+    const char* suite = "";
+    const minunit_test_case_t* found = NULL;
+    for (minunit_test_case_t** i = begin; i != end && NULL == found; ++i)
+    {
+        minunit_test_case_t* test = *i;
+
+        if (MINUNIT_TEST_TYPE_SUITE == test->type)
+        {
+            suite = test->name;
+        }
+        else if (MINUNIT_TEST_TYPE_UNIT == test->type
+              && (test->flags & MINUNIT_TEST_FLAG_FUZZ)
+              && name == test->name
+              && ("" == suite_name || suite_name == suite))
+        {
+            found = test;
+        }
+    }
+
+    if (NULL == found)
+    {
+        fprintf(stderr, "Unknown fuzz test %s.\n", options->fuzz);
+        return 1;
+    }
+
+    if (!run_warm_up_hooks(options))
+    {
+        return 1;
+    }
+
+    return minunit_fuzz_run(options, found);
+#else
+    (void)options;
+    fprintf(stderr, "Fuzzing requires the forked test runner.\n");
+
+    return 1;
+#endif
+}
+
+/**
+ * \brief Run the unit tests.
+ */
+static int test_runner(const minunit_test_options_t* minunit_reserved_options)
+{
+    int ret = 0;
+
+    /* buffer the report, so that each block of it is written at once. */
+    setvbuf(stdout, NULL, _IOFBF, TEST_REPORT_BUFFER_SIZE);
+
+    if (NULL != minunit_reserved_options->fuzz)
+    {
+        return fuzz_test(minunit_reserved_options);
+    }
+
+    /* first, get the registered tests in declaration order. */
+    minunit_test_case_t** begin;
+    minunit_test_case_t** end;
+    get_test_cases(&begin, &end);
+
+    /* load the durations used to balance shards. */
+    minunit_timings_t shard_durations;
+    if (NULL != minunit_reserved_options->shard_durations
+     && !minunit_timings_load(
+            minunit_reserved_options->shard_durations, &shard_durations))
+    {
+        fprintf(stderr, "Could not read shard durations %s: %s.\n",
+                minunit_reserved_options->shard_durations, strerror(errno));
+        return 1;
+    }
+
+    /* build the plan of tests to run. */
+    vector<test_plan_entry_t> plan;
+    build_test_plan(minunit_reserved_options, begin, end, &plan);
+
+    /* leave out the tests which a change can't affect. */
+    unsigned int unaffected = 0;
+    if (NULL != minunit_reserved_options->coverage_index)
+    {
+        minunit_coverage_index_t index;
+        vector<minunit_change_t> changes;
+
+        if (!minunit_coverage_load(
+                minunit_reserved_options->coverage_index, &index))
+        {
+            fprintf(stderr, "Could not read coverage index %s: %s.\n",
+                    minunit_reserved_options->coverage_index,
+                    strerror(errno));
+            return 1;
+        }
+
+        if (NULL != minunit_reserved_options->changed_files)
+        {
+            minunit_coverage_parse_files(
+                minunit_reserved_options->changed_files, &changes);
+        }
+
+        if (NULL != minunit_reserved_options->changed_lines
+         && !minunit_coverage_parse_lines(
+                minunit_reserved_options->changed_lines, &changes))
+        {
+            fprintf(stderr, "Invalid changed lines %s.\n",
+                    minunit_reserved_options->changed_lines);
+            return 1;
+        }
+
+        unaffected = select_affected_tests(&plan, index, changes);
+    }
+
+    if (minunit_reserved_options->shard_count > 1)
+    {
+        shard_test_plan(minunit_reserved_options, &plan, shard_durations);
+    }
+
+    /* limits a test sets itself need a forked test runner, as those given
+     * as options do. */
+#ifdef RESOURCE_LIMITS
+    bool limitable = !minunit_reserved_options->in_process;
+#else
+    bool limitable = false;
+#endif
+    for (const test_plan_entry_t& entry : plan)
+    {
+        const minunit_test_limits_t* own = entry.test->limits;
+
+        if (!limitable && NULL != own
+         && (0 != own->memory || 0 != own->cpu || 0 != own->files
+          || 0 != own->output))
+        {
+            fprintf(stderr,
+                    "Test %s has resource limits, which require the forked "
+                    "test runner.\n", test_timing_name(&entry).c_str());
+            return 1;
+        }
+    }
+
+    /* count suites and tests. */
+    minunit_run_report_t run;
+    memset(&run, 0, sizeof(run));
+    run.display_stats = NULL == minunit_reserved_options->test_suite;
+    run.shard_index = minunit_reserved_options->shard_index;
+    run.shard_count = minunit_reserved_options->shard_count;
+    run.unaffected = unaffected;
+    run.baseline = minunit_reserved_options->baseline;
+    run.rounds = minunit_reserved_options->repeat;
+    run.until_fail = minunit_reserved_options->until_fail;
+    run.shuffled =
+        MINUNIT_TEST_ORDER_SHUFFLE == minunit_reserved_options->order;
+    run.seed = minunit_reserved_options->shuffle_seed;
+
+    for (const test_plan_entry_t& entry : plan)
+    {
+        if (MINUNIT_TEST_TYPE_SUITE == entry.test->type)
+            ++run.suites;
+        else
+            ++run.tests;
+    }
+
+    /* load the baseline timings to compare against. */
+    minunit_timings_t baseline;
+    if (NULL != minunit_reserved_options->baseline
+     && !minunit_timings_load(minunit_reserved_options->baseline, &baseline))
+    {
+        fprintf(stderr, "Could not read baseline %s: %s.\n",
+                minunit_reserved_options->baseline, strerror(errno));
+        return 1;
+    }
+
+    /* coverage can only be captured through the hooks of libgcov. */
+    if (NULL != minunit_reserved_options->save_coverage
+     && !minunit_coverage_available())
+    {
+        fprintf(stderr,
+                "Coverage hooks are not linked in; link with --coverage "
+                "-Wl,-u,__gcov_dump -Wl,-u,__gcov_reset.\n");
+        return 1;
+    }
+
+    /* counters the kernel does not allow are left out of the report. */
+    if (minunit_reserved_options->perf_counters)
+    {
+        uint32_t available = minunit_perf_probe();
+
+        if (0 == available)
+        {
+            fprintf(stderr, "Performance counters are not available.\n");
+        }
+        else if (!(available & MINUNIT_PERF_HARDWARE_COUNTERS))
+        {
+            fprintf(stderr,
+                    "Hardware performance counters are not available; "
+                    "counting software events only.\n");
+        }
+    }
+
+    minunit_reporter_t* reporter =
+        minunit_reporter_create(minunit_reserved_options);
+    if (NULL == reporter)
+    {
+        return 1;
+    }
+
+    reporter->vtable->run_start(reporter, &run);
+
+    test_report_state_t state;
+    state.options = minunit_reserved_options;
+    state.reporter = reporter;
+    state.plan = &plan;
+    state.order = nullptr;
+    state.rounds = 0;
+    state.last_round = false;
+    state.cursor = 0;
+    state.suite = "";
+    state.fail_count = 0;
+    state.captured = false;
+
+    /* decide the order in which to run the tests. */
+    minunit_timings_t durations;
+    if (NULL != minunit_reserved_options->duration_cache)
+    {
+        minunit_timings_load(
+            minunit_reserved_options->duration_cache, &durations);
+    }
+
+    vector<size_t> order;
+    schedule_test_plan(minunit_reserved_options, plan, durations, &order);
+    state.order = &order;
+
+    /* each test runner dumps the coverage of its tests. */
+    if (NULL != minunit_reserved_options->save_coverage
+     && !minunit_coverage_capture_start())
+    {
+        fprintf(stderr, "Could not capture coverage: %s.\n", strerror(errno));
+        reporter->vtable->release(reporter);
+        return 1;
+    }
+
+    /* run the tests. */
+    if (run_test_plan(minunit_reserved_options, &state))
+    {
+        minunit_coverage_capture_stop();
+        reporter->vtable->release(reporter);
+        return 1;
+    }
+
+    if (NULL != minunit_reserved_options->save_coverage)
+    {
+        if (!save_test_coverage(minunit_reserved_options, plan))
+            ret = 1;
+
+        minunit_coverage_capture_stop();
+    }
+
+    if (NULL != minunit_reserved_options->duration_cache)
+    {
+        update_duration_cache(minunit_reserved_options, plan);
+    }
+
+    if (state.fail_count > 0)
+    {
+        ret = 1;
+    }
+
+    report_suite_end(&state);
+
+    vector<minunit_timing_report_t> changes;
+    if (NULL != minunit_reserved_options->baseline)
+    {
+        compare_test_timings(
+            minunit_reserved_options, plan, baseline, &changes);
+    }
+
+    for (const minunit_timing_report_t& change : changes)
+    {
+        if (MINUNIT_TIMING_REGRESSED == change.change)
+            ret = 1;
+    }
+
+    run.failures = state.fail_count;
+    run.rounds = state.rounds;
+    run.changes = changes.data();
+    run.change_count = changes.size();
+
+    reporter->vtable->run_end(reporter, &run);
+    reporter->vtable->release(reporter);
+
+    if (NULL != minunit_reserved_options->save_timings
+     && !save_test_timings(minunit_reserved_options, plan))
+    {
+        ret = 1;
+    }
+
+    return ret;
 }
 
 static void ansi_terminal_set_color(int color)
@@ -509,20 +3305,600 @@ bool running_in_color_terminal()
 
 static string suite;
 static string test;
+static string duration_cache;
+static vector<const char*> reporters;
+
+/**
+ * \brief Parse a non-negative count option.
+ *
+ * \param name          The name of the option, for error reporting.
+ * \param value         The count to parse.
+ *
+ * \returns the count.
+ */
+static unsigned int parse_count(const char* name, const char* value)
+{
+    char* end = nullptr;
+    long count = strtol(value, &end, 10);
+
+    if ('\0' == *value || '\0' != *end || count < 0)
+    {
+        fprintf(stderr, "Invalid %s %s.\n", name, value);
+        exit(1);
+    }
+
+    return (unsigned int)count;
+}
+
+/**
+ * \brief Parse a duration option.
+ *
+ * The duration is in seconds unless it ends with one of the suffixes "ms",
+ * "s", "m", or "h".
+ *
+ * \param name          The name of the option, for error reporting.
+ * \param value         The duration to parse.
+ *
+ * \returns the duration in milliseconds.
+ */
+static unsigned int parse_duration(const char* name, const char* value)
+{
+    char* end = nullptr;
+    double duration = strtod(value, &end);
+    double scale = 1000.0;
+
+    if (!strcmp(end, "ms"))
+        scale = 1.0;
+    else if (!strcmp(end, "s") || !strcmp(end, ""))
+        scale = 1000.0;
+    else if (!strcmp(end, "m"))
+        scale = 60.0 * 1000.0;
+    else if (!strcmp(end, "h"))
+        scale = 60.0 * 60.0 * 1000.0;
+    else
+        end = nullptr;
+
+    if (end == value || nullptr == end || !(duration >= 0.0)
+     || duration * scale > (double)UINT32_MAX)
+    {
+        fprintf(stderr, "Invalid %s %s.\n", name, value);
+        exit(1);
+    }
+
+    return (unsigned int)(duration * scale);
+}
+
+/**
+ * \brief Parse a size option.
+ *
+ * The size is in bytes unless it ends with one of the suffixes "K", "M", or
+ * "G", for kibibytes, mebibytes, or gibibytes.
+ *
+ * \param name          The name of the option, for error reporting.
+ * \param value         The size to parse.
+ *
+ * \returns the size in bytes.
+ */
+static uint64_t parse_size(const char* name, const char* value)
+{
+    char* end = nullptr;
+    double size = strtod(value, &end);
+    double scale = 1.0;
+
+    if (!strcmp(end, ""))
+        scale = 1.0;
+    else if (!strcmp(end, "K"))
+        scale = 1024.0;
+    else if (!strcmp(end, "M"))
+        scale = 1024.0 * 1024.0;
+    else if (!strcmp(end, "G"))
+        scale = 1024.0 * 1024.0 * 1024.0;
+    else
+        end = nullptr;
+
+    if (end == value || nullptr == end || !(size >= 0.0)
+     || size * scale >= (double)UINT64_MAX)
+    {
+        fprintf(stderr, "Invalid %s %s.\n", name, value);
+        exit(1);
+    }
+
+    return (uint64_t)(size * scale);
+}
+
+/**
+ * \brief Parse a job count.
+ *
+ * \param value         The job count to parse.
+ *
+ * \returns the job count, where 0 selects one job per online processor.
+ */
+static unsigned int parse_job_count(const char* value)
+{
+    long jobs = parse_count("job count", value);
+
+    if (0 == jobs)
+    {
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+        if (jobs < 1)
+            jobs = 1;
+    }
+
+    return (unsigned int)jobs;
+}
+
+/**
+ * \brief Parse a test order.
+ *
+ * \param value         The order to parse.
+ *
+ * \returns the test order.
+ */
+static unsigned int parse_order(const char* value)
+{
+    if (!strcmp(value, "registration"))
+        return MINUNIT_TEST_ORDER_REGISTRATION;
+    else if (!strcmp(value, "duration"))
+        return MINUNIT_TEST_ORDER_DURATION;
+    else if (!strcmp(value, "shuffle"))
+        return MINUNIT_TEST_ORDER_SHUFFLE;
+
+    fprintf(stderr, "Invalid order %s.\n", value);
+    exit(1);
+}
+
+/**
+ * \brief Parse a shuffle seed.
+ *
+ * \param value         The seed to parse.
+ *
+ * \returns the seed.
+ */
+static uint64_t parse_seed(const char* value)
+{
+    char* end = nullptr;
+
+    errno = 0;
+    unsigned long long seed = strtoull(value, &end, 10);
+
+    if ('\0' == *value || '\0' != *end || '-' == *value || 0 != errno)
+    {
+        fprintf(stderr, "Invalid shuffle seed %s.\n", value);
+        exit(1);
+    }
+
+    return (uint64_t)seed;
+}
+
+/**
+ * \brief Pick a shuffle seed for a run which did not specify one.
+ *
+ * \returns the seed.
+ */
+static uint64_t random_seed()
+{
+    uint64_t state =
+        (uint64_t)chrono::system_clock::now().time_since_epoch().count()
+      ^ ((uint64_t)getpid() << 32);
+
+    return next_random(&state);
+}
+
+/**
+ * \brief Parse a result transport.
+ *
+ * \param value         The transport to parse.
+ *
+ * \returns the result transport.
+ */
+static unsigned int parse_transport(const char* value)
+{
+    if (!strcmp(value, "socket"))
+        return MINUNIT_TEST_TRANSPORT_SOCKET;
+#ifdef SHARED_MEMORY_TRANSPORT
+    else if (!strcmp(value, "ring"))
+        return MINUNIT_TEST_TRANSPORT_RING;
+#endif
+
+    fprintf(stderr, "Invalid transport %s.\n", value);
+    exit(1);
+}
+
+/**
+ * \brief Parse a shard specification of the form "index/count".
+ *
+ * \param value         The shard specification to parse.
+ * \param index         Set to the zero-based index of this shard.
+ * \param count         Set to the number of shards.
+ */
+static void parse_shard(
+    const char* value, unsigned int* index, unsigned int* count)
+{
+    string spec = value;
+    size_t splitpos = spec.find("/");
+
+    if (string::npos == splitpos)
+    {
+        fprintf(stderr, "Invalid shard %s.\n", value);
+        exit(1);
+    }
+
+    *index = parse_count("shard index", spec.substr(0, splitpos).c_str());
+    *count = parse_count("shard count", spec.substr(splitpos + 1).c_str());
+}
 
 static void handle_test_argument(
     minunit_test_options_t* options, int argc, char* argv[])
 {
     options->test_suite = NULL;
     options->test = NULL;
+    options->jobs = 1;
+    options->slowest = 5;
+    options->timeout = 0;
+    options->benchmark_time = 1000;
+    options->benchmark_samples = 10;
+    options->repetitions = 0;
+    options->save_timings = NULL;
+    options->baseline = NULL;
+    options->regression_threshold = 10;
+    options->order = MINUNIT_TEST_ORDER_REGISTRATION;
+    options->shard_index = 0;
+    options->shard_count = 1;
+    options->shard_durations = NULL;
+    options->zygote = false;
+    options->quiet_pass = false;
+    options->transport = MINUNIT_TEST_TRANSPORT_SOCKET;
+    options->reporters = NULL;
+    options->reporter_count = 0;
+    options->perf_counters = false;
+    options->in_process = false;
+    options->repeat = 1;
+    options->until_fail = false;
+    options->shuffle_seed = 0;
+    options->save_coverage = NULL;
+    options->coverage_index = NULL;
+    options->changed_files = NULL;
+    options->changed_lines = NULL;
+    options->property_seed = random_seed();
+    options->fuzz = NULL;
+    options->fuzz_time = 0;
+    options->corpus = NULL;
+    memset(&options->limits, 0, sizeof(options->limits));
+    bool seeded = false;
+    bool repeat_given = false;
+
+    const char* shard_index = getenv("MINUNIT_SHARD_INDEX");
+    const char* shard_count = getenv("MINUNIT_SHARD_COUNT");
+    if (NULL != shard_index && NULL != shard_count)
+    {
+        options->shard_index = parse_count("shard index", shard_index);
+        options->shard_count = parse_count("shard count", shard_count);
+    }
+
+    /* by default, durations are cached alongside the test executable. */
+    const char* cache = getenv("MINUNIT_DURATION_CACHE");
+    if (NULL != cache)
+        duration_cache = cache;
+    else if (argc > 0)
+        duration_cache = string(argv[0]) + ".durations";
+
+    const char* jobs = getenv("MINUNIT_JOBS");
+    if (NULL != jobs && strcmp(jobs, ""))
+    {
+        options->jobs = parse_job_count(jobs);
+    }
+
+    const char* timeout = getenv("MINUNIT_TIMEOUT");
+    if (NULL != timeout && strcmp(timeout, ""))
+    {
+        options->timeout = parse_duration("timeout", timeout);
+    }
+
+    /* handle options. */
+    int argi = 1;
+    for (; argi < argc && '-' == argv[argi][0]; ++argi)
+    {
+        string arg = argv[argi];
+
+        if ("--" == arg)
+        {
+            ++argi;
+            break;
+        }
+        else if ("-j" == arg)
+        {
+            if (argi + 1 >= argc)
+            {
+                fprintf(stderr, "Missing job count for -j.\n");
+                exit(1);
+            }
+
+            options->jobs = parse_job_count(argv[++argi]);
+        }
+        else if (0 == arg.compare(0, 2, "-j"))
+        {
+            options->jobs = parse_job_count(arg.c_str() + 2);
+        }
+        else if (0 == arg.compare(0, 7, "--jobs="))
+        {
+            options->jobs = parse_job_count(arg.c_str() + 7);
+        }
+        else if (0 == arg.compare(0, 10, "--slowest="))
+        {
+            options->slowest = parse_count("slowest count", arg.c_str() + 10);
+        }
+        else if (0 == arg.compare(0, 10, "--timeout="))
+        {
+            options->timeout = parse_duration("timeout", arg.c_str() + 10);
+        }
+        else if (0 == arg.compare(0, 17, "--benchmark-time="))
+        {
+            options->benchmark_time =
+                parse_duration("benchmark time", arg.c_str() + 17);
+        }
+        else if (0 == arg.compare(0, 20, "--benchmark-samples="))
+        {
+            options->benchmark_samples =
+                parse_count("benchmark sample count", arg.c_str() + 20);
+        }
+        else if (0 == arg.compare(0, 14, "--repetitions="))
+        {
+            options->repetitions =
+                parse_count("repetition count", arg.c_str() + 14);
+
+            if (0 == options->repetitions)
+            {
+                fprintf(stderr, "Invalid repetition count 0.\n");
+                exit(1);
+            }
+        }
+        else if (0 == arg.compare(0, 15, "--save-timings="))
+        {
+            options->save_timings = argv[argi] + 15;
+        }
+        else if (0 == arg.compare(0, 11, "--baseline="))
+        {
+            options->baseline = argv[argi] + 11;
+        }
+        else if (0 == arg.compare(0, 23, "--regression-threshold="))
+        {
+            options->regression_threshold =
+                parse_count("regression threshold", arg.c_str() + 23);
+        }
+        else if (0 == arg.compare(0, 8, "--order="))
+        {
+            options->order = parse_order(arg.c_str() + 8);
+        }
+        else if ("--shuffle" == arg)
+        {
+            options->order = MINUNIT_TEST_ORDER_SHUFFLE;
+        }
+        else if (0 == arg.compare(0, 10, "--shuffle="))
+        {
+            options->order = MINUNIT_TEST_ORDER_SHUFFLE;
+            options->shuffle_seed = parse_seed(arg.c_str() + 10);
+            seeded = true;
+        }
+        else if (0 == arg.compare(0, 16, "--property-seed="))
+        {
+            options->property_seed = parse_seed(arg.c_str() + 16);
+        }
+        else if (0 == arg.compare(0, 7, "--fuzz="))
+        {
+            options->fuzz = argv[argi] + 7;
+        }
+        else if (0 == arg.compare(0, 12, "--fuzz-time="))
+        {
+            options->fuzz_time = parse_duration("fuzz time", arg.c_str() + 12);
+        }
+        else if (0 == arg.compare(0, 9, "--corpus="))
+        {
+            options->corpus = argv[argi] + 9;
+        }
+        else if (0 == arg.compare(0, 9, "--repeat="))
+        {
+            options->repeat = parse_count("repeat count", arg.c_str() + 9);
+            repeat_given = true;
+
+            if (0 == options->repeat)
+            {
+                fprintf(stderr, "Invalid repeat count 0.\n");
+                exit(1);
+            }
+        }
+        else if ("--until-fail" == arg)
+        {
+            options->until_fail = true;
+        }
+        else if (0 == arg.compare(0, 16, "--save-coverage="))
+        {
+            options->save_coverage = argv[argi] + 16;
+        }
+        else if (0 == arg.compare(0, 17, "--coverage-index="))
+        {
+            options->coverage_index = argv[argi] + 17;
+        }
+        else if (0 == arg.compare(0, 16, "--changed-files="))
+        {
+            options->changed_files = argv[argi] + 16;
+        }
+        else if (0 == arg.compare(0, 16, "--changed-lines="))
+        {
+            options->changed_lines = argv[argi] + 16;
+        }
+        else if (0 == arg.compare(0, 17, "--duration-cache="))
+        {
+            duration_cache = arg.substr(17);
+        }
+        else if ("--zygote" == arg)
+        {
+            options->zygote = true;
+        }
+        else if ("--quiet-pass" == arg)
+        {
+            options->quiet_pass = true;
+        }
+        else if (0 == arg.compare(0, 12, "--transport="))
+        {
+            options->transport = parse_transport(arg.c_str() + 12);
+        }
+        else if (0 == arg.compare(0, 11, "--reporter="))
+        {
+            if (!minunit_reporter_valid(argv[argi] + 11))
+            {
+                fprintf(stderr, "Invalid reporter %s.\n", argv[argi] + 11);
+                exit(1);
+            }
+
+            reporters.push_back(argv[argi] + 11);
+        }
+        else if ("--in-process" == arg)
+        {
+            options->in_process = true;
+        }
+        else if ("--perf-counters" == arg)
+        {
+            options->perf_counters = true;
+        }
+        else if (0 == arg.compare(0, 8, "--shard="))
+        {
+            parse_shard(
+                arg.c_str() + 8, &options->shard_index,
+                &options->shard_count);
+        }
+        else if (0 == arg.compare(0, 18, "--shard-durations="))
+        {
+            options->shard_durations = argv[argi] + 18;
+        }
+        else if (0 == arg.compare(0, 15, "--limit-memory="))
+        {
+            options->limits.memory =
+                parse_size("memory limit", arg.c_str() + 15);
+        }
+        else if (0 == arg.compare(0, 12, "--limit-cpu="))
+        {
+            options->limits.cpu = parse_count("CPU limit", arg.c_str() + 12);
+        }
+        else if (0 == arg.compare(0, 14, "--limit-files="))
+        {
+            options->limits.files =
+                parse_count("file limit", arg.c_str() + 14);
+        }
+        else if (0 == arg.compare(0, 15, "--limit-output="))
+        {
+            options->limits.output =
+                parse_size("output limit", arg.c_str() + 15);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s.\n", arg.c_str());
+            exit(1);
+        }
+    }
+
+    options->duration_cache =
+        "" != duration_cache ? duration_cache.c_str() : NULL;
+    options->reporters = reporters.data();
+    options->reporter_count = (unsigned int)reporters.size();
+
+    if (0 == options->shard_count
+     || options->shard_index >= options->shard_count)
+    {
+        fprintf(stderr, "Invalid shard %u/%u.\n",
+                options->shard_index, options->shard_count);
+        exit(1);
+    }
+
+    /* tests are selected by a change, against the coverage index. */
+    bool changed =
+        NULL != options->changed_files || NULL != options->changed_lines;
+    if (changed && NULL == options->coverage_index)
+    {
+        fprintf(stderr, "Missing coverage index for the changes.\n");
+        exit(1);
+    }
+    else if (!changed && NULL != options->coverage_index)
+    {
+        fprintf(stderr, "Missing changes for the coverage index.\n");
+        exit(1);
+    }
+
+    /* a machine-readable report on standard output must have it to itself,
+     * which needs the output of tests to be captured. */
+    bool captured = false;
+#ifdef FORKED_TEST_RUNNER
+    captured = !options->in_process;
+#endif
+    unsigned int to_stdout = 0;
+    for (const char* spec : reporters)
+    {
+        if (!minunit_reporter_to_stdout(spec))
+            continue;
+
+        ++to_stdout;
+        if (minunit_reporter_machine_readable(spec) && !captured)
+        {
+            fprintf(stderr,
+                    "Reporter %s needs a file when test output is not "
+                    "captured.\n", spec);
+            exit(1);
+        }
+    }
+
+    if (to_stdout > 1)
+    {
+        fprintf(stderr, "Only one reporter may write to standard output.\n");
+        exit(1);
+    }
+
+    /* resource limits are applied to forked test runners. */
+    bool limited =
+        0 != options->limits.memory || 0 != options->limits.cpu
+     || 0 != options->limits.files || 0 != options->limits.output;
+#ifdef RESOURCE_LIMITS
+    if (limited && options->in_process)
+#else
+    if (limited)
+#endif
+    {
+        fprintf(stderr, "Resource limits require the forked test runner.\n");
+        exit(1);
+    }
+
+    /* without a limit on rounds, run until a test fails. */
+    if (options->until_fail && !repeat_given)
+    {
+        options->repeat = 0;
+    }
+
+    if (MINUNIT_TEST_ORDER_SHUFFLE == options->order && !seeded)
+    {
+        options->shuffle_seed = random_seed();
+    }
+
+    /* timings are sampled over several repetitions by default. */
+    if (0 == options->repetitions)
+    {
+        options->repetitions =
+            NULL != options->save_timings || NULL != options->baseline
+                ? 5 : 1;
+    }
 
     /* is there a test argument? */
-    if (argc <= 1)
+    if (argi >= argc)
     {
         return;
     }
 
-    string testarg = argv[1];
+    /* options must come before the test argument, which is the last. */
+    if (argi + 1 < argc)
+    {
+        fprintf(stderr, "Unexpected argument %s after %s.\n",
+                argv[argi + 1], argv[argi]);
+        exit(1);
+    }
+
+    string testarg = argv[argi];
     size_t splitpos = testarg.find(".");
 
     /* handle test and suite limiting case. */
@@ -0,0 +1,241 @@
+/**
+ * \file src/minunit_timings.cpp
+ *
+ * \brief Saved test timings, and comparison of a run against a baseline.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "minunit_timings.h"
+
+using namespace std;
+
+/**
+ * \brief First line of a timings file.
+ */
+#define MINUNIT_TIMINGS_HEADER "# minunit timings 1"
+
+/**
+ * \brief Two-sided 95% critical values of Student's t distribution, indexed by
+ * degrees of freedom less one.
+ */
+static const double t_critical[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+/**
+ * \brief Compute a timing from the wall time of repeated runs of a test.
+ *
+ * \param samples       The wall time of each run, in nanoseconds.
+ * \param timing        The timing to populate.
+ */
+void minunit_timing_from_samples(
+    const vector<uint64_t>& samples, test_timing_t* timing)
+{
+    size_t count = samples.size();
+    double sum = 0.0;
+    double variance = 0.0;
+
+    memset(timing, 0, sizeof(*timing));
+
+    if (0 == count)
+    {
+        return;
+    }
+
+    for (uint64_t sample : samples)
+        sum += (double)sample;
+
+    double mean = sum / count;
+    for (uint64_t sample : samples)
+        variance += ((double)sample - mean) * ((double)sample - mean);
+
+    timing->samples = (uint32_t)count;
+    timing->mean_ns = mean;
+    timing->stddev_ns = count > 1 ? sqrt(variance / (count - 1)) : 0.0;
+}
+
+/**
+ * \brief Get the critical t value for the given degrees of freedom.
+ *
+ * \param df            The degrees of freedom.
+ *
+ * \returns the two-sided 95% critical value.
+ */
+static double t_critical_value(double df)
+{
+    size_t count = sizeof(t_critical) / sizeof(t_critical[0]);
+
+    if (!(df >= 1.0))
+        return t_critical[0];
+    if (df >= (double)count)
+        return 1.960;
+
+    return t_critical[(size_t)df - 1];
+}
+
+/**
+ * \brief Compare a timing against its baseline.
+ *
+ * \param baseline      The baseline timing.
+ * \param current       The timing of the current run.
+ * \param threshold     The threshold, as a percentage of the baseline mean.
+ * \param change        Set to the change in the mean, as a percentage.
+ * \param margin        Set to the half-width of the confidence interval, as a
+ *                      percentage.
+ *
+ * \returns MINUNIT_TIMING_REGRESSED, MINUNIT_TIMING_IMPROVED, or
+ * MINUNIT_TIMING_UNCHANGED.
+ */
+int minunit_timing_compare(
+    const test_timing_t* baseline, const test_timing_t* current,
+    unsigned int threshold, double* change, double* margin)
+{
+    *change = 0.0;
+    *margin = 0.0;
+
+    if (0 == baseline->samples || 0 == current->samples
+     || !(baseline->mean_ns > 0.0))
+    {
+        return MINUNIT_TIMING_UNCHANGED;
+    }
+
+    /* Welch's t interval for the difference between the means. */
+    double a = baseline->stddev_ns * baseline->stddev_ns / baseline->samples;
+    double b = current->stddev_ns * current->stddev_ns / current->samples;
+    double df_denominator = 0.0;
+
+    if (baseline->samples > 1)
+        df_denominator += a * a / (baseline->samples - 1);
+    if (current->samples > 1)
+        df_denominator += b * b / (current->samples - 1);
+
+    double df = df_denominator > 0.0 ? (a + b) * (a + b) / df_denominator : 0.0;
+    double half_width = t_critical_value(df) * sqrt(a + b);
+    double difference = current->mean_ns - baseline->mean_ns;
+    double limit = baseline->mean_ns * threshold / 100.0;
+
+    *change = 100.0 * difference / baseline->mean_ns;
+    *margin = 100.0 * half_width / baseline->mean_ns;
+
+    if (difference - half_width > limit)
+        return MINUNIT_TIMING_REGRESSED;
+    else if (difference + half_width < -limit)
+        return MINUNIT_TIMING_IMPROVED;
+
+    return MINUNIT_TIMING_UNCHANGED;
+}
+
+/**
+ * \brief Load timings from a file.
+ *
+ * \param path          The path of the file.
+ * \param timings       The timings to add the loaded timings to.
+ *
+ * \returns true on success, and false if the file could not be read or is
+ * malformed.  errno is set if the file could not be opened.
+ */
+bool minunit_timings_load(const char* path, minunit_timings_t* timings)
+{
+    FILE* in = fopen(path, "r");
+    if (NULL == in)
+    {
+        return false;
+    }
+
+    char line[1024];
+    char name[512];
+    bool valid = true;
+
+    while (valid && NULL != fgets(line, sizeof(line), in))
+    {
+        if ('#' == line[0] || '\n' == line[0])
+            continue;
+
+        test_timing_t timing;
+        memset(&timing, 0, sizeof(timing));
+
+        if (4 != sscanf(
+                    line, "%511s %u %lf %lf", name, &timing.samples,
+                    &timing.mean_ns, &timing.stddev_ns))
+        {
+            valid = false;
+            break;
+        }
+
+        (*timings)[name] = timing;
+    }
+
+    if (ferror(in))
+    {
+        valid = false;
+    }
+
+    fclose(in);
+
+    if (!valid)
+    {
+        errno = EINVAL;
+    }
+
+    return valid;
+}
+
+/**
+ * \brief Save timings to a file.
+ *
+ * \param path          The path of the file.
+ * \param timings       The timings to save.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+bool minunit_timings_save(const char* path, const minunit_timings_t& timings)
+{
+    string temp = string(path) + ".tmp";
+
+    FILE* out = fopen(temp.c_str(), "w");
+    if (NULL == out)
+    {
+        return false;
+    }
+
+    fprintf(out, "%s\n", MINUNIT_TIMINGS_HEADER);
+    fprintf(out, "# test samples mean_ns stddev_ns\n");
+
+    for (const auto& i : timings)
+    {
+        fprintf(out, "%s %u %.3f %.3f\n",
+                i.first.c_str(), i.second.samples, i.second.mean_ns,
+                i.second.stddev_ns);
+    }
+
+    bool written = !ferror(out);
+    int error = errno;
+
+    if (0 != fclose(out))
+    {
+        written = false;
+        error = errno;
+    }
+
+    if (!written || 0 != rename(temp.c_str(), path))
+    {
+        if (written)
+            error = errno;
+
+        remove(temp.c_str());
+        errno = error;
+
+        return false;
+    }
+
+    return true;
+}
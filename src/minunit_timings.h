@@ -0,0 +1,95 @@
+/**
+ * \file src/minunit_timings.h
+ *
+ * \brief Saved test timings, and comparison of a run against a baseline.
+ *
+ * Timings are saved as a plain text file with one line per test, holding the
+ * test name, the number of samples, and the mean and standard deviation of the
+ * samples in nanoseconds.  Lines beginning with '#' are comments.
+ *
+ * \copyright 2019-2020 Justin Handville.  Please see LICENSE.txt in this
+ * distribution for more information.
+ */
+
+#ifndef  MINUNIT_TIMINGS_HEADER_GUARD
+# define MINUNIT_TIMINGS_HEADER_GUARD
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "minunit_protocol.h"
+
+/**
+ * \brief Timings keyed by "suite::test".
+ */
+typedef std::map<std::string, test_timing_t> minunit_timings_t;
+
+/**
+ * \brief Result of comparing a timing against its baseline.
+ */
+enum minunit_timing_change
+{
+    MINUNIT_TIMING_UNCHANGED,
+    MINUNIT_TIMING_REGRESSED,
+    MINUNIT_TIMING_IMPROVED
+};
+
+/**
+ * \brief Compute a timing from the wall time of repeated runs of a test.
+ *
+ * \param samples       The wall time of each run, in nanoseconds.
+ * \param timing        The timing to populate.
+ */
+void minunit_timing_from_samples(
+    const std::vector<uint64_t>& samples, test_timing_t* timing);
+
+/**
+ * \brief Compare a timing against its baseline.
+ *
+ * The difference between the means is bracketed by a 95% confidence interval,
+ * computed from the standard deviation and number of samples of each timing.
+ * A test has only regressed if the whole interval lies above the threshold,
+ * and has only improved if the whole interval lies below the negated
+ * threshold, so that noise between runs is not reported as a change.
+ *
+ * \param baseline      The baseline timing.
+ * \param current       The timing of the current run.
+ * \param threshold     The threshold, as a percentage of the baseline mean.
+ * \param change        Set to the change in the mean, as a percentage.
+ * \param margin        Set to the half-width of the confidence interval, as a
+ *                      percentage.
+ *
+ * \returns MINUNIT_TIMING_REGRESSED, MINUNIT_TIMING_IMPROVED, or
+ * MINUNIT_TIMING_UNCHANGED.
+ */
+int minunit_timing_compare(
+    const test_timing_t* baseline, const test_timing_t* current,
+    unsigned int threshold, double* change, double* margin);
+
+/**
+ * \brief Load timings from a file.
+ *
+ * \param path          The path of the file.
+ * \param timings       The timings to add the loaded timings to.
+ *
+ * \returns true on success, and false if the file could not be read or is
+ * malformed.  errno is set if the file could not be opened.
+ */
+bool minunit_timings_load(const char* path, minunit_timings_t* timings);
+
+/**
+ * \brief Save timings to a file.
+ *
+ * The timings are written to a temporary file which then replaces the file, so
+ * that readers never see a partially written file.
+ *
+ * \param path          The path of the file.
+ * \param timings       The timings to save.
+ *
+ * \returns true on success, and false on failure, with errno set.
+ */
+bool minunit_timings_save(const char* path, const minunit_timings_t& timings);
+
+#endif /*MINUNIT_TIMINGS_HEADER_GUARD*/